@@ -0,0 +1,141 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: arena.c
+Description: (CS-50) Module to implement a bump (arena) allocator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "arena.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const size_t ARENA_CHUNK_SIZE = 1 << 20;  // default bytes per chunk
+static const size_t ARENA_ALIGN = sizeof(max_align_t);
+
+/**************** local types ****************/
+/* One block of memory from malloc; the chunks of an arena form a list, newest first */
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    size_t used;          // bytes of data handed out
+    size_t size;          // bytes of data in this chunk
+    max_align_t data[];   // the memory itself, suitably aligned
+} arena_chunk_t;
+
+/**************** global types ****************/
+typedef struct arena {
+    arena_chunk_t* chunks;  // chunk being filled first
+    size_t chunkSize;       // bytes per ordinary chunk
+    size_t bytes;           // total bytes requested from malloc
+} arena_t;
+
+/**************** local functions ****************/
+static arena_chunk_t* chunk_new(arena_t* arena, const size_t size);
+
+
+/**************** global functions ****************/
+arena_t* arena_new(const size_t chunkSize){
+    arena_t* arena = mem_malloc(sizeof(arena_t));
+    if (arena != NULL) {
+        arena->chunks = NULL;
+        arena->chunkSize = chunkSize > 0 ? chunkSize : ARENA_CHUNK_SIZE;
+        arena->bytes = 0;
+    }
+    return arena;
+}
+
+void* arena_alloc(arena_t* arena, const size_t size){
+    if (arena == NULL) {
+        return NULL;
+    }
+    size_t rounded = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    arena_chunk_t* chunk = arena->chunks;
+
+    if (chunk == NULL || chunk->size - chunk->used < rounded) {
+        if (rounded > arena->chunkSize / 4) {
+            // Big request: a chunk of its own, kept behind the one being filled
+            arena_chunk_t* big = chunk_new(arena, rounded);
+            if (big == NULL) {
+                return NULL;
+            }
+            big->used = rounded;
+            if (chunk != NULL) {
+                big->next = chunk->next;
+                chunk->next = big;
+            } else {
+                arena->chunks = big;
+            }
+            return big->data;
+        }
+        chunk = chunk_new(arena, arena->chunkSize);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    void* memory = (char*) chunk->data + chunk->used;
+    chunk->used += rounded;
+    return memory;
+}
+
+char* arena_strdup(arena_t* arena, const char* str, const size_t len){
+    if (str == NULL) {
+        return NULL;
+    }
+    char* copy = arena_alloc(arena, len + 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+size_t arena_bytes(const arena_t* arena){
+    return arena == NULL ? 0 : arena->bytes;
+}
+
+void arena_adopt(arena_t* arena, arena_t* other){
+    if (arena == NULL || other == NULL) {
+        arena_delete(other);
+        return;
+    }
+    // Append other's chunks after ours, so we keep filling our current chunk
+    arena_chunk_t** tail = &arena->chunks;
+    while (*tail != NULL) {
+        tail = &(*tail)->next;
+    }
+    *tail = other->chunks;
+    arena->bytes += other->bytes;
+    other->chunks = NULL;
+    arena_delete(other);
+}
+
+void arena_delete(arena_t* arena){
+    if (arena != NULL) {
+        arena_chunk_t* chunk = arena->chunks;
+        while (chunk != NULL) {
+            arena_chunk_t* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        mem_free(arena);
+    }
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Allocate a chunk with room for size bytes of data */
+static arena_chunk_t* chunk_new(arena_t* arena, const size_t size){
+    arena_chunk_t* chunk = malloc(sizeof(arena_chunk_t) + size);
+    if (chunk != NULL) {
+        chunk->next = NULL;
+        chunk->used = 0;
+        chunk->size = size;
+        arena->bytes += sizeof(arena_chunk_t) + size;
+    }
+    return chunk;
+}
@@ -0,0 +1,71 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: arena.h
+Description: header file for CS50 arena module
+
+ * An "arena" is a bump allocator: it hands out memory from large chunks and
+ * frees all of it at once. It suits data that lives exactly as long as one
+ * structure, such as the words and postings of an index, and saves one
+ * malloc/free pair (and its header) per object. Individual allocations can
+ * not be freed. An arena is not thread-safe; give each thread its own.
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <stddef.h>
+
+/**************** global types ****************/
+typedef struct arena arena_t;  // opaque to users of the module
+
+/**************** arena_new ****************/
+/* Create a new, empty arena.
+ *
+ * Caller provides:
+ *   chunkSize - bytes to request from malloc at a time (0 for a default)
+ * We return:
+ *   pointer to a new arena; NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling arena_delete().
+ */
+arena_t* arena_new(const size_t chunkSize);
+
+/**************** arena_alloc ****************/
+/* Allocate size bytes from the arena, aligned for any ordinary type.
+ *
+ * We return:
+ *   pointer to the (uninitialized) memory; NULL if arena is NULL or out of memory.
+ * Notes:
+ *   requests larger than the chunk size get a chunk of their own.
+ */
+void* arena_alloc(arena_t* arena, const size_t size);
+
+/**************** arena_strdup ****************/
+/* Copy the first len characters of str into the arena, NUL-terminated.
+ *
+ * We return:
+ *   pointer to the copy; NULL if arena or str is NULL or out of memory.
+ */
+char* arena_strdup(arena_t* arena, const char* str, const size_t len);
+
+/**************** arena_bytes ****************/
+/* Return the number of bytes the arena has requested from malloc. */
+size_t arena_bytes(const arena_t* arena);
+
+/**************** arena_adopt ****************/
+/* Move every chunk of other into arena, then delete other.
+ *
+ * Notes:
+ *   memory allocated from other stays valid and is now freed with arena;
+ *   used to merge structures built in separate arenas without copying.
+ */
+void arena_adopt(arena_t* arena, arena_t* other);
+
+/**************** arena_delete ****************/
+/* Free the arena and everything ever allocated from it.
+ * We ignore a NULL arena.
+ */
+void arena_delete(arena_t* arena);
+
+#endif // __ARENA_H
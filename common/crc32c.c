@@ -0,0 +1,119 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: crc32c.c
+Description: (CS-50) Module to compute CRC-32C checksums, in hardware where available.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "crc32c.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CRC32C_X86 1
+#endif
+
+/*------------------------------------------------- Local Constants --------------------------------------------------*/
+static const uint32_t CRC32C_POLY = 0x82F63B78u;  // Castagnoli, bit-reversed
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+/* Extend a raw (not inverted) CRC over n bytes */
+typedef uint32_t (*crc_fn)(uint32_t crc, const uint8_t* data, size_t n);
+
+/*------------------------------------------------- Local Functions --------------------------------------------------*/
+static void choose_crc(void);
+static uint32_t crc_scalar(uint32_t crc, const uint8_t* data, size_t n);
+#ifdef CRC32C_X86
+static uint32_t crc_sse42(uint32_t crc, const uint8_t* data, size_t n);
+#endif
+
+/*------------------------------------------------- Local Variables --------------------------------------------------*/
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+static crc_fn crc = crc_scalar;
+static const char* crcName = "scalar";
+static uint32_t table[256];  // CRC of each byte value
+
+
+/*----------------------------------------------- Global Functions ----------------------------------------------------*/
+uint32_t crc32c_update(uint32_t value, const void* data, size_t length){
+    pthread_once(&crcOnce, choose_crc);
+    if (data == NULL || length == 0) {
+        return value;
+    }
+    // Inverted before and after, so runs of zero bytes still change it, and calls chain
+    return ~(*crc)(~value, data, length);
+}
+
+
+const char* crc32c_simd(void){
+    pthread_once(&crcOnce, choose_crc);
+    return crcName;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Build the table, and pick SSE4.2 if the CPU has it, unless TSE_CRC32C=scalar */
+static void choose_crc(void){
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t value = b;
+        for (int bit = 0; bit < 8; bit++) {
+            value = (value & 1) ? (value >> 1) ^ CRC32C_POLY : value >> 1;
+        }
+        table[b] = value;
+    }
+    const char* wanted = getenv("TSE_CRC32C");
+    if (wanted != NULL && strcmp(wanted, "scalar") == 0) {
+        return;
+    }
+#ifdef CRC32C_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc = crc_sse42;
+        crcName = "sse4.2";
+    }
+#endif
+}
+
+/* Portable CRC, a byte at a time */
+static uint32_t crc_scalar(uint32_t value, const uint8_t* data, size_t n){
+    for (size_t i = 0; i < n; i++) {
+        value = table[(value ^ data[i]) & 0xFF] ^ (value >> 8);
+    }
+    return value;
+}
+
+#ifdef CRC32C_X86
+/* SSE4.2 CRC: the crc32 instruction folds in eight bytes at a time, once data is 8-byte aligned.
+ * Only called if the CPU has SSE4.2. */
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t value, const uint8_t* data, size_t n){
+    while (n > 0 && ((uintptr_t) data & 7) != 0) {
+        value = _mm_crc32_u8(value, *data++);
+        n--;
+    }
+#ifdef __x86_64__
+    uint64_t wide = value;
+    for ( ; n >= 8; n -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    value = (uint32_t) wide;
+#endif
+    for ( ; n >= 4; n -= 4, data += 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        value = _mm_crc32_u32(value, word);
+    }
+    while (n > 0) {
+        value = _mm_crc32_u8(value, *data++);
+        n--;
+    }
+    return value;
+}
+#endif
@@ -0,0 +1,37 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: crc32c.h
+Description: header file for CS50 crc32c module
+
+ * CRC-32C (the Castagnoli polynomial, as in iSCSI and ext4) of a run of
+ * bytes, for the checksums of binary index files. x86 CPUs with SSE4.2
+ * compute it in hardware, eight bytes an instruction; elsewhere a table
+ * does a byte at a time. The choice is made when first used.
+ *
+ * The environment variable TSE_CRC32C=scalar forces the table, for testing.
+ */
+
+#ifndef __CRC32C_H
+#define __CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**************** crc32c_update ****************/
+/* Extend a CRC-32C over length more bytes.
+ *
+ * Caller provides:
+ *   crc - 0 to start, or what crc32c_update returned for the bytes before
+ *   data - length readable bytes
+ * We return:
+ *   the CRC-32C of the bytes before followed by these; so the CRC of a run
+ *   is the same however it is cut into calls.
+ */
+uint32_t crc32c_update(uint32_t crc, const void* data, size_t length);
+
+/**************** crc32c_simd ****************/
+/* Return the name of the implementation in use: "sse4.2" or "scalar". */
+const char* crc32c_simd(void);
+
+#endif // __CRC32C_H
@@ -0,0 +1,91 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: epoch.c
+Description: (CS-50) Module for epoch-based reclamation: swap what readers share without locking them out.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // for nanosleep
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "epoch.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const long EPOCH_POLL_NS = 100000;  // how long a writer sleeps between looks at a busy reader
+
+/**************** local types ****************/
+/* A reader's slot: the epoch it entered in, or 0 outside. Each on its own cache line, so readers
+ * don't slow each other down */
+typedef struct epoch_reader {
+    _Alignas(64) _Atomic uint64_t entered;
+} epoch_reader_t;
+
+/**************** global types ****************/
+typedef struct epoch {
+    _Atomic uint64_t current;   // the epoch readers enter in; starts at 1
+    epoch_reader_t* readers;
+    int numReaders;
+    pthread_mutex_t writers;    // one synchronize at a time
+} epoch_t;
+
+
+/**************** global functions ****************/
+epoch_t* epoch_new(const int numReaders){
+    if (numReaders < 1) {
+        return NULL;
+    }
+    epoch_t* epoch = mem_malloc(sizeof(epoch_t));
+    epoch_reader_t* readers = aligned_alloc(_Alignof(epoch_reader_t), numReaders * sizeof(epoch_reader_t));
+    if (epoch == NULL || readers == NULL || pthread_mutex_init(&epoch->writers, NULL) != 0) {
+        mem_free(epoch);
+        free(readers);
+        return NULL;
+    }
+    atomic_init(&epoch->current, 1);
+    for (int r = 0; r < numReaders; r++) {
+        atomic_init(&readers[r].entered, 0);
+    }
+    epoch->readers = readers;
+    epoch->numReaders = numReaders;
+    return epoch;
+}
+
+void epoch_enter(epoch_t* epoch, const int reader){
+    // Sequentially consistent, with the writer's swap, new epoch and look at this slot: if the writer
+    // looks before this store, our loads come after its swap and see the new pointer
+    atomic_store(&epoch->readers[reader].entered, atomic_load(&epoch->current));
+}
+
+void epoch_exit(epoch_t* epoch, const int reader){
+    atomic_store_explicit(&epoch->readers[reader].entered, 0, memory_order_release);
+}
+
+void epoch_synchronize(epoch_t* epoch){
+    if (epoch == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&epoch->writers);
+    uint64_t next = atomic_fetch_add(&epoch->current, 1) + 1;
+    struct timespec pause = {0, EPOCH_POLL_NS};
+    for (int r = 0; r < epoch->numReaders; r++) {
+        uint64_t entered;
+        while ((entered = atomic_load(&epoch->readers[r].entered)) != 0 && entered < next) {
+            nanosleep(&pause, NULL); // Inside since before: wait for it to exit
+        }
+    }
+    pthread_mutex_unlock(&epoch->writers);
+}
+
+void epoch_delete(epoch_t* epoch){
+    if (epoch != NULL) {
+        pthread_mutex_destroy(&epoch->writers);
+        free(epoch->readers);
+        mem_free(epoch);
+    }
+}
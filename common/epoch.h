@@ -0,0 +1,71 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: epoch.h
+Description: header file for CS50 epoch module
+
+ * Epoch-based reclamation, so one thread can replace something other threads
+ * are reading (an index being searched) and free the old one once no reader
+ * can still be using it, without readers ever taking a lock or waiting.
+ *
+ * A reader brackets each use with epoch_enter and epoch_exit, loading the
+ * shared pointer in between (with an atomic load). A writer swaps in the new
+ * pointer (an atomic exchange), calls epoch_synchronize, and then frees the
+ * old one: synchronize returns once every reader that might have loaded the
+ * old pointer has exited. Readers that enter after the swap see the new one
+ * and are not waited for. Entering and exiting are one atomic store each.
+ *
+ * Each reader thread has its own slot, numbered 0 to numReaders - 1; a thread
+ * must exit before entering again. Threads a reader starts while inside (the
+ * shards of a query, say) are covered by its slot.
+ */
+
+#ifndef __EPOCH_H
+#define __EPOCH_H
+
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct epoch epoch_t;  // opaque to users of the module
+
+
+/**************** epoch_new ****************/
+/* Create a reclamation domain.
+ *
+ * Caller provides:
+ *   the number of reader slots (at least 1)
+ * We return:
+ *   the new domain, with no reader inside; NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling epoch_delete().
+ */
+epoch_t* epoch_new(const int numReaders);
+
+
+/**************** epoch_enter ****************/
+/* Start a read in slot reader; pointers loaded until epoch_exit stay valid. */
+void epoch_enter(epoch_t* epoch, const int reader);
+
+
+/**************** epoch_exit ****************/
+/* End the read in slot reader; it may not use what it loaded any more. */
+void epoch_exit(epoch_t* epoch, const int reader);
+
+
+/**************** epoch_synchronize ****************/
+/* Wait until every reader inside when we were called has exited.
+ *
+ * We do:
+ *   start a new epoch, then poll each slot until it is outside or has entered
+ *   since. Readers are never held up; a writer calling this from its own
+ *   thread waits for the longest read in flight and no more. Writers calling
+ *   at once take turns.
+ */
+void epoch_synchronize(epoch_t* epoch);
+
+
+/**************** epoch_delete ****************/
+/* Free the domain. No reader may be inside. We ignore NULL. */
+void epoch_delete(epoch_t* epoch);
+
+#endif // __EPOCH_H
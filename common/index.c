@@ -5,233 +5,2237 @@ File: index.c
 Description: (CS-50) Module to implement an index data structure.
 */
 
+#define _POSIX_C_SOURCE 200809L  // for mmap, sysconf
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "index.h"
+#include "arena.h"
 #include "mem.h"
-#include "hashtable.h"
 #include "webpage.h"
-#include "counters.h"
-#include "word.h"
+#include "tokenizer.h"
+#include "stopword.h"
+#include "stemmer.h"
+#include "indexfile.h"
 #include "pagedir.h"
-#include "file.h"
+#include "manifest.h"
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+static const int INDEX_SLOTS = 700; // Expected number of words in every index we build
+
+static const int INDEX_MIN_POSTINGS = 2; // Postings room for a new word; most words are in few documents
+
+static const int INDEX_MIN_LENGTH = 3; // Shorter words are not indexed, nor are stopwords
+
+static const int PAGE_SLOTS = 256; // Initial slots of the per-page word table; grows with the largest page
+
+static const size_t INDEX_LOAD_CHUNK = 1 << 20; // Smallest part of a text index file worth a thread of its own
+
+#define INDEX_CURSOR_BLOCK POSTINGS_BLOCK // Postings per cursor block; a mapped word's blocks are its file's
+
+/* One (docID, count) pair of a word */
+typedef struct index_posting {
+    int docID;
+    int count;
+} index_posting_t;
+
+/* One field posting of a word: it occurs count times in field (INDEX_TITLE, ...) of document docID */
+typedef struct index_fieldPosting {
+    int field;
+    int docID;
+    int count;
+} index_fieldPosting_t;
+
+/* One slot of the word table */
+typedef struct index_term {
+    const char* word;           // in the arena; NULL if the slot is empty
+    uint32_t hash;              // index_hash(word), kept so the table can grow without rehashing words
+    index_posting_t* postings;  // contiguous array in the arena, in increasing docID order
+    int numPostings;
+    int capacity;               // postings the array has room for
+    uint8_t* positions;         // in a positional index, the positions of each posting in turn (postings.h)
+    uint32_t positionBytes;
+    uint32_t positionCapacity;
+    index_fieldPosting_t* fields; // in an index with fields, its field postings in the arena, in no order
+    int numFields;
+    int fieldCapacity;
+} index_term_t;
+
+/* A word of the page being indexed and its term, for sorting the words by term */
+typedef struct index_pageTerm {
+    const char* term;
+    int word;
+} index_pageTerm_t;
+
+/* One distinct word of the page being indexed, with its count so far */
+typedef struct index_pageWord {
+    size_t offset;   // of the word in the page's pool
+    uint32_t hash;   // index_hash(word), reused for the word table
+    int slot;        // of the word in the page's table, so it can be cleared without probing
+    int len;
+    int count;
+    const char* term;   // in a positional index: the word (or its stem) as the index holds it,
+    uint32_t termHash;  // and its hash
+    int group;          // the first word of the page with the same term
+    int end;            // for the first word of a group, where its positions end in grouped
+    int inTitle;        // in an index with fields: occurrences in the title,
+    int inHeading;      // and in headings
+} index_pageWord_t;
+
+/* An occurrence of a word of the page being indexed in the text of a link to another indexed page */
+typedef struct index_pageAnchor {
+    int word;
+    int docID;          // of the page linked to
+} index_pageAnchor_t;
+
+/* Counts of the words of one page, added to the word table once the page is read */
+typedef struct index_pageCounts {
+    int* slots;               // open-addressing table of 1 + position in words; 0 if empty
+    int numSlots;             // a power of 2
+    index_pageWord_t* words;  // distinct words of the page, in order of first occurrence
+    int numWords;
+    int capacity;
+    char* pool;               // the words themselves, NUL-terminated, back to back
+    size_t poolUsed;
+    size_t poolSize;
+    int* tokens;              // in a positional index: the word of each occurrence, in page order,
+    int* tokenPositions;      // and its position
+    int* grouped;             // the positions again, those of each term together
+    int numTokens;
+    int tokenCapacity;
+    index_pageTerm_t* order;  // the words sorted by term, to find the groups when stemming
+    int orderCapacity;
+    index_pageAnchor_t* anchors; // in an index with fields: words in the text of links
+    int numAnchors;
+    int anchorCapacity;
+    const char* anchorTag;    // the <a ...> tag of the last link whose text was read,
+    int anchorDocID;          // and the page it links to; 0 if none indexed
+} index_pageCounts_t;
+
+/* The URL of each page being indexed, normalized, so link text can be credited to the page linked to */
+typedef struct index_url {
+    char* url;
+    int docID;
+} index_url_t;
+
+typedef struct index_urls {
+    index_url_t* urls;        // sorted by URL (strcmp), each URL once
+    int numURLs;
+} index_urls_t;
+
+/* State of saveIndex_toPage: the line being printed */
+typedef struct index_textLine {
+    FILE* fp;
+    const char* word;   // the current word, printed with its first live posting
+    bool open;          // the current word's line has been started
+} index_textLine_t;
+
+/* A writer's functions, for saving only the postings of a docID range, and only the words of one
+ * term shard, with index_iterateSorted */
+typedef struct index_range {
+    int firstDocID;
+    int lastDocID;
+    int shard;          // keep the words index_termShard puts in this shard of numShards
+    int numShards;
+    bool skip;          // the current word belongs to another shard
+    void* arg;
+    bool (*wordfunc)(void* arg, const char* word);
+    bool (*postingfunc)(void* arg, const int docID, const int count, const int* positions);
+    bool (*fieldfunc)(void* arg, const int field, const int docID, const int count); // NULL drops fields
+} index_range_t;
+
+/* The caller's function, for walking a mapped index's words with indexfile_iterateWords */
+typedef struct index_wordVisit {
+    void* arg;
+    void (*itemfunc)(void* arg, const char* word);
+} index_wordVisit_t;
+
+/* The caller's function, for walking a mapped word's postings with indexfile_iteratePostings */
+typedef struct index_postingVisit {
+    void* arg;
+    void (*itemfunc)(void* arg, const int docID, const int count);
+} index_postingVisit_t;
+
+/* The caller's functions, for walking a mapped index's words and their postings in index_iterateSorted */
+typedef struct index_sortedVisit {
+    const indexfile_t* file;
+    void* arg;
+    bool (*wordfunc)(void* arg, const char* word);
+    bool (*postingfunc)(void* arg, const int docID, const int count, const int* positions);
+    bool (*fieldfunc)(void* arg, const int field, const int docID, const int count);
+    bool ok;            // false once wordfunc, postingfunc or fieldfunc has failed
+} index_sortedVisit_t;
+
+/* Postings of the words with a prefix, gathered for index_cursor_newPrefix and index_cursor_newWeighted */
+typedef struct index_gathered {
+    index_posting_t* postings;
+    int numPostings;
+    int capacity;
+    const int* weights; // for index_cursor_newWeighted, the weight of each field; NULL ignores fields
+    bool ok;            // false if out of memory
+} index_gathered_t;
+
+/* A contiguous range of documents, indexed by one thread into its own partial index */
+typedef struct index_worker {
+    const char* pageDirectory;
+    const int* docIDs;      // documents in this range, in increasing docID order
+    int numDocs;
+    bool positions;         // keep the positions of the words
+    const index_urls_t* urls; // with fields, the pages links can be credited to; NULL for no fields
+    index_t* partial;       // result; NULL if out of memory
+} index_worker_t;
+
+/* A line-aligned part of a text index file, parsed by one thread into its own partial index */
+typedef struct index_loader {
+    const char* text;       // starts at the start of a line
+    size_t length;          // ends just after a newline, or at the end of the file
+    index_t* partial;       // result; NULL if out of memory
+} index_loader_t;
+
+/*------------------------------------------------- Global Types -----------------------------------------------------*/
+/* A walk over the postings of one word, a block of INDEX_CURSOR_BLOCK at a time. Blocks of a mapped
+ * word are the file's blocks; blocks of an in-memory word are slices of its array */
+typedef struct index_cursor {
+    const indexfile_t* file;          // for a mapped word, its file and number in the file
+    int word;
+    const index_posting_t* postings;  // for an in-memory word, its array
+    index_posting_t* owned;           // postings gathered by index_cursor_newPrefix; freed with the cursor
+    int numPostings;
+    int numBlocks;
+    int block;                        // the current block; numBlocks once past the last posting
+    int blockLength;                  // postings in the current block
+    int pos;                          // the current posting in the block
+    bool hasPositions;                // a word of a positional index (not a prefix)
+    const uint8_t* termPositions;     // for an in-memory word, its positions,
+    size_t termPositionBytes;
+    int termPosting;                  // with those of posting termPosting (which only moves forward)
+    size_t termOffset;                // starting here
+    int positionsBlock;               // the block whose positions were found; -1 if none yet
+    const uint8_t* positions;         // its positions, positionBytes long,
+    size_t positionBytes;
+    int positionsAt;                  // with those of its posting positionsAt (which only moves forward)
+    size_t positionsOffset;           // starting here
+    int docIDs[INDEX_CURSOR_BLOCK];   // the current block's postings
+    int counts[INDEX_CURSOR_BLOCK];
+} index_cursor_t;
+
+typedef struct index {
+    index_term_t* terms;    // open-addressing table of words, numSlots long (a power of 2)
+    int numSlots;
+    int numWords;
+    arena_t* arena;         // every word and posting
+    tokenizer_t* tokenizer; // splits the page being indexed into words
+    stemmer_t* stemmer;     // memoized stems, if this build stems words; made by the first indexPage
+    index_pageCounts_t page; // reusable word counts of the page being indexed
+    bool positional;        // indexPage keeps each word's positions on the page, as well as its count
+    bool fields;            // indexPage keeps each word's counts in the title, headings and link text
+    const index_urls_t* urls; // with fields, the pages link text is credited to (index_build's)
+    indexfile_t* file;      // for a mapped index (index_map), the file holding every word; else NULL
+} index_t;
+
 
 /*------------------------------------------------- Local Functions --------------------------------------------------*/
-static void print_word_counters(void* arg, const char* word, void* item);
-static void print_docID_count(void* arg, const int docID, const int count);
-static void counters_delete_wrapper(void* item);
+static uint32_t index_hash(const char* word);
+static index_posting_t* index_findPosting(index_t* index, const char* word, const uint32_t hash, const int docID);
+static index_term_t* index_findTerm(index_t* index, const char* word, const uint32_t hash);
+static index_term_t* index_addTerm(index_t* index, const char* word, const uint32_t hash);
+static bool index_grow(index_t* index);
+static index_posting_t* index_getPosting(index_t* index, index_term_t* term, const int docID);
+static bool index_reserve(index_t* index, index_term_t* term, const int capacity);
+static int page_count(index_pageCounts_t* page, const char* word, const int len);
+static bool page_grow(index_pageCounts_t* page);
+static bool page_token(index_pageCounts_t* page, const int word, const int position);
+static bool page_positions(index_t* index, index_pageCounts_t* page);
+static int compare_pageTerms(const void* a, const void* b);
+static bool term_reservePositions(index_t* index, index_term_t* term, const size_t bytes);
+static bool page_fields(index_t* index, const webpage_t* page, const int docID, const int word, const int i);
+static bool page_anchors(index_t* index, index_pageCounts_t* page);
+static int compare_anchors(const void* a, const void* b);
+static bool term_addField(index_t* index, index_term_t* term, const int field, const int docID, const int count);
+static void page_clear(index_pageCounts_t* page);
+static void page_free(index_pageCounts_t* page);
+static index_t* index_build(char* pageDirectory, int numThreads, const bool positions, const bool fields);
+static index_urls_t* urls_new(const char* pageDirectory, const int* docIDs, const int numDocs);
+static int urls_find(const index_urls_t* urls, const char* url);
+static int compare_urls(const void* a, const void* b);
+static void urls_delete(index_urls_t* urls);
+static int anchor_target(const index_urls_t* urls, const webpage_t* page, const char* tag, const int len);
+static bool index_file(const char* pageDirectory, const int docID, index_t* index);
+static void* index_worker_thread(void* arg);
+static bool index_mergePartial(index_t* index, index_t* partial);
+static void* index_loader_thread(void* arg);
+static bool load_line(index_t* index, const char* line, const char* end, char** word, size_t* wordSize);
+static const char* load_number(const char* text, const char* end, int* value);
+static int compare_terms(const void* a, const void* b);
+static bool index_iterateSorted(index_t* index, void* arg, bool (*wordfunc)(void* arg, const char* word),
+                                bool (*postingfunc)(void* arg, const int docID, const int count,
+                                                    const int* positions),
+                                bool (*fieldfunc)(void* arg, const int field, const int docID, const int count));
+static bool term_sortedFields(const index_term_t* term, void* arg,
+                              bool (*fieldfunc)(void* arg, const int field, const int docID, const int count));
+static int compare_fieldPostings(const void* a, const void* b);
+static bool text_word(void* arg, const char* word);
+static bool text_posting(void* arg, const int docID, const int count, const int* positions);
+static bool binary_word(void* arg, const char* word);
+static bool binary_posting(void* arg, const int docID, const int count, const int* positions);
+static bool binary_field(void* arg, const int field, const int docID, const int count);
+static bool range_word(void* arg, const char* word);
+static bool range_posting(void* arg, const int docID, const int count, const int* positions);
+static bool range_field(void* arg, const int field, const int docID, const int count);
+static bool save_index(index_t* index, char* filepath, index_range_t* range, const bool binary);
+static bool visit_word(void* arg, const int i, const char* word);
+static bool visit_posting(void* arg, const int docID, const int count);
+static bool visit_sortedWord(void* arg, const int i, const char* word);
+static bool visit_sortedPosting(void* arg, const int docID, const int count);
+static bool visit_sortedField(void* arg, const int field, const int docID, const int count);
+static bool gather_posting(void* arg, const int docID, const int count);
+static bool gather_field(void* arg, const int field, const int docID, const int count);
+static bool gather_term(index_gathered_t* gathered, const index_term_t* term);
+static int compare_postings(const void* a, const void* b);
+static index_cursor_t* cursor_start(const index_cursor_t* cursor);
+static int cursor_blockLast(const index_cursor_t* cursor, const int block);
+static bool cursor_load(index_cursor_t* cursor, const int block);
+static bool cursor_settle(index_cursor_t* cursor);
+static bool cursor_findPositions(index_cursor_t* cursor);
+static int gallop(const int* docIDs, const int low, const int n, const int docID);
 
 
 /*----------------------------------------------- Global Functions ----------------------------------------------------*/
-hashtable_t* indexBuild(char* pageDirectory){
-    hashtable_t* index = hashtable_new(700); // Create the index data structure (initial size of 700)
+index_t* index_new(const int numWords){
+    index_t* index = mem_malloc(sizeof(index_t));
+    if (index == NULL) {
+        return NULL;
+    }
+    // Keep the table at most 3/4 full
+    int numSlots = 16;
+    while (numSlots < numWords + numWords / 3 + 1) {
+        numSlots *= 2;
+    }
+    index->terms = calloc(numSlots, sizeof(index_term_t));
+    index->numSlots = numSlots;
+    index->numWords = 0;
+    index->arena = arena_new(0);
+    index->tokenizer = tokenizer_new(INDEX_MIN_LENGTH, true, stopword_is);
+    index->stemmer = NULL;
+    memset(&index->page, 0, sizeof(index->page));
+    index->positional = false;
+    index->fields = false;
+    index->urls = NULL;
+    index->file = NULL;
+    if (index->terms == NULL || index->arena == NULL || index->tokenizer == NULL) {
+        index_delete(index);
+        return NULL;
+    }
+    return index;
+}
 
-    // Loop until we can't open a file (end of crawled files)
-    for (int docID = 1; ; docID++) {
-        // Construct the filepath: dpageDirectory/docID
-        int path_len = strlen(pageDirectory) + 20;  // Store the buffer length for filepath string
-        char* filepath = malloc(path_len); // Allocate memory for the filepath string
 
-        if (filepath == NULL) {
-            continue;
-        }
-        snprintf(filepath, path_len, "%s/%d", pageDirectory, docID); // Write the full path to filepath
+index_t* indexBuild(char* pageDirectory){
+    return indexBuild_parallel(pageDirectory, 1);
+}
+
+
+index_t* indexBuild_parallel(char* pageDirectory, int numThreads){
+    return index_build(pageDirectory, numThreads, false, false);
+}
+
+
+index_t* indexBuild_positional(char* pageDirectory, int numThreads){
+    return index_build(pageDirectory, numThreads, true, false);
+}
+
+
+index_t* indexBuild_fields(char* pageDirectory, int numThreads, const bool positions){
+    return index_build(pageDirectory, numThreads, positions, true);
+}
+
+
+bool index_hasPositions(const index_t* index){
+    if (index == NULL) {
+        return false;
+    }
+    return index->file != NULL ? (indexfile_flags(index->file) & INDEXFILE_POSITIONS) != 0 : index->positional;
+}
+
+
+bool index_hasFields(const index_t* index){
+    if (index == NULL) {
+        return false;
+    }
+    return index->file != NULL ? (indexfile_flags(index->file) & INDEXFILE_FIELDS) != 0 : index->fields;
+}
 
-        FILE* fp = fopen(filepath, "r"); // Try to open the file
 
-        if (docID == 1 && fp == NULL) { // If we can't open the file, we've reached the end
-            fprintf(stderr, "Error: Unable to open file %s\n", filepath);
-            mem_free(filepath);  // Free memory
-            return NULL; 
-        }else if (fp == NULL){ //We've reached the end
-            mem_free(filepath);  // Free memory
-            return index;
+void indexPage(webpage_t* page, const int docID, index_t* index){
+    if (page == NULL || index == NULL || index->file != NULL) {
+        return;
+    }
+    int numWords = 0; // Words in the tokenizer's current batch
+    bool ok = true;
+
+    // Count each indexable word of the webpage (3+ letters, already normalized) in the page's table,
+    // noting where each occurrence is if the index keeps positions, and which fields it is in if fields
+    tokenizer_start(index->tokenizer, page);
+    index->page.anchorTag = NULL;
+    while (ok && (numWords = tokenizer_next(index->tokenizer)) > 0) {
+        for (int i = 0; ok && i < numWords; i++) {
+            int len;
+            const char* word = tokenizer_word(index->tokenizer, i, &len);
+            int known = page_count(&index->page, word, len);
+            ok = known >= 0
+                && (!index->positional || page_token(&index->page, known, tokenizer_position(index->tokenizer, i)))
+                && (!index->fields || page_fields(index, page, docID, known, i));
         }
+    }
+    if (numWords < 0 || !ok) {
+        fprintf(stderr, "Error: out of memory reading words of document %d\n", docID);
+    }
+
+    // Stem each distinct word, not each occurrence; words sharing a stem share its posting
+    if (stemmer_enabled() && index->stemmer == NULL) {
+        index->stemmer = stemmer_new(0);
+    }
 
-        webpage_t* page; // Now create a webpage instance
-        if ((page = webpage_create_fromFile(fp)) == NULL){
-            fprintf(stderr, "Error: failed to read from file %s\n", filepath);
-            mem_free(filepath);  // Free memory
+    // Add one posting per distinct word, however often the page repeats it
+    index_pageCounts_t* counts = &index->page;
+    for (int i = 0; i < counts->numWords; i++) {
+        index_pageWord_t* word = &counts->words[i];
+        const char* term = counts->pool + word->offset;
+        uint32_t hash = word->hash;
+        if (index->stemmer != NULL) {
+            const char* stem = stemmer_stem(index->stemmer, term, word->len, NULL);
+            if (stem != NULL && strcmp(stem, term) != 0) {
+                term = stem;
+                hash = index_hash(stem);
+            }
+        }
+        index_posting_t* posting = index_findPosting(index, term, hash, docID);
+        if (posting == NULL) {
+            fprintf(stderr, "Failed to add to index");
+            ok = false;
             continue;
         }
+        posting->count += word->count;
+        if (index->positional || index->fields) {
+            index_term_t* found = index_findTerm(index, term, hash);
+            word->term = found->word; // The index's copy, which stays put
+            word->termHash = hash;
+            if ((word->inTitle > 0 && !term_addField(index, found, INDEX_TITLE, docID, word->inTitle))
+                || (word->inHeading > 0 && !term_addField(index, found, INDEX_HEADING, docID, word->inHeading))) {
+                fprintf(stderr, "Error: out of memory keeping the fields of words of document %d\n", docID);
+                ok = false;
+            }
+        }
+    }
 
-        // Fill the indedx with data from webpage_t page (URL (string), pagedepth (int), HTML (string))
-        indexPage(page, docID, index);
-        mem_free(filepath);  // Done with filepath
-        fclose(fp); // Close the file
+    // Then each posting's positions, in the same order as the postings, and the link text's pages
+    if (index->positional && ok && !page_positions(index, counts)) {
+        fprintf(stderr, "Error: out of memory keeping the positions of words of document %d\n", docID);
+    }
+    if (index->fields && ok && !page_anchors(index, counts)) {
+        fprintf(stderr, "Error: out of memory keeping the link text of document %d\n", docID);
     }
+    page_clear(counts);
 }
 
 
-void indexPage(webpage_t* page, const int docID, hashtable_t* index){
+bool index_add(index_t* index, const char* word, const int docID){
+    if (index == NULL || index->file != NULL || index->positional || word == NULL || docID <= 0) { // Validate parameters
+        return false;
+    }
+
+    // Increment the count for docID: word: (docID, count++), adding the word or posting if needed
+    index_posting_t* posting = index_findPosting(index, word, index_hash(word), docID);
+    if (posting == NULL) {
+        return false; // Out of memory
+    }
+    posting->count++;
+    return true;
+}
 
-    int pos = 0; // Create position indicator (pos) to keep track of where we are in page->HTML
-    char* word; // Create string pointer for storing the word
 
-    // Loop through each word of the webpage
-    while ((word = webpage_getNextWord(page, &pos)) != NULL) {
-        if (strlen(word) < 3) { // Skip words that are shorter than 3 characters
-            free(word);
-            continue;
+bool index_set(index_t* index, const char* word, const int docID, const int count){
+    if (index == NULL || index->file != NULL || index->positional || word == NULL || docID <= 0 || count < 0) {
+        return false;
+    }
+    index_posting_t* posting = index_findPosting(index, word, index_hash(word), docID);
+    if (posting == NULL) {
+        return false;
+    }
+    posting->count = count;
+    return true;
+}
+
+
+void index_iterate(index_t* index, void* arg, void (*itemfunc)(void* arg, const char* word)){
+    if (index == NULL || itemfunc == NULL) {
+        return;
+    }
+    if (index->file != NULL) {
+        index_wordVisit_t visit = {arg, itemfunc};
+        indexfile_iterateWords(index->file, 0, indexfile_numWords(index->file), &visit, visit_word);
+    }
+    for (int slot = 0; slot < index->numSlots; slot++) {
+        if (index->terms[slot].word != NULL) {
+            (*itemfunc)(arg, index->terms[slot].word);
         }
+    }
+}
 
-        // Normalize the word
-        if (!word_normalize(word)) {
-            free(word);
-            continue;
+
+bool index_iteratePostings(index_t* index, const char* word, void* arg,
+                           void (*itemfunc)(void* arg, const int docID, const int count)){
+    if (index == NULL || word == NULL) {
+        return false;
+    }
+    if (index->file != NULL) { // Postings straight from the mapped file
+        int i = indexfile_find(index->file, word);
+        index_postingVisit_t visit = {arg, itemfunc};
+        if (i >= 0 && itemfunc != NULL) {
+            indexfile_iteratePostings(index->file, i, &visit, visit_posting);
+        }
+        return i >= 0;
+    }
+    index_term_t* term = index_findTerm(index, word, index_hash(word));
+    if (term->word == NULL) {
+        return false;
+    }
+    for (int i = 0; itemfunc != NULL && i < term->numPostings; i++) {
+        if (term->postings[i].count > 0) {
+            (*itemfunc)(arg, term->postings[i].docID, term->postings[i].count);
         }
+    }
+    return true;
+}
 
-        // Add to to the hashtable index (will either create a new counters instance or increment an existing one)
-        if (!index_add(index, word, docID)){
-            fprintf(stderr, "Failed to add to index");
+
+index_cursor_t* index_cursor_new(index_t* index, const char* word){
+    if (index == NULL || word == NULL) {
+        return NULL;
+    }
+    index_cursor_t cursor = {NULL, -1, NULL, NULL, 0, 0, 0, 0, 0};
+    if (index->file != NULL) {
+        cursor.word = indexfile_find(index->file, word);
+        cursor.numPostings = indexfile_numPostings(index->file, cursor.word);
+        if (cursor.numPostings == 0) { // Absent, or only in field postings
+            return NULL;
+        }
+        cursor.file = index->file;
+    } else {
+        index_term_t* term = index_findTerm(index, word, index_hash(word));
+        if (term->word == NULL) {
+            return NULL;
+        }
+        cursor.postings = term->postings;
+        cursor.numPostings = term->numPostings;
+        cursor.termPositions = term->positions;
+        cursor.termPositionBytes = term->positionBytes;
+    }
+    cursor.hasPositions = index_hasPositions(index);
+    return cursor_start(&cursor);
+}
+
+
+index_cursor_t* index_cursor_newPrefix(index_t* index, const char* prefix){
+    return index_cursor_newPrefixAll(&index, 1, prefix);
+}
+
+
+index_cursor_t* index_cursor_newPrefixAll(index_t** indexes, const int numIndexes, const char* prefix){
+    return index_cursor_newWeighted(indexes, numIndexes, prefix, true, NULL);
+}
+
+
+index_cursor_t* index_cursor_newWeighted(index_t** indexes, const int numIndexes, const char* word,
+                                         const bool prefix, const int* weights){
+    if (indexes == NULL || word == NULL) {
+        return NULL;
+    }
+    index_gathered_t gathered = {NULL, 0, 0, weights, true};
+    int numWords = 0;
+    for (int n = 0; n < numIndexes; n++) {
+        index_t* index = indexes[n];
+        if (index == NULL) {
+            return NULL;
+        }
+        if (index->file != NULL) { // The words with the prefix are a run of the sorted dictionary
+            int first = indexfile_find(index->file, word);
+            int found = (first >= 0);
+            if (prefix) {
+                found = indexfile_findPrefix(index->file, word, &first);
+            }
+            bool fields = (weights != NULL && (indexfile_flags(index->file) & INDEXFILE_FIELDS) != 0);
+            for (int i = first; gathered.ok && i < first + found; i++) {
+                indexfile_iteratePostings(index->file, i, &gathered, gather_posting);
+                if (fields && gathered.ok) {
+                    indexfile_iterateFields(index->file, i, &gathered, gather_field);
+                }
+            }
+            numWords += found;
+        } else if (!prefix) {
+            index_term_t* term = index_findTerm(index, word, index_hash(word));
+            if (term->word != NULL) {
+                numWords++;
+                gather_term(&gathered, term);
+            }
+        } else { // The word table has no order, so every word is checked
+            size_t len = strlen(word);
+            for (int slot = 0; gathered.ok && slot < index->numSlots; slot++) {
+                index_term_t* term = &index->terms[slot];
+                if (term->word != NULL && strncmp(term->word, word, len) == 0) {
+                    numWords++;
+                    gather_term(&gathered, term);
+                }
+            }
         }
-        free(word); // Free memory since hashtable_t creates a copy of each word
     }
+    if (numWords == 0 || gathered.numPostings == 0 || !gathered.ok) { // Words only in field postings weighing nothing
+        free(gathered.postings);
+        return NULL;
+    }
+
+    // One posting per document, with the counts of its words summed
+    if (gathered.numPostings > 1) {
+        qsort(gathered.postings, gathered.numPostings, sizeof(index_posting_t), compare_postings);
+    }
+    int numPostings = 0;
+    for (int j = 0; j < gathered.numPostings; j++) {
+        index_posting_t* posting = &gathered.postings[j];
+        if (numPostings > 0 && gathered.postings[numPostings - 1].docID == posting->docID) {
+            int* count = &gathered.postings[numPostings - 1].count;
+            *count = (*count > INT_MAX - posting->count) ? INT_MAX : *count + posting->count;
+        } else {
+            gathered.postings[numPostings++] = *posting;
+        }
+    }
+    index_cursor_t cursor = {NULL, -1, gathered.postings, gathered.postings, numPostings, 0, 0, 0, 0};
+    index_cursor_t* new = cursor_start(&cursor);
+    if (new == NULL) {
+        free(gathered.postings);
+    }
+    return new;
+}
+
+
+int index_cursor_size(const index_cursor_t* cursor){
+    return cursor == NULL ? 0 : cursor->numPostings;
+}
+
+
+int index_cursor_docID(const index_cursor_t* cursor){
+    return (cursor == NULL || cursor->block >= cursor->numBlocks) ? 0 : cursor->docIDs[cursor->pos];
+}
+
+
+int index_cursor_count(const index_cursor_t* cursor){
+    return (cursor == NULL || cursor->block >= cursor->numBlocks) ? 0 : cursor->counts[cursor->pos];
 }
 
 
-bool index_add(hashtable_t* index, const char* word, const int docID){
-    if (index == NULL || word == NULL || docID < 0) { // Validate parameters
+bool index_cursor_next(index_cursor_t* cursor){
+    if (cursor == NULL || cursor->block >= cursor->numBlocks) {
         return false;
     }
+    cursor->pos++;
+    return cursor_settle(cursor);
+}
 
-    // Find the counters for this word, or create if needed
-    counters_t* ctrs = hashtable_find(index, word);
-    
-    if (ctrs == NULL) { // This word (key) does not exist yet in index hashtable; create new counters
-        ctrs = counters_new();
-        if (ctrs == NULL) {// Out of memory or other error
-            return false;
+
+bool index_cursor_seek(index_cursor_t* cursor, const int docID){
+    if (cursor == NULL || cursor->block >= cursor->numBlocks) {
+        return false;
+    }
+    if (cursor->docIDs[cursor->pos] >= docID) {
+        return true;
+    }
+    if (cursor_blockLast(cursor, cursor->block) < docID) {
+        // Find the first later block that can hold docID from the blocks' last docIDs alone:
+        // gallop ahead, doubling the step, then binary search the last step
+        int low = cursor->block;  // cursor_blockLast(low) < docID
+        int step = 1;
+        while (low + step < cursor->numBlocks && cursor_blockLast(cursor, low + step) < docID) {
+            low += step;
+            step *= 2;
         }
-        
-        // Insert the counters struct instance into the hashtable index at the key (word)
-        if (!hashtable_insert(index, word, ctrs)) { // Failed to insert
-            counters_delete(ctrs);
+        int high = (low + step < cursor->numBlocks) ? low + step : cursor->numBlocks;
+        while (high - low > 1) {
+            int mid = low + (high - low) / 2;
+            if (cursor_blockLast(cursor, mid) < docID) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        if (!cursor_load(cursor, high)) {
             return false;
         }
     }
-    // Use the stored pointer to counters to increment a value associated with docID
-    counters_add(ctrs, docID); // word: (docID, count++)
-    return true;
+    cursor->pos = gallop(cursor->docIDs, cursor->pos, cursor->blockLength, docID);
+    return cursor_settle(cursor);
 }
 
 
-bool saveIndex_toPage(hashtable_t* index, char* filepath){
-    if (index == NULL || filepath == NULL) { // Validate parameters
-        return false;
+int index_cursor_positions(index_cursor_t* cursor, int* positions){
+    if (cursor == NULL || positions == NULL || !cursor->hasPositions || cursor->block >= cursor->numBlocks
+        || !cursor_findPositions(cursor)) {
+        return 0;
     }
-    FILE* fp = fopen(filepath, "w"); // Try to open the file
+    // Pass over the positions of the block's postings before this one (the cursor only moves forward)
+    long skipped = 0;
+    for (int j = cursor->positionsAt; j < cursor->pos; j++) {
+        skipped += cursor->counts[j];
+    }
+    if (skipped > 0) {
+        size_t used = postings_skipPositions(cursor->positions + cursor->positionsOffset,
+                                             cursor->positionBytes - cursor->positionsOffset, skipped);
+        if (used == 0) {
+            return 0; // Damaged
+        }
+        cursor->positionsOffset += used;
+    }
+    cursor->positionsAt = cursor->pos;
+    int count = cursor->counts[cursor->pos];
+    return postings_decodePositions(cursor->positions + cursor->positionsOffset,
+                                    cursor->positionBytes - cursor->positionsOffset, count, positions) > 0 ? count : 0;
+}
 
-    if (fp == NULL){
-        return false;
-    }    
 
-    // Use the hashtable_iterate function with our custom print function
-    hashtable_iterate(index, fp, print_word_counters);
-    fclose(fp);
-    return true;
+void index_cursor_delete(index_cursor_t* cursor){
+    if (cursor != NULL) {
+        free(cursor->owned);
+        mem_free(cursor);
+    }
+}
+
+
+size_t index_memory(const index_t* index){
+    if (index == NULL) {
+        return 0;
+    }
+    const index_pageCounts_t* page = &index->page;
+    size_t pageBytes = page->numSlots * sizeof(int) + page->capacity * sizeof(index_pageWord_t) + page->poolSize
+                       + page->tokenCapacity * 3 * sizeof(int) + page->orderCapacity * sizeof(index_pageTerm_t)
+                       + page->anchorCapacity * sizeof(index_pageAnchor_t);
+    return sizeof(index_t) + index->numSlots * sizeof(index_term_t) + arena_bytes(index->arena)
+           + tokenizer_memory(index->tokenizer) + stemmer_memory(index->stemmer) + pageBytes;
 }
 
-hashtable_t* load_index(FILE* fp, int size) {
+
+bool saveIndex_toPage(index_t* index, char* filepath){
+    return saveIndex_range(index, filepath, 1, INT_MAX, false);
+}
+
+
+bool saveIndex_toBinary(index_t* index, char* filepath){
+    return saveIndex_range(index, filepath, 1, INT_MAX, true);
+}
+
+
+bool saveIndex_range(index_t* index, char* filepath, const int firstDocID, const int lastDocID, const bool binary){
+    index_range_t range = {firstDocID, lastDocID, 0, 1, false, NULL, NULL, NULL, NULL};
+    return save_index(index, filepath, &range, binary);
+}
+
+
+bool saveIndex_terms(index_t* index, char* filepath, const int shard, const int numShards, const bool binary){
+    index_range_t range = {1, INT_MAX, shard, numShards, false, NULL, NULL, NULL, NULL};
+    return numShards >= 1 && save_index(index, filepath, &range, binary);
+}
+
+
+int index_termShard(const char* word, const int numShards){
+    return (word == NULL || numShards <= 1) ? 0 : (int) (index_hash(word) % (uint32_t) numShards);
+}
+
+
+index_t* index_map(const char* filepath){
+    indexfile_t* file = indexfile_open(filepath);
+    if (file == NULL) {
+        return NULL;
+    }
+    index_t* index = mem_malloc(sizeof(index_t));
+    if (index == NULL) {
+        indexfile_close(file);
+        return NULL;
+    }
+    memset(index, 0, sizeof(index_t)); // No table, arena or tokenizer: the file is the index
+    index->file = file;
+    if (((indexfile_flags(file) & INDEXFILE_STEMMED) != 0) != stemmer_enabled()) {
+        fprintf(stderr, "Warning: %s was built %s stemming, but this program %s; rebuild the index\n",
+                filepath, stemmer_enabled() ? "without" : "with", stemmer_enabled() ? "stems words" : "does not");
+    }
+    return index;
+}
+
+
+bool index_isMapped(const index_t* index){
+    return index != NULL && index->file != NULL;
+}
+
+
+index_t* load_index(FILE* fp, int size) {
     if (fp == NULL) {
         return NULL;
     }
- 
-    // Create a new hashtable for the index
-    hashtable_t* index = hashtable_new(size); // Size chosen based on expected number of words
+
+    // Create a new index
+    index_t* index = index_new(size); // Size chosen based on expected number of words
     if (index == NULL) {
         return NULL;
     }
- 
+
+    // Read the file line by line into one reused buffer, and parse each line in place
     char* line = NULL;
- 
-    // Read the file line by line
-    while ((line = file_readLine(fp)) != NULL) {      
-        // Parse the line and add to index
-        parse_index_line(line, index);
-        mem_free(line);
+    size_t lineSize = 0;
+    char* word = NULL;
+    size_t wordSize = 0;
+    ssize_t len;
+    bool ok = true;
+    while (ok && (len = getline(&line, &lineSize, fp)) != -1) {
+        if (len > 0 && line[len - 1] == '\n') {
+            len--;
+        }
+        ok = load_line(index, line, line + len, &word, &wordSize);
+    }
+    free(line);
+    free(word);
+    if (!ok) {
+        fprintf(stderr, "Error: out of memory loading the index\n");
+        index_delete(index);
+        return NULL;
     }
     return index;
 }
 
-void parse_index_line(char* line, hashtable_t* index){
-    if (line == NULL || index == NULL) {
-        return;
+index_t* index_load(const char* filepath, int numThreads){
+    if (filepath == NULL) {
+        return NULL;
+    }
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = info.st_size;
+    if (size == 0) {
+        close(fd);
+        return index_new(1);
+    }
+    const char* text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        return NULL;
     }
 
-    // Make a copy of the line
-    char* lineCopy = mem_malloc(strlen(line) + 1);
-    strcpy(lineCopy, line);
-
-    if (lineCopy == NULL) {
-        return;
+    if (numThreads < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = (cpus > 0) ? (int) cpus : 1;
+    }
+    if ((size_t) numThreads > size / INDEX_LOAD_CHUNK + 1) {
+        numThreads = size / INDEX_LOAD_CHUNK + 1; // Small files aren't worth the threads
+    }
+    index_loader_t* loaders = mem_calloc(numThreads, sizeof(index_loader_t));
+    pthread_t* threads = mem_calloc(numThreads, sizeof(pthread_t));
+    bool* started = mem_calloc(numThreads, sizeof(bool));
+    if (loaders == NULL || threads == NULL || started == NULL) {
+        mem_free(loaders);
+        mem_free(threads);
+        mem_free(started);
+        munmap((void*) text, size);
+        return NULL;
     }
 
-    // Get the word (first token)
-    char* word = strtok(lineCopy, " ");
-    if (word == NULL) {
-        free(lineCopy);
-        return;
+    // Split the file into parts of about equal size, each moved on to end with a whole line
+    size_t start = 0;
+    for (int t = 0; t < numThreads; t++) {
+        size_t end = size;
+        if (t < numThreads - 1) {
+            end = size / numThreads * (t + 1);
+            end = (end < start) ? start : end;
+            const char* newline = memchr(text + end, '\n', size - end);
+            end = (newline == NULL) ? size : (size_t) (newline - text) + 1;
+        }
+        loaders[t].text = text + start;
+        loaders[t].length = end - start;
+        start = end;
     }
 
-    // Process all docID-count pairs
-    char* token;
-    while ((token = strtok(NULL, " ")) != NULL) {
-        // Get docID
-        int docID = atoi(token);
-        
-        // Get count
-        token = strtok(NULL, " ");
-        if (token == NULL) {
-            break;  // Malformed line
+    // Parse one partial index per part; this thread parses the first one
+    for (int t = 1; t < numThreads; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, index_loader_thread, &loaders[t]) == 0);
+    }
+    index_loader_thread(&loaders[0]);
+    for (int t = 1; t < numThreads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            index_loader_thread(&loaders[t]); // Couldn't start a thread; parse that part here
         }
-        int count = atoi(token);
+    }
+    munmap((void*) text, size);
+    mem_free(threads);
+    mem_free(started);
 
-        // If both docID and count are valid (positive numbers)
-        if (docID > 0 && count > 0) {
-            // Add to index - assumes index_add handles creating counters if needed
-            index_add(index, word, docID);
+    bool ok = true;
+    for (int t = 0; t < numThreads; t++) {
+        ok = ok && loaders[t].partial != NULL;
+    }
+    index_t* index = loaders[0].partial;
+    if (!ok) {
+        for (int t = 0; t < numThreads; t++) {
+            index_delete(loaders[t].partial);
+        }
+    } else {
+        // Each word has one line, so the parts hold different words and merging mostly moves them
+        for (int t = 1; t < numThreads; t++) {
+            ok = index_mergePartial(index, loaders[t].partial) && ok;
+        }
+        if (!ok) {
+            index_delete(index);
         }
     }
+    mem_free(loaders);
+    return ok ? index : NULL;
+}
+
 
-    mem_free(lineCopy);
+void parse_index_line(char* line, index_t* index){
+    if (line == NULL || index == NULL) {
+        return;
+    }
+    char* word = NULL;
+    size_t wordSize = 0;
+    load_line(index, line, line + strlen(line), &word, &wordSize);
+    free(word);
 }
 
 
-void index_delete(hashtable_t* index){
-    // Call hashtable_delete and pass in counters_delete as the function pointer
-    hashtable_delete(index, counters_delete_wrapper);
+void index_delete(index_t* index){
+    if (index != NULL) {
+        arena_delete(index->arena); // Every word and posting at once
+        free(index->terms);
+        tokenizer_delete(index->tokenizer);
+        stemmer_delete(index->stemmer);
+        page_free(&index->page);
+        indexfile_close(index->file);
+        mem_free(index);
+    }
 }
 
 
 /* ----------------------------------------- Local Helper functions --------------------------------------------------*/
-static void print_word_counters(void* arg, const char* word, void* item){
-    FILE* fp = arg;
-    counters_t* ctrs = item;
-    
-    if (fp != NULL && word != NULL && ctrs != NULL) {
-        // Print the word
-        fprintf(fp, "%s", word);
-        
-        // Use counters_iterate to print all docID/count pairs
-        counters_iterate(ctrs, fp, print_docID_count);
-        
-        // End the line
-        fprintf(fp, "\n");
+/* 32-bit FNV-1a hash of a word */
+static uint32_t index_hash(const char* word){
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*) word; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Return the posting of docID for word (whose hash is given), adding the word and a posting with
+ * count 0 if needed; NULL if out of memory */
+static index_posting_t* index_findPosting(index_t* index, const char* word, const uint32_t hash, const int docID){
+    index_term_t* term = index_findTerm(index, word, hash);
+    if (term->word == NULL && (term = index_addTerm(index, word, hash)) == NULL) {
+        return NULL;
+    }
+    return index_getPosting(index, term, docID);
+}
+
+/* Return the slot holding word, or the empty slot where it belongs */
+static index_term_t* index_findTerm(index_t* index, const char* word, const uint32_t hash){
+    uint32_t mask = index->numSlots - 1;
+    for (uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) { // Linear probing
+        index_term_t* term = &index->terms[slot];
+        if (term->word == NULL || (term->hash == hash && strcmp(term->word, word) == 0)) {
+            return term;
+        }
+    }
+}
+
+/* Add a word that is not in the index yet; return its slot, or NULL if out of memory */
+static index_term_t* index_addTerm(index_t* index, const char* word, const uint32_t hash){
+    if ((index->numWords + 1) * 4 > index->numSlots * 3 && !index_grow(index)) {
+        return NULL;
+    }
+    index_term_t* term = index_findTerm(index, word, hash);
+    term->word = arena_strdup(index->arena, word, strlen(word));
+    if (term->word == NULL) {
+        return NULL;
+    }
+    term->hash = hash;
+    term->postings = NULL;
+    term->numPostings = 0;
+    term->capacity = 0;
+    term->positions = NULL;
+    term->positionBytes = 0;
+    term->positionCapacity = 0;
+    index->numWords++;
+    return term;
+}
+
+/* Double the word table */
+static bool index_grow(index_t* index){
+    int numSlots = index->numSlots * 2;
+    index_term_t* terms = calloc(numSlots, sizeof(index_term_t));
+    if (terms == NULL) {
+        return false;
     }
+    uint32_t mask = numSlots - 1;
+    for (int i = 0; i < index->numSlots; i++) {
+        if (index->terms[i].word != NULL) {
+            uint32_t slot = index->terms[i].hash & mask;
+            while (terms[slot].word != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            terms[slot] = index->terms[i];
+        }
+    }
+    free(index->terms);
+    index->terms = terms;
+    index->numSlots = numSlots;
+    return true;
+}
+
+/* Return the posting of docID for a word, adding it with count 0 if needed; NULL if out of memory.
+ * Builds add docIDs in increasing order, so the last posting is the only one that can match and a
+ * new one goes on the end: both O(1). Out-of-order docIDs are placed by binary search. */
+static index_posting_t* index_getPosting(index_t* index, index_term_t* term, const int docID){
+    int n = term->numPostings;
+    if (n > 0 && term->postings[n - 1].docID == docID) {
+        return &term->postings[n - 1];
+    }
+    int at = n;
+    if (n > 0 && term->postings[n - 1].docID > docID) {
+        int low = 0;
+        int high = n - 1;  // postings[high].docID > docID
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (term->postings[mid].docID < docID) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (term->postings[low].docID == docID) {
+            return &term->postings[low];
+        }
+        at = low;
+    }
+
+    if (n == term->capacity && !index_reserve(index, term, n < INDEX_MIN_POSTINGS ? INDEX_MIN_POSTINGS : 2 * n)) {
+        return NULL;
+    }
+    memmove(&term->postings[at + 1], &term->postings[at], (n - at) * sizeof(index_posting_t));
+    term->postings[at].docID = docID;
+    term->postings[at].count = 0;
+    term->numPostings++;
+    return &term->postings[at];
 }
 
-static void print_docID_count(void* arg, const int docID, const int count){
-    FILE* fp = arg;
-    if (count > 0) {
-        fprintf(fp, " %d %d", docID, count);
+/* Make room for capacity postings. The array moves to a bigger block of the arena; the old block is
+ * only reclaimed with the arena, which at most doubles the space postings take. */
+static bool index_reserve(index_t* index, index_term_t* term, const int capacity){
+    if (capacity <= term->capacity) {
+        return true;
+    }
+    index_posting_t* postings = arena_alloc(index->arena, capacity * sizeof(index_posting_t));
+    if (postings == NULL) {
+        return false;
+    }
+    if (term->numPostings > 0) {
+        memcpy(postings, term->postings, term->numPostings * sizeof(index_posting_t));
+    }
+    term->postings = postings;
+    term->capacity = capacity;
+    return true;
+}
+
+/* Count one occurrence of word (len letters) on the page being indexed; return the word's number
+ * among the page's words, -1 if out of memory */
+static int page_count(index_pageCounts_t* page, const char* word, const int len){
+    if ((page->numWords + 1) * 4 > page->numSlots * 3 && !page_grow(page)) {
+        return -1;
+    }
+    uint32_t hash = index_hash(word);
+    uint32_t mask = page->numSlots - 1;
+    uint32_t slot = hash & mask;
+    for ( ; page->slots[slot] != 0; slot = (slot + 1) & mask) { // Linear probing
+        index_pageWord_t* known = &page->words[page->slots[slot] - 1];
+        if (known->hash == hash && strcmp(page->pool + known->offset, word) == 0) {
+            known->count++;
+            return page->slots[slot] - 1;
+        }
+    }
+
+    // First occurrence on this page: copy the word into the pool
+    if (page->numWords == page->capacity) {
+        int capacity = page->capacity * 2;
+        index_pageWord_t* words = realloc(page->words, capacity * sizeof(index_pageWord_t));
+        if (words == NULL) {
+            return -1;
+        }
+        page->words = words;
+        page->capacity = capacity;
+    }
+    if (page->poolUsed + len + 1 > page->poolSize) {
+        size_t poolSize = page->poolSize == 0 ? 4096 : page->poolSize;
+        while (poolSize < page->poolUsed + len + 1) {
+            poolSize *= 2;
+        }
+        char* pool = realloc(page->pool, poolSize);
+        if (pool == NULL) {
+            return -1;
+        }
+        page->pool = pool;
+        page->poolSize = poolSize;
+    }
+    index_pageWord_t* added = &page->words[page->numWords];
+    added->offset = page->poolUsed;
+    added->hash = hash;
+    added->slot = slot;
+    added->len = len;
+    added->count = 1;
+    added->inTitle = 0;
+    added->inHeading = 0;
+    memcpy(page->pool + page->poolUsed, word, len + 1);
+    page->poolUsed += len + 1;
+    page->slots[slot] = ++page->numWords;
+    return page->numWords - 1;
+}
+
+/* Double the page's table (or create it), keeping it at most 3/4 full */
+static bool page_grow(index_pageCounts_t* page){
+    int numSlots = page->numSlots == 0 ? PAGE_SLOTS : page->numSlots * 2;
+    int* slots = calloc(numSlots, sizeof(int));
+    if (slots == NULL) {
+        return false;
+    }
+    if (page->words == NULL) {
+        page->words = malloc(numSlots * 3 / 4 * sizeof(index_pageWord_t));
+        if (page->words == NULL) {
+            free(slots);
+            return false;
+        }
+        page->capacity = numSlots * 3 / 4;
+    }
+    uint32_t mask = numSlots - 1;
+    for (int i = 0; i < page->numWords; i++) {
+        uint32_t slot = page->words[i].hash & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i + 1;
+        page->words[i].slot = slot;
+    }
+    free(page->slots);
+    page->slots = slots;
+    page->numSlots = numSlots;
+    return true;
+}
+
+/* Note an occurrence of the page's word number word at a position, for a positional index; false
+ * if out of memory */
+static bool page_token(index_pageCounts_t* page, const int word, const int position){
+    if (page->numTokens == page->tokenCapacity) {
+        int capacity = (page->tokenCapacity == 0) ? 1024 : page->tokenCapacity * 2;
+        int* tokens = realloc(page->tokens, capacity * sizeof(int));
+        page->tokens = (tokens != NULL) ? tokens : page->tokens;
+        int* tokenPositions = realloc(page->tokenPositions, capacity * sizeof(int));
+        page->tokenPositions = (tokenPositions != NULL) ? tokenPositions : page->tokenPositions;
+        int* grouped = realloc(page->grouped, capacity * sizeof(int));
+        page->grouped = (grouped != NULL) ? grouped : page->grouped;
+        if (tokens == NULL || tokenPositions == NULL || grouped == NULL) {
+            return false;
+        }
+        page->tokenCapacity = capacity;
+    }
+    page->tokens[page->numTokens] = word;
+    page->tokenPositions[page->numTokens] = position;
+    page->numTokens++;
+    return true;
+}
+
+/* Add the positions of each term of the page (whose postings indexPage has added) to the
+ * term's positions, as the run of its last posting; false if out of memory. Words sharing a stem
+ * share a posting, so their positions are grouped by term first: a counting sort of the page's
+ * occurrences, which keeps each group's positions in page order, and so increasing. */
+static bool page_positions(index_t* index, index_pageCounts_t* page){
+    index_pageWord_t* words = page->words;
+    for (int i = 0; i < page->numWords; i++) {
+        words[i].group = i;
+        words[i].end = 0;
+    }
+    if (index->stemmer != NULL && page->numWords > 1) { // Words with the same term join the first's group
+        if (page->numWords > page->orderCapacity) {
+            index_pageTerm_t* order = realloc(page->order, page->numWords * sizeof(index_pageTerm_t));
+            if (order == NULL) {
+                return false;
+            }
+            page->order = order;
+            page->orderCapacity = page->numWords;
+        }
+        for (int i = 0; i < page->numWords; i++) {
+            page->order[i].term = words[i].term;
+            page->order[i].word = i;
+        }
+        qsort(page->order, page->numWords, sizeof(index_pageTerm_t), compare_pageTerms);
+        for (int k = 1; k < page->numWords; k++) {
+            if (page->order[k].term == page->order[k - 1].term) {
+                words[page->order[k].word].group = words[page->order[k - 1].word].group;
+            }
+        }
+    }
+
+    // Each group's positions go after the groups' before it; end counts, then moves, through its share
+    for (int i = 0; i < page->numWords; i++) {
+        words[words[i].group].end += words[i].count;
+    }
+    int start = 0;
+    for (int i = 0; i < page->numWords; i++) {
+        if (words[i].group == i) {
+            int count = words[i].end;
+            words[i].end = start;
+            start += count;
+        }
+    }
+    for (int t = 0; t < page->numTokens; t++) {
+        page->grouped[words[words[page->tokens[t]].group].end++] = page->tokenPositions[t];
+    }
+
+    start = 0;
+    for (int i = 0; i < page->numWords; i++) {
+        if (words[i].group != i) {
+            continue;
+        }
+        int count = words[i].end - start;
+        index_term_t* term = index_findTerm(index, words[i].term, words[i].termHash);
+        if (!term_reservePositions(index, term, POSTINGS_MAX_POSITION_BYTES(count))) {
+            return false;
+        }
+        term->positionBytes += postings_encodePositions(page->grouped + start, count,
+                                                        term->positions + term->positionBytes);
+        start = words[i].end;
+    }
+    return true;
+}
+
+/* qsort comparator for a page's words, by their terms (the index's copies, compared by address),
+ * then by their numbers */
+static int compare_pageTerms(const void* a, const void* b){
+    const index_pageTerm_t* termA = a;
+    const index_pageTerm_t* termB = b;
+    uintptr_t addressA = (uintptr_t) termA->term;
+    uintptr_t addressB = (uintptr_t) termB->term;
+    if (addressA != addressB) {
+        return (addressA > addressB) - (addressA < addressB);
+    }
+    return (termA->word > termB->word) - (termA->word < termB->word);
+}
+
+/* Note the fields word i of the tokenizer's batch (the page's word number word) is in: count it in the
+ * title or headings, and if it is the text of a link to another indexed page, note that page; false
+ * if out of memory. A link's page is found once, with its first word */
+static bool page_fields(index_t* index, const webpage_t* page, const int docID, const int word, const int i){
+    index_pageCounts_t* counts = &index->page;
+    unsigned int fields = tokenizer_fields(index->tokenizer, i);
+    counts->words[word].inTitle += (fields & TOKENIZER_TITLE) != 0;
+    counts->words[word].inHeading += (fields & TOKENIZER_HEADING) != 0;
+    if ((fields & TOKENIZER_ANCHOR) == 0 || index->urls == NULL) {
+        return true;
+    }
+    int len;
+    const char* tag = tokenizer_anchor(index->tokenizer, i, &len);
+    if (tag != counts->anchorTag) {
+        counts->anchorTag = tag;
+        counts->anchorDocID = anchor_target(index->urls, page, tag, len);
+    }
+    if (counts->anchorDocID <= 0 || counts->anchorDocID == docID) {
+        return true; // Links to a page not indexed, or to this one
+    }
+    if (counts->numAnchors == counts->anchorCapacity) {
+        int capacity = (counts->anchorCapacity == 0) ? 256 : counts->anchorCapacity * 2;
+        index_pageAnchor_t* anchors = realloc(counts->anchors, capacity * sizeof(index_pageAnchor_t));
+        if (anchors == NULL) {
+            return false;
+        }
+        counts->anchors = anchors;
+        counts->anchorCapacity = capacity;
+    }
+    counts->anchors[counts->numAnchors].word = word;
+    counts->anchors[counts->numAnchors].docID = counts->anchorDocID;
+    counts->numAnchors++;
+    return true;
+}
+
+/* Add a field posting to each term of the page (whose postings indexPage has added) for each page its
+ * words are the link text of, counting how often; false if out of memory. Words sharing a stem get a
+ * field posting each, which saving merges */
+static bool page_anchors(index_t* index, index_pageCounts_t* page){
+    if (page->numAnchors > 1) {
+        qsort(page->anchors, page->numAnchors, sizeof(index_pageAnchor_t), compare_anchors);
+    }
+    int count = 0;
+    for (int a = 0; a < page->numAnchors; a++) {
+        count++;
+        const index_pageAnchor_t* anchor = &page->anchors[a];
+        if (a + 1 < page->numAnchors && compare_anchors(anchor, anchor + 1) == 0) {
+            continue;
+        }
+        const index_pageWord_t* word = &page->words[anchor->word];
+        if (!term_addField(index, index_findTerm(index, word->term, word->termHash), INDEX_ANCHOR,
+                           anchor->docID, count)) {
+            return false;
+        }
+        count = 0;
+    }
+    return true;
+}
+
+/* qsort comparator for a page's link text, by word, then by the page linked to */
+static int compare_anchors(const void* a, const void* b){
+    const index_pageAnchor_t* anchorA = a;
+    const index_pageAnchor_t* anchorB = b;
+    if (anchorA->word != anchorB->word) {
+        return (anchorA->word > anchorB->word) - (anchorA->word < anchorB->word);
+    }
+    return (anchorA->docID > anchorB->docID) - (anchorA->docID < anchorB->docID);
+}
+
+/* Add a field posting to a term's, moving them to a bigger block of the arena as index_reserve does;
+ * false if out of memory */
+static bool term_addField(index_t* index, index_term_t* term, const int field, const int docID, const int count){
+    if (term->numFields == term->fieldCapacity) {
+        int capacity = (term->fieldCapacity == 0) ? INDEX_MIN_POSTINGS : term->fieldCapacity * 2;
+        index_fieldPosting_t* fields = arena_alloc(index->arena, capacity * sizeof(index_fieldPosting_t));
+        if (fields == NULL) {
+            return false;
+        }
+        if (term->numFields > 0) {
+            memcpy(fields, term->fields, term->numFields * sizeof(index_fieldPosting_t));
+        }
+        term->fields = fields;
+        term->fieldCapacity = capacity;
+    }
+    term->fields[term->numFields].field = field;
+    term->fields[term->numFields].docID = docID;
+    term->fields[term->numFields].count = count;
+    term->numFields++;
+    return true;
+}
+
+/* Make room for bytes more bytes of positions on the end of a term's, moving them to a bigger
+ * block of the arena as index_reserve does; false if out of memory */
+static bool term_reservePositions(index_t* index, index_term_t* term, const size_t bytes){
+    size_t needed = term->positionBytes + bytes;
+    if (needed <= term->positionCapacity) {
+        return true;
+    }
+    size_t capacity = (term->positionCapacity == 0) ? 16 : term->positionCapacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    if (capacity > UINT32_MAX) {
+        return false;
+    }
+    uint8_t* positions = arena_alloc(index->arena, capacity);
+    if (positions == NULL) {
+        return false;
+    }
+    if (term->positionBytes > 0) {
+        memcpy(positions, term->positions, term->positionBytes);
+    }
+    term->positions = positions;
+    term->positionCapacity = capacity;
+    return true;
+}
+
+/* Forget the page's words, keeping the memory for the next page */
+static void page_clear(index_pageCounts_t* page){
+    for (int i = 0; i < page->numWords; i++) {
+        page->slots[page->words[i].slot] = 0;
+    }
+    page->numWords = 0;
+    page->poolUsed = 0;
+    page->numTokens = 0;
+    page->numAnchors = 0;
+}
+
+/* Free the memory of the page's table */
+static void page_free(index_pageCounts_t* page){
+    free(page->slots);
+    free(page->words);
+    free(page->pool);
+    free(page->tokens);
+    free(page->tokenPositions);
+    free(page->grouped);
+    free(page->order);
+    free(page->anchors);
+}
+
+/* Build an index of pageDirectory's documents with numThreads threads, keeping positions and fields if
+ * asked: indexBuild_parallel, indexBuild_positional and indexBuild_fields */
+static index_t* index_build(char* pageDirectory, int numThreads, const bool positions, const bool fields){
+    if (pageDirectory == NULL) {
+        return NULL;
+    }
+
+    // Find the documents to index (from the manifest, or by probing pageDirectory/1, /2, ...)
+    int* docIDs = NULL;
+    uint64_t* sizes = NULL;
+    int numDocs = pagedir_listDocs(pageDirectory, &docIDs, &sizes);
+    if (numDocs <= 0) {
+        return NULL; // pagedir_listDocs printed the error
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numThreads > numDocs) {
+        numThreads = numDocs;
+    }
+
+    // Link text is credited to the page linked to, found by URL; the workers share one table
+    index_urls_t* urls = fields ? urls_new(pageDirectory, docIDs, numDocs) : NULL;
+    index_worker_t* workers = mem_calloc(numThreads, sizeof(index_worker_t));
+    pthread_t* threads = mem_calloc(numThreads, sizeof(pthread_t));
+    bool* started = mem_calloc(numThreads, sizeof(bool));
+    if (workers == NULL || threads == NULL || started == NULL || (fields && urls == NULL)) {
+        fprintf(stderr, "Error: out of memory building the index\n");
+        urls_delete(urls);
+        mem_free(workers);
+        mem_free(threads);
+        mem_free(started);
+        free(docIDs);
+        free(sizes);
+        return NULL;
+    }
+
+    // Split the documents into contiguous docID ranges holding roughly equal numbers of bytes
+    uint64_t totalBytes = 0;
+    for (int i = 0; i < numDocs; i++) {
+        totalBytes += sizes[i];
+    }
+    uint64_t doneBytes = 0;
+    int start = 0;
+    for (int t = 0; t < numThreads; t++) {
+        int end = numDocs;
+        if (t < numThreads - 1) {
+            uint64_t target = totalBytes / numThreads * (t + 1);
+            int lastEnd = numDocs - (numThreads - t - 1); // Leave at least one document per later range
+            end = start;
+            while (end < lastEnd && (end == start || doneBytes < target)) {
+                doneBytes += sizes[end++];
+            }
+        }
+        workers[t].pageDirectory = pageDirectory;
+        workers[t].positions = positions;
+        workers[t].urls = urls;
+        workers[t].docIDs = docIDs + start;
+        workers[t].numDocs = end - start;
+        start = end;
+    }
+    free(sizes);
+
+    // Build one partial index per range; this thread builds the first one
+    for (int t = 1; t < numThreads; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, index_worker_thread, &workers[t]) == 0);
+    }
+    index_worker_thread(&workers[0]);
+    for (int t = 1; t < numThreads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            index_worker_thread(&workers[t]); // Couldn't start a thread; build that range here
+        }
+    }
+    mem_free(threads);
+    mem_free(started);
+    free(docIDs);
+
+    bool ok = true;
+    for (int t = 0; t < numThreads; t++) {
+        ok = ok && workers[t].partial != NULL;
+    }
+    index_t* index = workers[0].partial;
+
+    if (!ok) {
+        for (int t = 0; t < numThreads; t++) {
+            index_delete(workers[t].partial);
+        }
+    } else {
+        // Ranges are in docID order, so appending partials 1..n to partial 0 gives the serial result
+        for (int t = 1; t < numThreads; t++) {
+            ok = index_mergePartial(index, workers[t].partial) && ok;
+        }
+        if (!ok) {
+            index_delete(index);
+        }
+    }
+    mem_free(workers);
+    urls_delete(urls);
+    if (ok) {
+        index->urls = NULL; // Freed with the table; the index is built
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Error: out of memory building the index\n");
+        return NULL;
+    }
+    return index;
+}
+
+/* Make the table of the URLs of the pages being indexed (docIDs, numDocs long), normalized as the
+ * crawler normalizes links: from the manifest if there is one, else from each page's first line; NULL
+ * if out of memory */
+static index_urls_t* urls_new(const char* pageDirectory, const int* docIDs, const int numDocs){
+    index_urls_t* urls = mem_malloc(sizeof(index_urls_t));
+    if (urls == NULL) {
+        return NULL;
+    }
+    urls->urls = malloc((numDocs > 0 ? numDocs : 1) * sizeof(index_url_t));
+    urls->numURLs = 0;
+    if (urls->urls == NULL) {
+        mem_free(urls);
+        return NULL;
+    }
+    manifest_t* manifest = manifest_load(pageDirectory);
+    if (manifest != NULL) {
+        for (int i = 0; i < manifest_count(manifest) && urls->numURLs < numDocs; i++) {
+            const manifest_entry_t* entry = manifest_get(manifest, i);
+            char* url = normalizeURL(manifest_getURL(manifest, entry));
+            if (url != NULL) {
+                urls->urls[urls->numURLs].url = url;
+                urls->urls[urls->numURLs++].docID = entry->docID;
+            }
+        }
+        manifest_delete(manifest);
+    } else {
+        for (int i = 0; i < numDocs; i++) {
+            char* raw = get_url((char*) pageDirectory, docIDs[i]);
+            char* url = normalizeURL(raw);
+            mem_free(raw);
+            if (url != NULL) {
+                urls->urls[urls->numURLs].url = url;
+                urls->urls[urls->numURLs++].docID = docIDs[i];
+            }
+        }
+    }
+
+    // Sorted for binary search; a URL saved twice is credited to its first page
+    if (urls->numURLs > 1) {
+        qsort(urls->urls, urls->numURLs, sizeof(index_url_t), compare_urls);
+    }
+    int kept = 0;
+    for (int i = 0; i < urls->numURLs; i++) {
+        index_url_t* last = (kept > 0) ? &urls->urls[kept - 1] : NULL;
+        if (last != NULL && strcmp(last->url, urls->urls[i].url) == 0) {
+            last->docID = (urls->urls[i].docID < last->docID) ? urls->urls[i].docID : last->docID;
+            mem_free(urls->urls[i].url);
+        } else {
+            urls->urls[kept++] = urls->urls[i];
+        }
+    }
+    urls->numURLs = kept;
+    return urls;
+}
+
+/* Return the docID of the page with a normalized URL; 0 if none is being indexed */
+static int urls_find(const index_urls_t* urls, const char* url){
+    index_url_t key = {(char*) url, 0};
+    const index_url_t* found = bsearch(&key, urls->urls, urls->numURLs, sizeof(index_url_t), compare_urls);
+    return (found == NULL) ? 0 : found->docID;
+}
+
+/* qsort and bsearch comparator for URLs, by strcmp */
+static int compare_urls(const void* a, const void* b){
+    return strcmp(((const index_url_t*) a)->url, ((const index_url_t*) b)->url);
+}
+
+/* Free the table of URLs. We ignore NULL */
+static void urls_delete(index_urls_t* urls){
+    if (urls != NULL) {
+        for (int i = 0; i < urls->numURLs; i++) {
+            mem_free(urls->urls[i].url);
+        }
+        free(urls->urls);
+        mem_free(urls);
+    }
+}
+
+/* Return the docID of the page a link's <a ...> tag (len bytes of page's HTML) points to, finding its
+ * URL as the crawler's pageScan does (webpage_getNextURL against the page's URL, then normalizeURL);
+ * 0 if it has none, or the page isn't being indexed. The tag is copied, since webpage_getNextURL
+ * rewrites the HTML it reads */
+static int anchor_target(const index_urls_t* urls, const webpage_t* page, const char* tag, const int len){
+    const char* pageURL = webpage_getURL(page);
+    if (pageURL == NULL) {
+        return 0;
+    }
+    char* html = mem_malloc(len + 1);
+    char* base = mem_malloc(strlen(pageURL) + 1);
+    if (html == NULL || base == NULL) {
+        mem_free(html);
+        mem_free(base);
+        return 0;
+    }
+    memcpy(html, tag, len);
+    html[len] = '\0';
+    strcpy(base, pageURL);
+    webpage_t* link = webpage_new(base, 0, html);
+    if (link == NULL) {
+        mem_free(html);
+        mem_free(base);
+        return 0;
+    }
+    int docID = 0;
+    int pos = 0;
+    char* url = webpage_getNextURL(link, &pos);
+    char* normalURL = normalizeURL(url);
+    if (normalURL != NULL) {
+        docID = urls_find(urls, normalURL);
+    }
+    mem_free(normalURL);
+    mem_free(url);
+    webpage_delete(link);
+    return docID;
+}
+
+/* Index the page saved as pageDirectory/docID; return false if it cannot be read */
+static bool index_file(const char* pageDirectory, const int docID, index_t* index){
+    webpage_t* page = pagedir_load(pageDirectory, docID);
+    if (page == NULL) {
+        fprintf(stderr, "Error: cannot read document %s/%d\n", pageDirectory, docID);
+        return false;
+    }
+    // Fill the index with data from webpage_t page (URL (string), pagedepth (int), HTML (string))
+    indexPage(page, docID, index);
+    webpage_delete(page);
+    return true;
+}
+
+/* Thread body: index one range of documents into a new partial index */
+static void* index_worker_thread(void* arg){
+    index_worker_t* worker = arg;
+    worker->partial = index_new(INDEX_SLOTS);
+    if (worker->partial != NULL) {
+        worker->partial->positional = worker->positions;
+        worker->partial->fields = (worker->urls != NULL);
+        worker->partial->urls = worker->urls;
+        for (int i = 0; i < worker->numDocs; i++) {
+            index_file(worker->pageDirectory, worker->docIDs[i], worker->partial);
+        }
+    }
+    return NULL;
+}
+
+/* Move every word and posting of partial (whose docIDs all follow index's) into index, then
+ * delete partial. index adopts partial's arena, so words new to index keep their strings and
+ * posting arrays (and positions and field postings); known words get partial's postings (and
+ * positions) copied onto the end of theirs, or, if partial's docIDs don't all follow (a word
+ * repeated in a text index, which has no positions), added one by one. Field postings are in no
+ * order, so known words' are simply appended. */
+static bool index_mergePartial(index_t* index, index_t* partial){
+    bool ok = true;
+    for (int slot = 0; slot < partial->numSlots; slot++) {
+        index_term_t* from = &partial->terms[slot];
+        if (from->word == NULL) {
+            continue;
+        }
+        index_term_t* to = index_findTerm(index, from->word, from->hash);
+        if (to->word == NULL) {
+            if ((index->numWords + 1) * 4 > index->numSlots * 3) {
+                if (!index_grow(index)) {
+                    ok = false;
+                    break;
+                }
+                to = index_findTerm(index, from->word, from->hash);
+            }
+            *to = *from; // The word stays in partial's arena, which index adopts below
+            index->numWords++;
+            continue;
+        }
+        for (int j = 0; ok && j < from->numFields; j++) { // A known word's field postings, then its postings
+            ok = term_addField(index, to, from->fields[j].field, from->fields[j].docID, from->fields[j].count);
+        }
+        if (!ok) {
+            break;
+        }
+        if (from->numPostings > 0 && to->numPostings > 0
+                   && from->postings[0].docID <= to->postings[to->numPostings - 1].docID) {
+            ok = (from->positionBytes == 0); // Builds' ranges follow each other, so positions never land here
+            for (int j = 0; ok && j < from->numPostings; j++) {
+                index_posting_t* posting = index_getPosting(index, to, from->postings[j].docID);
+                ok = (posting != NULL);
+                if (ok) {
+                    posting->count += from->postings[j].count;
+                }
+            }
+        } else if (from->numPostings > 0) {
+            int needed = to->numPostings + from->numPostings;
+            int capacity = to->capacity > 0 ? to->capacity : INDEX_MIN_POSTINGS;
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+            if (!index_reserve(index, to, capacity) || !term_reservePositions(index, to, from->positionBytes)) {
+                ok = false;
+                break;
+            }
+            memcpy(&to->postings[to->numPostings], from->postings, from->numPostings * sizeof(index_posting_t));
+            to->numPostings = needed;
+            if (from->positionBytes > 0) {
+                memcpy(to->positions + to->positionBytes, from->positions, from->positionBytes);
+                to->positionBytes += from->positionBytes;
+            }
+        }
+    }
+    arena_adopt(index->arena, partial->arena);
+    partial->arena = NULL;
+    index_delete(partial);
+    return ok;
+}
+
+/* Thread body: parse one part of a text index file into a new partial index */
+static void* index_loader_thread(void* arg){
+    index_loader_t* loader = arg;
+    const char* text = loader->text;
+    const char* end = text + loader->length;
+    int numLines = 0;
+    for (const char* c = text; c < end && (c = memchr(c, '\n', end - c)) != NULL; c++) {
+        numLines++;
+    }
+    loader->partial = index_new(numLines + 1);
+    char* word = NULL; // The current line's word, NUL-terminated
+    size_t wordSize = 0;
+    bool ok = (loader->partial != NULL);
+    while (ok && text < end) {
+        const char* newline = memchr(text, '\n', end - text);
+        const char* eol = (newline == NULL) ? end : newline;
+        ok = load_line(loader->partial, text, eol, &word, &wordSize);
+        text = eol + 1;
+    }
+    free(word);
+    if (!ok) {
+        index_delete(loader->partial);
+        loader->partial = NULL;
+    }
+    return NULL;
+}
+
+/* Add one line of a text index file, "word docID count [docID count]...", to index with its
+ * exact counts; false if out of memory. The word is found once, and its postings array grown once
+ * to hold every pair of the line; pairs in increasing docID order (as every writer writes them)
+ * then go on its end. Malformed pairs and pairs without a positive docID and count are skipped;
+ * a word or docID given twice has its counts added. */
+static bool load_line(index_t* index, const char* line, const char* end, char** word, size_t* wordSize){
+    while (line < end && *line == ' ') {
+        line++;
+    }
+    const char* wordEnd = line;
+    while (wordEnd < end && *wordEnd != ' ') {
+        wordEnd++;
+    }
+    size_t len = wordEnd - line;
+    if (len == 0) {
+        return true;
+    }
+    if (len + 1 > *wordSize) {
+        char* bigger = realloc(*word, len + 1);
+        if (bigger == NULL) {
+            return false;
+        }
+        *word = bigger;
+        *wordSize = len + 1;
+    }
+    memcpy(*word, line, len);
+    (*word)[len] = '\0';
+
+    // Count the line's pairs, to make room for them all at once
+    int numTokens = 0;
+    for (const char* c = wordEnd; c < end; c++) {
+        numTokens += (*c != ' ' && c[-1] == ' ');
+    }
+    if (numTokens < 2) {
+        return true;
+    }
+    uint32_t hash = index_hash(*word);
+    index_term_t* term = index_findTerm(index, *word, hash);
+    if ((term->word == NULL && (term = index_addTerm(index, *word, hash)) == NULL)
+        || !index_reserve(index, term, term->numPostings + numTokens / 2)) {
+        return false;
+    }
+
+    const char* text = wordEnd;
+    int docID, count;
+    while ((text = load_number(text, end, &docID)) != NULL && (text = load_number(text, end, &count)) != NULL) {
+        if (docID <= 0 || count <= 0) {
+            continue;
+        }
+        int n = term->numPostings;
+        if (n == 0 || term->postings[n - 1].docID < docID) { // In order: room was made above
+            term->postings[n].docID = docID;
+            term->postings[n].count = count;
+            term->numPostings++;
+            continue;
+        }
+        index_posting_t* posting = index_getPosting(index, term, docID);
+        if (posting == NULL) {
+            return false;
+        }
+        posting->count = (posting->count > INT_MAX - count) ? INT_MAX : posting->count + count;
+    }
+    return true;
+}
+
+/* Read the next space-separated number of a line into value, as atoi would (0 if it isn't one, -1
+ * if it overflows); return where the number ends, or NULL if the line has no more */
+static const char* load_number(const char* text, const char* end, int* value){
+    while (text < end && *text == ' ') {
+        text++;
+    }
+    if (text == end) {
+        return NULL;
+    }
+    bool negative = (*text == '-');
+    if (*text == '-' || *text == '+') {
+        text++;
+    }
+    long long number = 0;
+    for ( ; text < end && *text >= '0' && *text <= '9'; text++) {
+        if (number <= INT_MAX) {
+            number = number * 10 + (*text - '0');
+        }
+    }
+    *value = (number > INT_MAX) ? -1 : negative ? (int) -number : (int) number;
+    while (text < end && *text != ' ') { // Skip anything after the digits, as atoi does
+        text++;
+    }
+    return text;
+}
+
+/* qsort comparator for index_term_t pointers, by word */
+static int compare_terms(const void* a, const void* b){
+    return strcmp((*(index_term_t* const*) a)->word, (*(index_term_t* const*) b)->word);
+}
+
+/* Call wordfunc for each word in strcmp order, then postingfunc for each of its postings with
+ * count > 0, with the posting's positions if this is a positional in-memory index (else NULL);
+ * stop and return false if out of memory or a function returns false */
+static bool index_iterateSorted(index_t* index, void* arg, bool (*wordfunc)(void* arg, const char* word),
+                                bool (*postingfunc)(void* arg, const int docID, const int count,
+                                                    const int* positions),
+                                bool (*fieldfunc)(void* arg, const int field, const int docID, const int count)){
+    bool ok = true;
+    if (index->file != NULL) { // Already in order
+        bool fields = (fieldfunc != NULL && (indexfile_flags(index->file) & INDEXFILE_FIELDS) != 0);
+        index_sortedVisit_t visit = {index->file, arg, wordfunc, postingfunc, fields ? fieldfunc : NULL, true};
+        indexfile_iterateWords(index->file, 0, indexfile_numWords(index->file), &visit, visit_sortedWord);
+        return visit.ok; // Damaged words or postings just end early
+    }
+
+    index_term_t** sorted = malloc((index->numWords > 0 ? index->numWords : 1) * sizeof(index_term_t*));
+    if (sorted == NULL) {
+        return false;
+    }
+    int numWords = 0;
+    for (int slot = 0; slot < index->numSlots; slot++) {
+        if (index->terms[slot].word != NULL) {
+            sorted[numWords++] = &index->terms[slot];
+        }
+    }
+    qsort(sorted, numWords, sizeof(index_term_t*), compare_terms);
+    int* positions = NULL; // The current posting's positions, decoded
+    int capacity = 0;
+    for (int i = 0; ok && i < numWords; i++) {
+        ok = (*wordfunc)(arg, sorted[i]->word);
+        size_t offset = 0; // Where the current posting's positions start
+        for (int j = 0; ok && j < sorted[i]->numPostings; j++) {
+            index_posting_t* posting = &sorted[i]->postings[j];
+            if (index->positional && posting->count > capacity) {
+                int* grown = realloc(positions, posting->count * sizeof(int));
+                ok = (grown != NULL);
+                positions = ok ? grown : positions;
+                capacity = ok ? posting->count : capacity;
+            }
+            if (ok && index->positional && posting->count > 0) {
+                size_t used = postings_decodePositions(sorted[i]->positions + offset, sorted[i]->positionBytes - offset,
+                                                       posting->count, positions);
+                ok = (used > 0);
+                offset += used;
+            }
+            ok = ok && (posting->count <= 0 // Skip hidden postings
+                        || (*postingfunc)(arg, posting->docID, posting->count, index->positional ? positions : NULL));
+        }
+        if (ok && fieldfunc != NULL && sorted[i]->numFields > 0) {
+            ok = term_sortedFields(sorted[i], arg, fieldfunc);
+        }
+    }
+    free(positions);
+    free(sorted);
+    return ok;
+}
+
+/* Call fieldfunc on a term's field postings in order of field, then docID, those of a document in a
+ * field (from words sharing a stem) merged into one; false if out of memory or fieldfunc fails */
+static bool term_sortedFields(const index_term_t* term, void* arg,
+                              bool (*fieldfunc)(void* arg, const int field, const int docID, const int count)){
+    index_fieldPosting_t* fields = malloc(term->numFields * sizeof(index_fieldPosting_t));
+    if (fields == NULL) {
+        return false;
+    }
+    memcpy(fields, term->fields, term->numFields * sizeof(index_fieldPosting_t));
+    qsort(fields, term->numFields, sizeof(index_fieldPosting_t), compare_fieldPostings);
+    bool ok = true;
+    for (int j = 0; ok && j < term->numFields; ) {
+        int count = 0;
+        int k = j;
+        for ( ; k < term->numFields && compare_fieldPostings(&fields[j], &fields[k]) == 0; k++) {
+            count = (count > INT_MAX - fields[k].count) ? INT_MAX : count + fields[k].count;
+        }
+        ok = (*fieldfunc)(arg, fields[j].field, fields[j].docID, count);
+        j = k;
+    }
+    free(fields);
+    return ok;
+}
+
+/* qsort comparator for field postings, by field, then by docID */
+static int compare_fieldPostings(const void* a, const void* b){
+    const index_fieldPosting_t* fieldA = a;
+    const index_fieldPosting_t* fieldB = b;
+    if (fieldA->field != fieldB->field) {
+        return (fieldA->field > fieldB->field) - (fieldA->field < fieldB->field);
+    }
+    return (fieldA->docID > fieldB->docID) - (fieldA->docID < fieldB->docID);
+}
+
+/* index_iterateSorted helpers for saveIndex_toPage: a word's line starts with its first live
+ * posting, so words with none left are not printed */
+static bool text_word(void* arg, const char* word){
+    index_textLine_t* line = arg;
+    if (line->open) {
+        fputc('\n', line->fp);
+        line->open = false;
+    }
+    line->word = word;
+    return true;
+}
+
+static bool text_posting(void* arg, const int docID, const int count, const int* positions){
+    index_textLine_t* line = arg;
+    if (!line->open) {
+        fputs(line->word, line->fp);
+        line->open = true;
+    }
+    fprintf(line->fp, " %d %d", docID, count);
+    return true;
+}
+
+/* index_iterateSorted helpers for saveIndex_toBinary (the writer drops words with no postings or field postings) */
+static bool binary_word(void* arg, const char* word){
+    return indexfile_addWord(arg, word);
+}
+
+static bool binary_posting(void* arg, const int docID, const int count, const int* positions){
+    return indexfile_addPosting(arg, docID, count)
+        && (positions == NULL || indexfile_addPositions(arg, positions, count));
+}
+
+static bool binary_field(void* arg, const int field, const int docID, const int count){
+    return indexfile_addField(arg, field, docID, count);
+}
+
+/* index_iterateSorted helpers for saveIndex_range and saveIndex_terms: the shard's words, but only
+ * the range's postings (both writers leave out a word that gets none) */
+static bool range_word(void* arg, const char* word){
+    index_range_t* range = arg;
+    range->skip = (index_termShard(word, range->numShards) != range->shard);
+    return range->skip || (*range->wordfunc)(range->arg, word);
+}
+
+static bool range_posting(void* arg, const int docID, const int count, const int* positions){
+    index_range_t* range = arg;
+    return range->skip || docID < range->firstDocID || docID > range->lastDocID
+        || (*range->postingfunc)(range->arg, docID, count, positions);
+}
+
+/* A field posting goes with its document, so link text lands in the shard of the page linked to, even if
+ * the word has no posting there */
+static bool range_field(void* arg, const int field, const int docID, const int count){
+    index_range_t* range = arg;
+    return range->skip || docID < range->firstDocID || docID > range->lastDocID
+        || (*range->fieldfunc)(range->arg, field, docID, count);
+}
+
+/* Save the words and postings range lets through, as text (saveIndex_toPage) or binary */
+static bool save_index(index_t* index, char* filepath, index_range_t* range, const bool binary){
+    if (index == NULL || filepath == NULL) { // Validate parameters
+        return false;
+    }
+    if (binary) {
+        // Positions are kept if the index has them in memory (index_iterateSorted gives no others); field
+        // postings if it has them at all
+        bool fields = index_hasFields(index);
+        uint32_t flags = (stemmer_enabled() ? INDEXFILE_STEMMED : 0) | (index->positional ? INDEXFILE_POSITIONS : 0)
+                         | (fields ? INDEXFILE_FIELDS : 0);
+        indexfile_writer_t* writer = indexfile_create(filepath, flags);
+        if (writer == NULL) {
+            return false;
+        }
+        range->arg = writer;
+        range->wordfunc = binary_word;
+        range->postingfunc = binary_posting;
+        range->fieldfunc = binary_field;
+        bool ok = index_iterateSorted(index, range, range_word, range_posting, fields ? range_field : NULL);
+        return indexfile_finish(writer) && ok;
+    }
+
+    FILE* fp = fopen(filepath, "w"); // Try to open the file
+    if (fp == NULL){
+        return false;
+    }
+    // Words in sorted order, so the file doesn't depend on how the index was built
+    index_textLine_t line = {fp, NULL, false};
+    range->arg = &line;
+    range->wordfunc = text_word;
+    range->postingfunc = text_posting;
+    bool ok = index_iterateSorted(index, range, range_word, range_posting, NULL); // Text has no fields
+    if (line.open) {
+        fputc('\n', fp);
+    }
+    ok = ok && !ferror(fp);
+    return (fclose(fp) == 0) && ok;
+}
+
+/* indexfile_iterateWords helper for index_iterate, passing each word on to the caller's function */
+static bool visit_word(void* arg, const int i, const char* word){
+    index_wordVisit_t* visit = arg;
+    (*visit->itemfunc)(visit->arg, word);
+    return true;
+}
+
+/* indexfile_iterateWords helper for index_iterateSorted: the word, then its postings */
+static bool visit_sortedWord(void* arg, const int i, const char* word){
+    index_sortedVisit_t* visit = arg;
+    visit->ok = (*visit->wordfunc)(visit->arg, word);
+    if (visit->ok) {
+        indexfile_iteratePostings(visit->file, i, visit, visit_sortedPosting);
+    }
+    if (visit->ok && visit->fieldfunc != NULL) {
+        indexfile_iterateFields(visit->file, i, visit, visit_sortedField);
+    }
+    return visit->ok;
+}
+
+/* indexfile_iteratePostings helpers, passing each posting on to the caller's function */
+static bool visit_posting(void* arg, const int docID, const int count){
+    index_postingVisit_t* visit = arg;
+    (*visit->itemfunc)(visit->arg, docID, count);
+    return true;
+}
+
+static bool visit_sortedPosting(void* arg, const int docID, const int count){
+    index_sortedVisit_t* visit = arg;
+    visit->ok = (*visit->postingfunc)(visit->arg, docID, count, NULL);
+    return visit->ok;
+}
+
+/* indexfile_iterateFields helper for index_iterateSorted */
+static bool visit_sortedField(void* arg, const int field, const int docID, const int count){
+    index_sortedVisit_t* visit = arg;
+    visit->ok = (*visit->fieldfunc)(visit->arg, field, docID, count);
+    return visit->ok;
+}
+
+/* Return a new copy of cursor, its blocks counted and at its first posting; NULL if out of memory */
+static index_cursor_t* cursor_start(const index_cursor_t* cursor){
+    index_cursor_t* new = mem_malloc(sizeof(index_cursor_t));
+    if (new == NULL) {
+        return NULL;
+    }
+    *new = *cursor;
+    new->numBlocks = (new->numPostings + INDEX_CURSOR_BLOCK - 1) / INDEX_CURSOR_BLOCK;
+    new->termPosting = 0;
+    new->termOffset = 0;
+    new->positionsBlock = -1;
+    if (cursor_load(new, 0)) {
+        cursor_settle(new);
+    }
+    return new;
+}
+
+/* Return the last docID of a block of the cursor's word; INT_MAX if its skip record can't be read,
+ * so a seek stops there and finds the damage */
+static int cursor_blockLast(const index_cursor_t* cursor, const int block){
+    if (cursor->file != NULL) {
+        int lastDocID, maxCount;
+        return indexfile_blockSkip(cursor->file, cursor->word, block, &lastDocID, &maxCount) ? lastDocID : INT_MAX;
+    }
+    int end = (block + 1) * INDEX_CURSOR_BLOCK;
+    return cursor->postings[(end < cursor->numPostings ? end : cursor->numPostings) - 1].docID;
+}
+
+/* Make block the current one, at its first posting; false (and at the end) if there is no such
+ * block or it is damaged */
+static bool cursor_load(index_cursor_t* cursor, const int block){
+    cursor->block = block;
+    cursor->pos = 0;
+    cursor->blockLength = 0;
+    if (block < cursor->numBlocks) {
+        if (cursor->file != NULL) {
+            cursor->blockLength = indexfile_decodeBlock(cursor->file, cursor->word, block,
+                                                        cursor->docIDs, cursor->counts);
+        } else {
+            const index_posting_t* postings = &cursor->postings[block * INDEX_CURSOR_BLOCK];
+            int n = cursor->numPostings - block * INDEX_CURSOR_BLOCK;
+            cursor->blockLength = (n < INDEX_CURSOR_BLOCK) ? n : INDEX_CURSOR_BLOCK;
+            for (int j = 0; j < cursor->blockLength; j++) {
+                cursor->docIDs[j] = postings[j].docID;
+                cursor->counts[j] = postings[j].count;
+            }
+        }
+    }
+    if (cursor->blockLength == 0) {
+        cursor->block = cursor->numBlocks;
+        return false;
+    }
+    return true;
+}
+
+/* Move from the current position to the first posting with count > 0 (hidden postings are skipped);
+ * false if there is none */
+static bool cursor_settle(index_cursor_t* cursor){
+    while (cursor->block < cursor->numBlocks) {
+        for ( ; cursor->pos < cursor->blockLength; cursor->pos++) {
+            if (cursor->counts[cursor->pos] > 0) {
+                return true;
+            }
+        }
+        cursor_load(cursor, cursor->block + 1);
+    }
+    return false;
+}
+
+/* Find the positions of the cursor's current block, the first time they are asked for: a mapped
+ * word's from its file; an in-memory word's by passing over the positions of the postings between
+ * the last block asked for and this one. False if they are damaged */
+static bool cursor_findPositions(index_cursor_t* cursor){
+    if (cursor->positionsBlock == cursor->block) {
+        return cursor->positions != NULL;
+    }
+    cursor->positionsBlock = cursor->block;
+    cursor->positions = NULL;
+    cursor->positionsAt = 0;
+    cursor->positionsOffset = 0;
+    if (cursor->file != NULL) {
+        if (!indexfile_blockPositions(cursor->file, cursor->word, cursor->block, &cursor->positions,
+                                      &cursor->positionBytes)) {
+            cursor->positions = NULL;
+        }
+        return cursor->positions != NULL;
+    }
+    int first = cursor->block * INDEX_CURSOR_BLOCK;
+    long skipped = 0;
+    for (int j = cursor->termPosting; j < first; j++) {
+        skipped += cursor->postings[j].count;
+    }
+    if (skipped > 0) {
+        size_t used = postings_skipPositions(cursor->termPositions + cursor->termOffset,
+                                             cursor->termPositionBytes - cursor->termOffset, skipped);
+        if (used == 0) {
+            return false;
+        }
+        cursor->termOffset += used;
+    }
+    cursor->termPosting = first;
+    cursor->positions = cursor->termPositions + cursor->termOffset;
+    cursor->positionBytes = cursor->termPositionBytes - cursor->termOffset;
+    return true;
+}
+
+/* Return the first position from low in docIDs[0..n) holding at least docID (n if none), galloping:
+ * steps of 1, 2, 4... from low, then a binary search of the last step, so nearby docIDs are cheap */
+static int gallop(const int* docIDs, const int low, const int n, const int docID){
+    if (low >= n || docIDs[low] >= docID) {
+        return low;
+    }
+    int before = low;  // docIDs[before] < docID
+    int step = 1;
+    while (before + step < n && docIDs[before + step] < docID) {
+        before += step;
+        step *= 2;
+    }
+    int after = (before + step < n) ? before + step : n;  // docIDs[after] >= docID, or after == n
+    while (after - before > 1) {
+        int mid = before + (after - before) / 2;
+        if (docIDs[mid] < docID) {
+            before = mid;
+        } else {
+            after = mid;
+        }
+    }
+    return after;
+}
+
+/* indexfile_iteratePostings helper for index_cursor_newPrefix: add a posting to the gathered ones */
+static bool gather_posting(void* arg, const int docID, const int count){
+    index_gathered_t* gathered = arg;
+    if (gathered->numPostings == gathered->capacity) {
+        int capacity = (gathered->capacity == 0) ? 1024 : gathered->capacity * 2;
+        index_posting_t* postings = realloc(gathered->postings, capacity * sizeof(index_posting_t));
+        if (postings == NULL) {
+            gathered->ok = false;
+            return false;
+        }
+        gathered->postings = postings;
+        gathered->capacity = capacity;
+    }
+    gathered->postings[gathered->numPostings].docID = docID;
+    gathered->postings[gathered->numPostings].count = count;
+    gathered->numPostings++;
+    return true;
+}
+
+/* indexfile_iterateFields helper for index_cursor_newWeighted: add count, weighed by its field, to the
+ * document's; fields weighing nothing (and any the caller doesn't know) are left out */
+static bool gather_field(void* arg, const int field, const int docID, const int count){
+    index_gathered_t* gathered = arg;
+    int weight = (field < INDEX_FIELDS) ? gathered->weights[field] : 0;
+    if (weight <= 0) {
+        return true;
+    }
+    return gather_posting(gathered, docID, (count > INT_MAX / weight) ? INT_MAX : count * weight);
+}
+
+/* Gather the postings of an in-memory word (skipping hidden ones), and with weights, its field postings */
+static bool gather_term(index_gathered_t* gathered, const index_term_t* term){
+    for (int j = 0; gathered->ok && j < term->numPostings; j++) {
+        if (term->postings[j].count > 0) {
+            gather_posting(gathered, term->postings[j].docID, term->postings[j].count);
+        }
+    }
+    for (int j = 0; gathered->weights != NULL && gathered->ok && j < term->numFields; j++) {
+        gather_field(gathered, term->fields[j].field, term->fields[j].docID, term->fields[j].count);
     }
+    return gathered->ok;
 }
 
-// Wrapper function to make counters_delete compatible with hashtable_delete
-static void counters_delete_wrapper(void* item) {
-    // Cast the void* back to counters_t* before passing to counters_delete
-    counters_delete((counters_t*) item);
+/* qsort comparator for postings, by docID */
+static int compare_postings(const void* a, const void* b){
+    int docIDA = ((const index_posting_t*) a)->docID;
+    int docIDB = ((const index_posting_t*) b)->docID;
+    return (docIDA > docIDB) - (docIDA < docIDB);
 }
@@ -3,22 +3,65 @@ Author: Sasha Ries
 Date: 2/17/25
 File: index.h
 Description: header file for CS50 index module
- 
+
  * An "index" is a mapping from words to (docID, count) pairs, where each
  * pair represents the number of occurrences of that word in a given document.
- * The index is implemented as a hashtable keyed by word and storing counters
- * as items. Each counters set is keyed by docID and stores the count of
- * word occurrences in that document.
+ * The index is implemented as an open-addressing hash table of words. Each
+ * word keeps its (docID, count) postings in a contiguous array, in increasing
+ * docID order. Words and posting arrays live in an arena owned by the index,
+ * so building an index costs no malloc per word or posting, and deleting it
+ * frees a handful of large chunks instead of walking every node.
+ *
+ * An index can also be "mapped": a read-only view of a binary index file
+ * (see indexfile.h), searched in place, so opening it costs no parsing.
+ *
+ * A "positional" index also keeps where each word occurs in each document:
+ * its positions (see tokenizer_position), delta-coded after each other in a
+ * stream of each word's own (see postings.h), apart from the postings. So
+ * phrase and proximity searches can read them, while other searches, which
+ * only walk postings, never do.
+ *
+ * An index built "with fields" also notes which of a word's occurrences are
+ * in a page's title, in its headings, or in the text of links to another
+ * indexed page (credited to that page, not the one linking). Those are kept
+ * as separate, compact field postings: per word and field, a count for each
+ * document, beside its ordinary postings, which stay as they were. Searches
+ * that don't ask for fields never read them; index_cursor_newWeighted adds
+ * them in, weighed by field.
  */
 
  #ifndef __INDEX_H
  #define __INDEX_H
- 
+
  #include <stdio.h>
  #include <stdbool.h>
- #include "hashtable.h"
+ #include <stddef.h>
  #include "webpage.h"  // for webpage_t type
 
+ /**************** global constants ****************/
+ /* The fields of an index built with fields, numbering weights for index_cursor_newWeighted */
+ #define INDEX_TITLE 0     // in the page's <title>
+ #define INDEX_HEADING 1   // in an <h1> to <h6> heading
+ #define INDEX_ANCHOR 2    // in the text of a link to the document, on another page
+ #define INDEX_FIELDS 3    // how many there are
+
+ /**************** global types ****************/
+ typedef struct index index_t;  // opaque to users of the module
+ typedef struct index_cursor index_cursor_t;  // a walk over one word's postings
+
+
+ /**************** index_new ****************/
+ /* Create a new, empty index.
+  *
+  * Caller provides:
+  *   expected number of distinct words (a hint; the index grows as needed)
+  * We return:
+  *   pointer to a new index; NULL if out of memory.
+  * Caller is responsible for:
+  *   later calling index_delete().
+  */
+ index_t* index_new(const int numWords);
+
 
  /**************** indexBuild ****************/
  /* Build an index from all the webpage files in a directory.
@@ -32,27 +75,98 @@ Description: header file for CS50 index module
   * Caller is responsible for:
   *   later calling index_delete().
   */
- hashtable_t* indexBuild(char* pageDirectory);
- 
+ index_t* indexBuild(char* pageDirectory);
+
+
+ /**************** indexBuild_parallel ****************/
+ /* Build an index from all the webpage files in a directory, using several threads.
+  *
+  * Caller provides:
+  *   valid pathname to a directory containing webpage files,
+  *   number of threads to use (values < 1 are treated as 1)
+  * We return:
+  *   pointer to a new index; NULL if error (out of memory, invalid directory).
+  * We do:
+  *   split the documents into contiguous docID ranges of roughly equal bytes
+  *   (sizes come from the crawler's manifest, if any), index each range into a
+  *   thread-local partial index, then merge the partials in docID order.
+  * We guarantee:
+  *   the index is identical to the one indexBuild() returns, so saving it
+  *   produces a byte-identical index file.
+  * Caller is responsible for:
+  *   later calling index_delete().
+  */
+ index_t* indexBuild_parallel(char* pageDirectory, int numThreads);
+
+
+ /**************** indexBuild_positional ****************/
+ /* Build a positional index: indexBuild_parallel, keeping each posting's positions too.
+  *
+  * Notes:
+  *   only the binary format holds positions: saveIndex_toBinary (and the
+  *   binary forms of saveIndex_range and saveIndex_terms) write them, in a
+  *   section of the file of their own.
+  */
+ index_t* indexBuild_positional(char* pageDirectory, int numThreads);
+
+
+ /**************** index_hasPositions ****************/
+ /* Return true if index keeps positions: built by indexBuild_positional, or
+  * mapped from a file written from one. */
+ bool index_hasPositions(const index_t* index);
+
+
+ /**************** indexBuild_fields ****************/
+ /* Build an index with fields: the ordinary postings, plus field postings
+  * for words in titles, headings and link text (see the top of this file).
+  *
+  * Caller provides:
+  *   as indexBuild_parallel; positions - also keep positions (as
+  *   indexBuild_positional)
+  * We do:
+  *   resolve each link on a page against the crawled URLs (from the
+  *   directory's manifest if it has one), crediting its text to the page it
+  *   leads to; links to the page itself or to pages not crawled are body text
+  *   only.
+  * Notes:
+  *   only the binary format holds field postings; other saves, merges and
+  *   compaction keep just the ordinary postings.
+  */
+ index_t* indexBuild_fields(char* pageDirectory, int numThreads, const bool positions);
+
+
+ /**************** index_hasFields ****************/
+ /* Return true if index has field postings: built by indexBuild_fields, or
+  * mapped from a file written from one. */
+ bool index_hasFields(const index_t* index);
+
 
  /**************** indexPage ****************/
- /* Index all the words on a single webpage, incrementing counts for existing 
+ /* Index all the words on a single webpage, incrementing counts for existing
   * words and adding new words with count=1.
-  * 
+  *
   * Caller provides:
-  *   valid pointer to webpage, valid docID (must be > 0), 
+  *   valid pointer to webpage, valid docID (must be > 0),
   *   valid pointer to an existing index
   * We do:
-  *   extract all words from the webpage and add them to the index
-  *   (normalizing by converting to lowercase)
+  *   split the webpage into words with a tokenizer owned by the index
+  *   (normalizing by converting to lowercase), count them in a small table
+  *   owned by the index, then add one (docID, count) posting per distinct
+  *   word to the index, so a word repeated on the page costs one lookup in
+  *   the index rather than many
   * We guarantee:
-  *   every word from the webpage will be added to the index with the 
+  *   every word from the webpage will be added to the index with the
   *   correct docID and count
   * Notes:
+  *   words under 3 letters and stopwords (see stopword.h) are not indexed,
+  *   but still count towards the positions of the words after them.
+  *   in a positional index, the positions of each word are added too: the
+  *   page's occurrences are grouped by word (by stem, if stemming) and each
+  *   group appended to its word's positions, so this costs no lookups more.
   *   if webpage or index is NULL, function does nothing
   */
- void indexPage(webpage_t* page, const int docID, hashtable_t* index);
- 
+ void indexPage(webpage_t* page, const int docID, index_t* index);
+
 
  /**************** index_add ****************/
  /* Add a word occurrence to the index.
@@ -68,10 +182,190 @@ Description: header file for CS50 index module
   *   if the word is not in the index, add it with count=1 for the given docID
   *   if the word is in the index but not for this docID, add docID with count=1
   *   if the word is in the index for this docID, increment the count
+  * Notes:
+  *   O(1) when docID is at least the word's largest docID so far (as in
+  *   every build, which adds documents in increasing docID order); other
+  *   docIDs are found by binary search.
+  *   a positional index only grows through indexPage, which knows where the
+  *   words are: index_add and index_set return false for it.
+  */
+ bool index_add(index_t* index, const char* word, const int docID);
+
+
+ /**************** index_set ****************/
+ /* Set the count of a word in a document, adding the word or docID if needed.
+  *
+  * We return:
+  *   false if index or word is NULL, docID <= 0, count < 0, or out of memory.
+  * Notes:
+  *   a count of 0 hides the posting: it is skipped when iterating or saving.
+  *   like index_add, this is O(1) when docID is the word's largest so far.
+  */
+ bool index_set(index_t* index, const char* word, const int docID, const int count);
+
+
+ /**************** index_iterate ****************/
+ /* Call itemfunc(arg, word) once for every word in the index, in no particular order.
+  *
+  * Notes:
+  *   itemfunc may change counts with index_set but must not add words.
+  */
+ void index_iterate(index_t* index, void* arg, void (*itemfunc)(void* arg, const char* word));
+
+
+ /**************** index_iteratePostings ****************/
+ /* Call itemfunc(arg, docID, count) for every posting of word with count > 0.
+  *
+  * We return:
+  *   true if the word is in the index; false if not (or index/word is NULL).
+  * Notes:
+  *   postings come in increasing docID order.
+  *   itemfunc may be counters_set-style, so query code can copy postings.
+  */
+ bool index_iteratePostings(index_t* index, const char* word, void* arg,
+                            void (*itemfunc)(void* arg, const int docID, const int count));
+
+
+ /**************** index_cursor_new ****************/
+ /* Start a walk over the postings of word, for skipping through them by docID.
+  *
+  * We return:
+  *   a cursor at the word's first posting with count > 0 (or at the end, if
+  *   it has none); NULL if the word is not in the index or out of memory.
+  * We do:
+  *   treat the postings as blocks of up to 128 in docID order, each with its
+  *   last docID and largest count. A mapped word's blocks are those of its
+  *   file, whose skip records give both without decoding the block.
+  * Notes:
+  *   the cursor is invalid once the index changes (index_add, index_set,
+  *   indexPage) or is deleted.
+  *   Caller is responsible for later calling index_cursor_delete().
+  */
+ index_cursor_t* index_cursor_new(index_t* index, const char* word);
+
+
+ /**************** index_cursor_newPrefix ****************/
+ /* Start a walk over the documents of every word beginning with prefix.
+  *
+  * We return:
+  *   a cursor over one posting per document holding any such word, whose
+  *   count is the sum of those words' counts there; NULL if no word has the
+  *   prefix, or out of memory.
+  * We do:
+  *   for a mapped index, find the words as one run of the file's sorted,
+  *   front-coded dictionary (two binary searches); for an in-memory index,
+  *   check every word. The matching postings are gathered, sorted by docID
+  *   and merged into an array the cursor owns.
+  * Notes:
+  *   the cursor works like one from index_cursor_new, and has the same
+  *   lifetime rules; a short prefix can match many words, and costs their
+  *   postings up front.
   */
- bool index_add(hashtable_t* index, const char* word, const int docID);
+ index_cursor_t* index_cursor_newPrefix(index_t* index, const char* prefix);
+
+
+ /**************** index_cursor_newPrefixAll ****************/
+ /* Like index_cursor_newPrefix, over the words of several indexes at once
+  * (the shards of a term-partitioned index, see shard.h): a document's count
+  * is the sum of its prefix words' counts in every index. NULL if no index
+  * has a word with the prefix, if an index is NULL, or out of memory. */
+ index_cursor_t* index_cursor_newPrefixAll(index_t** indexes, const int numIndexes, const char* prefix);
+
+
+ /**************** index_cursor_newWeighted ****************/
+ /* Start a walk over word's documents in several indexes (as
+  * index_cursor_newPrefixAll; with prefix, over every word beginning with
+  * it), ranked with fields.
+  *
+  * Caller provides:
+  *   weights - INDEX_FIELDS weights, one per field (indexed by INDEX_TITLE
+  *   and the rest), or NULL for none
+  * We return:
+  *   a cursor whose count for a document is its ordinary count plus, for each
+  *   field, the field's weight times the word's count in that field there;
+  *   so a document whose only mention is in links to it is found too. NULL
+  *   if no index has the word, if an index is NULL, or out of memory.
+  * Notes:
+  *   indexes without fields, and fields weighing 0, add nothing; with NULL
+  *   weights this is index_cursor_newPrefixAll, for a whole word too. The
+  *   postings are gathered up front, as for a prefix, and the cursor has no
+  *   positions.
+  */
+ index_cursor_t* index_cursor_newWeighted(index_t** indexes, const int numIndexes, const char* word,
+                                          const bool prefix, const int* weights);
+
+
+ /**************** index_cursor_size ****************/
+ /* Return the number of postings of the cursor's word (counting hidden ones),
+  * a cost estimate for ordering cursors. */
+ int index_cursor_size(const index_cursor_t* cursor);
+
+
+ /**************** index_cursor_docID ****************/
+ /* Return the docID of the current posting; 0 once the cursor is at the end. */
+ int index_cursor_docID(const index_cursor_t* cursor);
+
+
+ /**************** index_cursor_count ****************/
+ /* Return the count of the current posting; 0 once the cursor is at the end. */
+ int index_cursor_count(const index_cursor_t* cursor);
+
+
+ /**************** index_cursor_next ****************/
+ /* Move to the next posting with count > 0.
+  *
+  * We return:
+  *   false if there is none (the cursor is then at the end).
+  */
+ bool index_cursor_next(index_cursor_t* cursor);
+
+
+ /**************** index_cursor_seek ****************/
+ /* Move forward to the first posting whose docID is at least docID (staying
+  * put if the current one is).
+  *
+  * We return:
+  *   false if there is none (the cursor is then at the end).
+  * We do:
+  *   pass over whole blocks by their last docIDs, galloping (steps of 1, 2,
+  *   4, ... blocks, then a binary search), decoding only the block that can
+  *   hold docID; then gallop within it. So seeking through a long list for
+  *   the few docIDs of a short one costs about the short list's length times
+  *   the log of the gaps, not the long list's length.
+  * Notes:
+  *   a damaged block of a mapped word ends the walk there.
+  */
+ bool index_cursor_seek(index_cursor_t* cursor, const int docID);
+
+
+ /**************** index_cursor_positions ****************/
+ /* Decode the positions of the current posting's word in its document.
+  *
+  * Caller provides:
+  *   room for index_cursor_count() positions
+  * We return:
+  *   the number of positions (the posting's count), increasing, in
+  *   positions; 0 at the end, if the index has no positions, for a prefix's
+  *   cursor, or if they are damaged.
+  * We do:
+  *   find the current block's positions the first time they are asked for
+  *   (a mapped word's from its file's positions section), then pass over
+  *   those of the postings before this one without decoding them. The
+  *   cursor only moves forward, so neither is ever done twice.
+  */
+ int index_cursor_positions(index_cursor_t* cursor, int* positions);
+
+
+ /**************** index_cursor_delete ****************/
+ /* Free a cursor. We ignore NULL. */
+ void index_cursor_delete(index_cursor_t* cursor);
+
+
+ /**************** index_memory ****************/
+ /* Return the number of bytes of heap the index occupies. */
+ size_t index_memory(const index_t* index);
+
 
- 
  /**************** save_index_toFile ****************/
  /* Save the index to a file in a specified format.
   *
@@ -83,12 +377,86 @@ Description: header file for CS50 index module
   * We guarantee:
   *   output file has one word per line with format:
   *   word docID count [docID count]...
+  *   with the words in sorted (strcmp) order, so equal indexes give
+  *   byte-identical files however they were built
   * Notes:
   *   words will be lowercase letters
   *   docIDs and counts will be positive non-zero integers
   *   items are separated by spaces
   */
- bool saveIndex_toPage(hashtable_t* index, char* filepath);
+ bool saveIndex_toPage(index_t* index, char* filepath);
+
+
+ /**************** saveIndex_toBinary ****************/
+ /* Save the index as a binary index file (see indexfile.h), for index_map.
+  *
+  * We return:
+  *   false if index or filepath is NULL or the file can't be written; true otherwise.
+  * We guarantee:
+  *   the file holds the words and postings saveIndex_toPage would write, in
+  *   the same order, and is flagged with whether this build stems words;
+  *   a positional index's file holds their positions too.
+  */
+ bool saveIndex_toBinary(index_t* index, char* filepath);
+
+
+ /**************** saveIndex_range ****************/
+ /* Save the postings of a docID range, as text (saveIndex_toPage) or binary.
+  *
+  * Caller provides:
+  *   index, filepath, the first and last docIDs to keep, and the format.
+  * We return:
+  *   false if index or filepath is NULL or the file can't be written; true otherwise.
+  * We guarantee:
+  *   the file is what saving an index holding only the range's postings would
+  *   write: words with none in the range are left out. One index can so be
+  *   written as shards of consecutive docID ranges (see shard.h).
+  */
+ bool saveIndex_range(index_t* index, char* filepath, const int firstDocID, const int lastDocID, const bool binary);
+
+
+ /**************** saveIndex_terms ****************/
+ /* Save the words of one term shard, as text (saveIndex_toPage) or binary.
+  *
+  * Caller provides:
+  *   index, filepath, the shard (0..numShards-1), the number of shards, and the format.
+  * We return:
+  *   false if index or filepath is NULL, numShards < 1, or the file can't be
+  *   written; true otherwise.
+  * We guarantee:
+  *   the file holds exactly the words w with index_termShard(w, numShards) ==
+  *   shard, each with every posting, as saving the whole index writes them.
+  */
+ bool saveIndex_terms(index_t* index, char* filepath, const int shard, const int numShards, const bool binary);
+
+
+ /**************** index_termShard ****************/
+ /* Return the term shard (0..numShards-1) that holds word: its FNV-1a hash
+  * modulo numShards, so the indexer and querier agree without a table; 0 if
+  * numShards <= 1. */
+ int index_termShard(const char* word, const int numShards);
+
+
+ /**************** index_map ****************/
+ /* Open a binary index file as a read-only index, without reading it.
+  *
+  * We return:
+  *   a mapped index; NULL if the file isn't a binary index we can map.
+  * We do:
+  *   map the file and check its header; lookups then binary search its
+  *   dictionary and iterate its postings in place. We warn on stderr if the
+  *   file was built with stemming and this program isn't, or vice versa.
+  * Notes:
+  *   a mapped index can't change: index_add and index_set return false and
+  *   indexPage does nothing. Copy it into an index_new index to change it.
+  *   Caller is responsible for later calling index_delete().
+  */
+ index_t* index_map(const char* filepath);
+
+
+ /**************** index_isMapped ****************/
+ /* Return true if index came from index_map (and so is read-only). */
+ bool index_isMapped(const index_t* index);
 
 
 /**************** load_index ****************/
@@ -96,38 +464,65 @@ Description: header file for CS50 index module
  * The file format must be:
  *   word docID count [docID count]...
  * where word is a string of lowercase letters and docID and count are positive integers.
- * 
+ *
  * We return:
- *   A pointer to a new hashtable containing the index;
+ *   A pointer to a new index;
  *   NULL on error
+ * We guarantee:
+ *   every posting keeps its count, so saving the index writes the same file
  * Notes:
+ *   lines are read into one reused buffer and parsed as parse_index_line does.
  *   Caller is responsible for later calling index_delete().
  */
- hashtable_t* load_index(FILE* fp, int size);
+ index_t* load_index(FILE* fp, int size);
+
+
+ /**************** index_load ****************/
+ /* Load a text index file (as load_index reads it) into a new index, using several threads.
+  *
+  * Caller provides:
+  *   path of a text index file; number of threads to use (values < 1 mean one
+  *   per online CPU)
+  * We return:
+  *   a new index; NULL if the file can't be read, or out of memory.
+  * We do:
+  *   map the file with mmap and split it into parts of about equal size, each
+  *   ending with a whole line (a part per thread, and at most one per MB).
+  *   Each thread parses its lines in place into a partial index, reading
+  *   numbers by hand rather than copying and tokenizing each line; then the
+  *   partials, which hold different words, are merged.
+  * We guarantee:
+  *   the index holds every word, docID and count of the file, so saving it
+  *   writes the same file.
+  * Notes:
+  *   lines are parsed as parse_index_line parses them: malformed pairs, and
+  *   pairs without a positive docID and count, are skipped.
+  *   Caller is responsible for later calling index_delete().
+  */
+ index_t* index_load(const char* filepath, int numThreads);
+
 
- 
  /**************** parse_index_line ****************/
-/* 
+/*
  * Parse a line from an index file and add the word and its documents to the index.
- * 
+ *
  * Caller provides:
  *   line - a line from an index file in format "word docID count [docID count]..." (must not be NULL)
- *   index - the hashtable representing the index (must not be NULL)
+ *   index - the index (must not be NULL)
  *
  * We do:
- *   Make a copy of the line
- *   Extract the word (first token)
- *   Extract each docID-count pair
- *   Add each document occurrence to the index
- *   Free the line copy when done
+ *   Extract the word (first token), and find or add it once
+ *   Count the docID-count pairs and grow the word's postings once to hold them
+ *   Add each pair with its count, on the end of the postings when docIDs
+ *   increase (as in every index file); a docID already there has the count added
  *
  * Notes:
  *   Silently returns if line or index is NULL
  *   Silently ignores malformed lines or invalid docID/count values
- *   Uses strtok() to parse the line, which modifies the string
+ *   The line is not modified
  *   Only counts with positive values are added to the index
  */
- void parse_index_line(char* line, hashtable_t* index);
+ void parse_index_line(char* line, index_t* index);
 
 
   /**************** index_delete ****************/
@@ -136,11 +531,11 @@ Description: header file for CS50 index module
   * Caller provides:
   *   valid pointer to an index
   * We do:
-  *   free all memory associated with this index, including the 
-  *   hashtable, all words, all counters, and the index itself
+  *   free the word table and the arena holding every word and posting,
+  *   or unmap the file of a mapped index
   * Notes:
   *   we ignore NULL index
   */
- void index_delete(hashtable_t* index);
- 
- #endif // __INDEX_H
\ No newline at end of file
+ void index_delete(index_t* index);
+
+ #endif // __INDEX_H
@@ -0,0 +1,1288 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: indexfile.c
+Description: (CS-50) Module to write binary index files and search them in place through mmap.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // for getline, mmap
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "indexfile.h"
+#include "postings.h"
+#include "crc32c.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const char INDEXFILE_MAGIC[4] = {'T', 'S', 'E', 'I'};
+static const uint32_t INDEXFILE_VERSION = 7;  // 1 had uncompressed postings, 2 no skips, 3 whole words, 4 no
+                                              // checksums, 5 no positions, 6 no fields
+static const uint32_t INDEXFILE_WORD_BLOCK = 16;  // words per front-coded block
+static const size_t INDEXFILE_MAX_SHARED = 255;   // longest prefix a word can share (it is one byte)
+static const uint32_t INDEXFILE_CHUNK = 1 << 16;  // bytes per checksummed chunk
+static const size_t INDEXFILE_MAX_VARINT = 5;     // bytes a uint32 takes at most as a varint
+
+/* What is known of a chunk of a mapped file */
+enum { CHUNK_UNCHECKED = 0, CHUNK_GOOD, CHUNK_DAMAGED };
+
+/**************** local types ****************/
+typedef struct indexfile_header {
+    char magic[4];            // "TSEI"
+    uint32_t version;         // INDEXFILE_VERSION
+    uint32_t flags;           // INDEXFILE_STEMMED, ...
+    uint32_t numWords;        // entries in the counts section
+    uint32_t maxWordBytes;    // longest word, with its NUL
+    uint32_t wordBlock;       // words per front-coded block
+    uint32_t chunkBytes;      // bytes per checksummed chunk
+    uint32_t headerCrc;       // CRC-32C of the header (with this field 0), then of the checksums
+    uint64_t numPostings;     // postings of all the words
+    uint64_t postingsOffset;  // file offsets of the sections
+    uint64_t postingsBytes;   // not counting the POSTINGS_PADDING bytes after them
+    uint64_t wordsOffset;
+    uint64_t wordBytes;
+    uint64_t skipsOffset;
+    uint64_t numBlocks;       // records in the skips section
+    uint64_t dictOffset;      // one record per block of words
+    uint64_t countsOffset;
+    uint64_t positionBlocksOffset; // with INDEXFILE_POSITIONS, one record per skip record
+    uint64_t positionsOffset;
+    uint64_t positionsBytes;
+    uint64_t fieldOffsetsOffset; // with INDEXFILE_FIELDS, one record per word and one more
+    uint64_t fieldsOffset;
+    uint64_t fieldsBytes;     // not counting the POSTINGS_PADDING bytes after them
+    uint64_t checksumsOffset; // one CRC-32C per chunk of the sections before it
+    uint64_t numChunks;
+    uint64_t fileSize;        // so a truncated file is caught at open
+} indexfile_header_t;
+
+/* The skip record of one block of postings */
+typedef struct indexfile_skip {
+    uint64_t offset;          // of the block in the postings section
+    int32_t lastDocID;        // largest docID in the block
+    int32_t maxCount;         // largest count in the block
+} indexfile_skip_t;
+
+/* The dictionary record of one block of words */
+typedef struct indexfile_wordBlock {
+    uint64_t wordOffset;      // of its first word, whole, in the words section
+    uint64_t firstBlock;      // index of the first skip record of its first word
+} indexfile_wordBlock_t;
+
+/* One field posting of the word being written */
+typedef struct indexfile_field {
+    int field;
+    int docID;
+    int count;
+} indexfile_field_t;
+
+/* The checksum state of a mapped file's chunks; threads searching the file share it */
+typedef struct indexfile_checks {
+    atomic_bool reported;     // damage was reported
+    _Atomic uint8_t state[];  // CHUNK_UNCHECKED, ... of each chunk
+} indexfile_checks_t;
+
+/**************** global types ****************/
+typedef struct indexfile {
+    const char* map;          // the whole file
+    size_t size;
+    const indexfile_header_t* header;
+    const uint8_t* postings;
+    const char* words;
+    const indexfile_skip_t* skips;
+    const indexfile_wordBlock_t* dict;
+    const uint32_t* counts;   // postings of each word
+    const uint64_t* positionBlocks; // offset of each block's positions; NULL without INDEXFILE_POSITIONS
+    const uint8_t* positions;
+    const uint64_t* fieldOffsets; // offset of each word's field postings; NULL without INDEXFILE_FIELDS
+    const uint8_t* fields;
+    const uint32_t* checksums;
+    uint64_t numWordBlocks;
+    indexfile_checks_t* checks;
+    char* path;               // for reporting damage
+} indexfile_t;
+
+typedef struct indexfile_writer {
+    FILE* fp;
+    char* path;               // removed if the file can't be finished
+    uint32_t flags;
+    uint64_t numPostings;     // written so far
+    uint64_t postingsBytes;
+    indexfile_skip_t* skips;  // skip records, kept until the postings are all written
+    size_t numBlocks;
+    size_t skipCapacity;
+    indexfile_wordBlock_t* dict;  // dictionary, likewise
+    size_t numWordBlocks;
+    size_t dictCapacity;
+    uint32_t* counts;         // postings of each word kept, likewise
+    size_t numWords;
+    size_t countCapacity;
+    char* words;              // words section, likewise
+    size_t wordBytes;
+    size_t wordCapacity;
+    uint32_t maxWordBytes;
+    char* last;               // the last word kept, whole, which the next one is coded against
+    size_t lastCapacity;
+    char* current;            // the word being added; kept once it has postings
+    size_t currentCapacity;
+    bool open;                // there is a current word
+    uint32_t currentPostings;
+    size_t currentFirstBlock; // index of the current word's first skip record
+    int lastDocID;            // of the current word
+    int blockDocIDs[POSTINGS_BLOCK];  // postings of the current word not yet encoded
+    int blockCounts[POSTINGS_BLOCK];
+    int blockLength;
+    int blockPrevDocID;       // last docID of the word's previous block, or 0
+    uint8_t* positions;       // with INDEXFILE_POSITIONS, the positions section, kept until the end
+    size_t positionBytes;
+    size_t positionCapacity;
+    uint64_t* positionBlocks; // offset of each block's positions in it
+    size_t positionBlockCapacity;
+    uint64_t blockPositions;  // offset of the current block's positions
+    int pendingPositions;     // count of the last posting, whose positions are due; 0 if none
+    indexfile_field_t* currentFields; // with INDEXFILE_FIELDS, the current word's field postings
+    size_t numCurrentFields;
+    size_t currentFieldCapacity;
+    uint8_t* fields;          // the fields section, kept until the end
+    size_t fieldBytes;
+    size_t fieldCapacity;
+    uint64_t* fieldOffsets;   // offset of each word's field postings in it
+    size_t fieldOffsetCapacity;
+    uint32_t* checksums;      // of each chunk written
+    size_t numChunks;
+    size_t checksumCapacity;
+    uint32_t chunkCrc;        // of the chunk being written
+    uint32_t chunkFill;       // bytes of it written
+    bool ok;                  // false after any error
+} indexfile_writer_t;
+
+/**************** local functions ****************/
+static bool writer_closeWord(indexfile_writer_t* writer);
+static bool writer_keepWord(indexfile_writer_t* writer);
+static bool writer_keepFields(indexfile_writer_t* writer);
+static bool writer_flushBlock(indexfile_writer_t* writer);
+static bool writer_write(indexfile_writer_t* writer, const void* data, const size_t length);
+static bool writer_padding(indexfile_writer_t* writer, const uint64_t count);
+static bool grow(void* array, size_t* capacity, const size_t needed, const size_t itemSize);
+static uint32_t header_crc(const indexfile_header_t* header, const uint32_t* checksums);
+static bool file_check(const indexfile_t* file, const uint64_t offset, const uint64_t length);
+static uint8_t chunk_verify(const indexfile_t* file, const uint64_t chunk);
+static const indexfile_skip_t* file_skip(const indexfile_t* file, const int i, const int block);
+static bool words_check(const indexfile_t* file, const uint64_t wordBlock);
+static bool words_head(const indexfile_t* file, const uint64_t wordBlock, char* word, size_t* len, uint64_t* pos);
+static bool words_next(const indexfile_t* file, char* word, size_t* len, uint64_t* pos);
+static int words_search(const indexfile_t* file, const char* key, const size_t n, const bool after, char* word);
+static bool parse_int(char** cursor, long* value);
+static size_t varint_put(uint32_t value, uint8_t* out);
+static size_t varint_get(const uint8_t* in, const size_t avail, uint32_t* value);
+
+
+/**************** global functions ****************/
+bool indexfile_is(const char* path){
+    if (path == NULL) {
+        return false;
+    }
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    char magic[4];
+    bool is = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, INDEXFILE_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return is;
+}
+
+indexfile_writer_t* indexfile_create(const char* path, const uint32_t flags){
+    if (path == NULL) {
+        return NULL;
+    }
+    indexfile_writer_t* writer = mem_calloc(1, sizeof(indexfile_writer_t));
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->path = mem_malloc(strlen(path) + 1);
+    writer->fp = fopen(path, "wb");
+    if (writer->path == NULL || writer->fp == NULL) {
+        if (writer->fp != NULL) {
+            fclose(writer->fp);
+            remove(path);
+        }
+        mem_free(writer->path);
+        mem_free(writer);
+        return NULL;
+    }
+    strcpy(writer->path, path);
+    writer->flags = flags;
+
+    // Reserve room for the header; the postings follow it
+    indexfile_header_t header;
+    memset(&header, 0, sizeof(header));
+    writer->ok = fwrite(&header, sizeof(header), 1, writer->fp) == 1;
+    return writer;
+}
+
+bool indexfile_addWord(indexfile_writer_t* writer, const char* word){
+    if (writer == NULL || word == NULL || word[0] == '\0' || !writer->ok || !writer_closeWord(writer)) {
+        return false;
+    }
+    // Words must come in increasing order, so the dictionary can be binary searched
+    size_t len = strlen(word);
+    if ((writer->numWords > 0 && strcmp(writer->last, word) >= 0) || len >= UINT32_MAX
+        || !grow(&writer->current, &writer->currentCapacity, len + 1, 1)) {
+        writer->ok = false;
+        return false;
+    }
+    memcpy(writer->current, word, len + 1);
+    writer->open = true;
+    writer->currentPostings = 0;
+    writer->currentFirstBlock = writer->numBlocks;
+    writer->lastDocID = 0;
+    writer->blockPrevDocID = 0;
+    writer->numCurrentFields = 0;
+    return true;
+}
+
+bool indexfile_addPosting(indexfile_writer_t* writer, const int docID, const int count){
+    if (writer == NULL || !writer->ok || !writer->open || docID <= writer->lastDocID || count < 1) {
+        return false;
+    }
+    if (writer->pendingPositions > 0) { // The last posting's positions never came
+        writer->ok = false;
+        return false;
+    }
+    if (writer->blockLength == 0) {
+        writer->blockPositions = writer->positionBytes;
+    }
+    writer->blockDocIDs[writer->blockLength] = docID;
+    writer->blockCounts[writer->blockLength] = count;
+    if (++writer->blockLength == POSTINGS_BLOCK && !writer_flushBlock(writer)) {
+        return false;
+    }
+    writer->currentPostings++;
+    writer->numPostings++;
+    writer->lastDocID = docID;
+    writer->pendingPositions = (writer->flags & INDEXFILE_POSITIONS) ? count : 0;
+    return true;
+}
+
+bool indexfile_addPositions(indexfile_writer_t* writer, const int* positions, const int n){
+    if (writer == NULL || positions == NULL || !writer->ok || n < 1 || n != writer->pendingPositions) {
+        return false;
+    }
+    for (int j = 0; j < n; j++) {
+        if (positions[j] < 0 || (j > 0 && positions[j] <= positions[j - 1])) {
+            return false;
+        }
+    }
+    if (!grow(&writer->positions, &writer->positionCapacity,
+              writer->positionBytes + POSTINGS_MAX_POSITION_BYTES(n), 1)) {
+        writer->ok = false;
+        return false;
+    }
+    writer->positionBytes += postings_encodePositions(positions, n, writer->positions + writer->positionBytes);
+    writer->pendingPositions = 0;
+    return true;
+}
+
+bool indexfile_addField(indexfile_writer_t* writer, const int field, const int docID, const int count){
+    if (writer == NULL || !writer->ok || !writer->open || (writer->flags & INDEXFILE_FIELDS) == 0
+        || field < 0 || field >= INDEXFILE_MAX_FIELDS || docID < 1 || count < 1) {
+        return false;
+    }
+    if (writer->numCurrentFields > 0) { // In (field, docID) order
+        const indexfile_field_t* last = &writer->currentFields[writer->numCurrentFields - 1];
+        if (field < last->field || (field == last->field && docID <= last->docID)) {
+            return false;
+        }
+    }
+    if (!grow(&writer->currentFields, &writer->currentFieldCapacity, writer->numCurrentFields + 1,
+              sizeof(indexfile_field_t))) {
+        writer->ok = false;
+        return false;
+    }
+    writer->currentFields[writer->numCurrentFields++] = (indexfile_field_t) {field, docID, count};
+    return true;
+}
+
+bool indexfile_finish(indexfile_writer_t* writer){
+    if (writer == NULL) {
+        return false;
+    }
+    bool ok = writer_closeWord(writer) && writer->numWords <= INT_MAX;
+
+    indexfile_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEXFILE_MAGIC, sizeof(header.magic));
+    header.version = INDEXFILE_VERSION;
+    header.flags = writer->flags;
+    header.numWords = writer->numWords;
+    header.maxWordBytes = writer->maxWordBytes;
+    header.wordBlock = INDEXFILE_WORD_BLOCK;
+    header.numPostings = writer->numPostings;
+    header.postingsOffset = sizeof(indexfile_header_t);
+    header.postingsBytes = writer->postingsBytes;
+    header.wordsOffset = header.postingsOffset + header.postingsBytes + POSTINGS_PADDING;
+    header.wordBytes = writer->wordBytes;
+    header.skipsOffset = (header.wordsOffset + header.wordBytes + 7) & ~(uint64_t) 7;
+    header.numBlocks = writer->numBlocks;
+    header.dictOffset = header.skipsOffset + header.numBlocks * sizeof(indexfile_skip_t);
+    header.countsOffset = header.dictOffset + writer->numWordBlocks * sizeof(indexfile_wordBlock_t);
+    header.positionBlocksOffset = header.countsOffset + writer->numWords * sizeof(uint32_t);
+    header.positionsOffset = header.positionBlocksOffset;
+    header.positionsBytes = 0;
+    if (writer->flags & INDEXFILE_POSITIONS) {
+        header.positionBlocksOffset = (header.positionBlocksOffset + 7) & ~(uint64_t) 7;
+        header.positionsOffset = header.positionBlocksOffset + header.numBlocks * sizeof(uint64_t);
+        header.positionsBytes = writer->positionBytes;
+    }
+    uint64_t positionsEnd = header.positionsOffset + header.positionsBytes;
+    header.fieldOffsetsOffset = positionsEnd;
+    header.fieldsOffset = positionsEnd;
+    header.fieldsBytes = 0;
+    uint64_t fieldsEnd = positionsEnd;
+    if (writer->flags & INDEXFILE_FIELDS) {
+        header.fieldOffsetsOffset = (positionsEnd + 7) & ~(uint64_t) 7;
+        header.fieldsOffset = header.fieldOffsetsOffset + (writer->numWords + 1) * sizeof(uint64_t);
+        header.fieldsBytes = writer->fieldBytes;
+        fieldsEnd = header.fieldsOffset + header.fieldsBytes + POSTINGS_PADDING;
+        ok = ok && grow(&writer->fieldOffsets, &writer->fieldOffsetCapacity, writer->numWords + 1, sizeof(uint64_t));
+        if (ok) {
+            writer->fieldOffsets[writer->numWords] = writer->fieldBytes; // Where the last word's run ends
+        }
+    }
+    header.checksumsOffset = (fieldsEnd + 3) & ~(uint64_t) 3;
+    header.chunkBytes = INDEXFILE_CHUNK;
+    header.numChunks = (header.checksumsOffset - header.postingsOffset + INDEXFILE_CHUNK - 1) / INDEXFILE_CHUNK;
+    header.fileSize = header.checksumsOffset + header.numChunks * sizeof(uint32_t);
+
+    // Padding for the decoder, words, padding, skips, dictionary, counts, any positions and fields, each chunk's
+    // checksum as it fills; then the checksums, and the header now that the sizes are known
+    uint64_t countsEnd = header.countsOffset + writer->numWords * sizeof(uint32_t);
+    ok = ok && writer_padding(writer, POSTINGS_PADDING)
+        && writer_write(writer, writer->words, writer->wordBytes)
+        && writer_padding(writer, header.skipsOffset - header.wordsOffset - header.wordBytes)
+        && writer_write(writer, writer->skips, writer->numBlocks * sizeof(indexfile_skip_t))
+        && writer_write(writer, writer->dict, writer->numWordBlocks * sizeof(indexfile_wordBlock_t))
+        && writer_write(writer, writer->counts, writer->numWords * sizeof(uint32_t));
+    if (writer->flags & INDEXFILE_POSITIONS) {
+        ok = ok && writer_padding(writer, header.positionBlocksOffset - countsEnd)
+            && writer_write(writer, writer->positionBlocks, writer->numBlocks * sizeof(uint64_t))
+            && writer_write(writer, writer->positions, writer->positionBytes);
+    }
+    if (writer->flags & INDEXFILE_FIELDS) {
+        ok = ok && writer_padding(writer, header.fieldOffsetsOffset - positionsEnd)
+            && writer_write(writer, writer->fieldOffsets, (writer->numWords + 1) * sizeof(uint64_t))
+            && writer_write(writer, writer->fields, writer->fieldBytes)
+            && writer_padding(writer, POSTINGS_PADDING);
+    }
+    ok = ok && writer_padding(writer, header.checksumsOffset - fieldsEnd);
+    if (ok && writer->chunkFill > 0) { // The last chunk is short
+        ok = grow(&writer->checksums, &writer->checksumCapacity, writer->numChunks + 1, sizeof(uint32_t));
+        if (ok) {
+            writer->checksums[writer->numChunks++] = writer->chunkCrc;
+        }
+    }
+    ok = ok && writer->numChunks == header.numChunks;
+    if (ok) {
+        header.headerCrc = header_crc(&header, writer->checksums);
+    }
+    ok = ok && fwrite(writer->checksums, sizeof(uint32_t), writer->numChunks, writer->fp) == writer->numChunks
+        && fseek(writer->fp, 0, SEEK_SET) == 0
+        && fwrite(&header, sizeof(header), 1, writer->fp) == 1;
+    ok = (fclose(writer->fp) == 0) && ok;
+    if (!ok) {
+        remove(writer->path);
+    }
+    free(writer->skips);
+    free(writer->dict);
+    free(writer->counts);
+    free(writer->words);
+    free(writer->checksums);
+    free(writer->positions);
+    free(writer->positionBlocks);
+    free(writer->currentFields);
+    free(writer->fields);
+    free(writer->fieldOffsets);
+    free(writer->last);
+    free(writer->current);
+    mem_free(writer->path);
+    mem_free(writer);
+    return ok;
+}
+
+bool indexfile_fromText(const char* textPath, const char* path, const uint32_t flags){
+    if (textPath == NULL || path == NULL) {
+        return false;
+    }
+    FILE* fp = fopen(textPath, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    indexfile_writer_t* writer = indexfile_create(path, flags);
+    bool ok = (writer != NULL);
+    char* line = NULL;
+    size_t lineSize = 0;
+    while (ok && getline(&line, &lineSize, fp) != -1) {
+        // word docID count [docID count]...
+        char* cursor = line;
+        char* word = cursor;
+        while (*cursor != ' ' && *cursor != '\n' && *cursor != '\0') {
+            cursor++;
+        }
+        if (cursor == word) {
+            continue; // Blank line
+        }
+        bool more = (*cursor == ' ');
+        *cursor++ = '\0';
+        ok = indexfile_addWord(writer, word);
+        long docID, count;
+        while (ok && more && parse_int(&cursor, &docID)) {
+            ok = parse_int(&cursor, &count) && docID <= INT32_MAX && count <= INT32_MAX
+                && indexfile_addPosting(writer, docID, count);
+        }
+        while (*cursor == ' ') {
+            cursor++;
+        }
+        ok = ok && (*cursor == '\n' || *cursor == '\0'); // Nothing left over
+    }
+    ok = ok && !ferror(fp);
+    free(line);
+    fclose(fp);
+    if (writer != NULL && !ok) {
+        writer->ok = false; // Let indexfile_finish remove the partial file
+    }
+    return indexfile_finish(writer) && ok;
+}
+
+indexfile_t* indexfile_open(const char* path){
+    if (path == NULL) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(indexfile_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    // Check the header and the checksums against its checksum, then that every section lies inside the file
+    const indexfile_header_t* header = map;
+    uint64_t size = st.st_size;
+    bool ok = memcmp(header->magic, INDEXFILE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == INDEXFILE_VERSION
+        && header->fileSize == size
+        && header->checksumsOffset % 4 == 0 && header->checksumsOffset <= size
+        && header->numChunks == (size - header->checksumsOffset) / sizeof(uint32_t);
+    if (ok && header_crc(header, (const uint32_t*) ((const char*) map + header->checksumsOffset))
+        != header->headerCrc) {
+        fprintf(stderr, "Error: index file %s is damaged: its header does not match its checksum\n", path);
+        ok = false;
+    }
+    uint64_t numWordBlocks = (header->wordBlock == 0) ? 0
+        : ((uint64_t) header->numWords + header->wordBlock - 1) / header->wordBlock;
+    ok = ok && header->numWords <= INT_MAX && header->wordBlock > 0
+        && header->chunkBytes > 0 && header->postingsOffset <= header->checksumsOffset
+        && header->numChunks == (header->checksumsOffset - header->postingsOffset + header->chunkBytes - 1)
+            / header->chunkBytes
+        && header->postingsOffset % 8 == 0 && header->skipsOffset % 8 == 0 && header->dictOffset % 8 == 0
+        && header->countsOffset % 4 == 0
+        && header->postingsOffset <= size && header->postingsBytes <= size - header->postingsOffset
+        && POSTINGS_PADDING <= size - header->postingsOffset - header->postingsBytes
+        && header->wordsOffset <= size && header->wordBytes <= size - header->wordsOffset
+        && (header->wordBytes == 0 || ((const char*) map)[header->wordsOffset + header->wordBytes - 1] == '\0')
+        && (header->numWords == 0 || (header->maxWordBytes > 0 && header->maxWordBytes <= header->wordBytes))
+        && header->skipsOffset <= size && header->numBlocks <= (size - header->skipsOffset) / sizeof(indexfile_skip_t)
+        && header->dictOffset <= size && numWordBlocks <= (size - header->dictOffset) / sizeof(indexfile_wordBlock_t)
+        && header->countsOffset <= size && header->numWords <= (size - header->countsOffset) / sizeof(uint32_t)
+        && ((header->flags & INDEXFILE_POSITIONS) == 0
+            || (header->positionBlocksOffset % 8 == 0 && header->positionBlocksOffset <= header->checksumsOffset
+                && header->numBlocks <= (header->checksumsOffset - header->positionBlocksOffset) / sizeof(uint64_t)
+                && header->positionsOffset <= header->checksumsOffset
+                && header->positionsBytes <= header->checksumsOffset - header->positionsOffset))
+        && ((header->flags & INDEXFILE_FIELDS) == 0
+            || (header->fieldOffsetsOffset % 8 == 0 && header->fieldOffsetsOffset <= header->checksumsOffset
+                && header->numWords < (header->checksumsOffset - header->fieldOffsetsOffset) / sizeof(uint64_t)
+                && header->fieldsOffset <= header->checksumsOffset
+                && header->fieldsBytes <= header->checksumsOffset - header->fieldsOffset
+                && POSTINGS_PADDING <= header->checksumsOffset - header->fieldsOffset - header->fieldsBytes));
+    indexfile_t* file = ok ? mem_malloc(sizeof(indexfile_t)) : NULL;
+    indexfile_checks_t* checks = ok ? calloc(1, sizeof(indexfile_checks_t) + header->numChunks) : NULL;
+    char* copy = ok ? mem_malloc(strlen(path) + 1) : NULL;
+    if (file == NULL || checks == NULL || copy == NULL) {
+        mem_free(file);
+        free(checks);
+        mem_free(copy);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    file->map = map;
+    file->size = st.st_size;
+    file->header = header;
+    file->postings = (const uint8_t*) (file->map + header->postingsOffset);
+    file->words = file->map + header->wordsOffset;
+    file->skips = (const indexfile_skip_t*) (file->map + header->skipsOffset);
+    file->dict = (const indexfile_wordBlock_t*) (file->map + header->dictOffset);
+    file->counts = (const uint32_t*) (file->map + header->countsOffset);
+    file->positionBlocks = NULL;
+    file->positions = NULL;
+    if (header->flags & INDEXFILE_POSITIONS) {
+        file->positionBlocks = (const uint64_t*) (file->map + header->positionBlocksOffset);
+        file->positions = (const uint8_t*) (file->map + header->positionsOffset);
+    }
+    file->fieldOffsets = NULL;
+    file->fields = NULL;
+    if (header->flags & INDEXFILE_FIELDS) {
+        file->fieldOffsets = (const uint64_t*) (file->map + header->fieldOffsetsOffset);
+        file->fields = (const uint8_t*) (file->map + header->fieldsOffset);
+    }
+    file->checksums = (const uint32_t*) (file->map + header->checksumsOffset);
+    file->numWordBlocks = numWordBlocks;
+    atomic_init(&checks->reported, false);
+    for (uint64_t c = 0; c < header->numChunks; c++) {
+        atomic_init(&checks->state[c], CHUNK_UNCHECKED);
+    }
+    file->checks = checks;
+    strcpy(copy, path);
+    file->path = copy;
+    return file;
+}
+
+uint32_t indexfile_flags(const indexfile_t* file){
+    return file == NULL ? 0 : file->header->flags;
+}
+
+int indexfile_numWords(const indexfile_t* file){
+    return file == NULL ? 0 : (int) file->header->numWords;
+}
+
+int indexfile_maxWordBytes(const indexfile_t* file){
+    return (file == NULL || file->header->maxWordBytes == 0) ? 1 : (int) file->header->maxWordBytes;
+}
+
+bool indexfile_word(const indexfile_t* file, const int i, char* word){
+    if (file == NULL || word == NULL || i < 0 || (uint32_t) i >= file->header->numWords) {
+        return false;
+    }
+    size_t len;
+    uint64_t pos;
+    bool ok = words_head(file, i / file->header->wordBlock, word, &len, &pos);
+    for (uint32_t j = 0; ok && j < i % file->header->wordBlock; j++) {
+        ok = words_next(file, word, &len, &pos);
+    }
+    return ok;
+}
+
+bool indexfile_iterateWords(const indexfile_t* file, const int first, const int end, void* arg,
+                            bool (*itemfunc)(void* arg, const int i, const char* word)){
+    if (file == NULL || itemfunc == NULL || first < 0 || end > indexfile_numWords(file)) {
+        return false;
+    }
+    char* word = malloc(indexfile_maxWordBytes(file));
+    if (word == NULL) {
+        return false;
+    }
+    uint32_t wordBlock = file->header->wordBlock;
+    bool ok = true;
+    size_t len = 0;
+    uint64_t pos = 0;
+    for (int i = first; ok && i < end; i++) {
+        uint32_t at = i % wordBlock;
+        if (i == first || at == 0) { // Start from the head of i's block
+            ok = words_head(file, i / wordBlock, word, &len, &pos);
+            for (uint32_t j = 0; ok && j < at; j++) {
+                ok = words_next(file, word, &len, &pos);
+            }
+        } else { // Each word after is coded against the one before
+            ok = words_next(file, word, &len, &pos);
+        }
+        ok = ok && (*itemfunc)(arg, i, word);
+    }
+    free(word);
+    return ok;
+}
+
+int indexfile_find(const indexfile_t* file, const char* word){
+    if (file == NULL || word == NULL || file->header->numWords == 0) {
+        return -1;
+    }
+    char* found = malloc(indexfile_maxWordBytes(file));
+    if (found == NULL) {
+        return -1;
+    }
+    int i = words_search(file, word, SIZE_MAX, false, found);
+    if (i >= (int) file->header->numWords || (i >= 0 && strcmp(found, word) != 0)) {
+        i = -1;
+    }
+    free(found);
+    return i;
+}
+
+int indexfile_findPrefix(const indexfile_t* file, const char* prefix, int* first){
+    if (file == NULL || prefix == NULL || first == NULL || file->header->numWords == 0) {
+        return 0;
+    }
+    char* word = malloc(indexfile_maxWordBytes(file));
+    if (word == NULL) {
+        return 0;
+    }
+    size_t n = strlen(prefix);
+    int start = words_search(file, prefix, n, false, word);
+    int end = words_search(file, prefix, n, true, word);
+    free(word);
+    if (start < 0 || end < start) {
+        return 0; // Damaged
+    }
+    *first = start;
+    return end - start;
+}
+
+int indexfile_numPostings(const indexfile_t* file, const int i){
+    if (file == NULL || i < 0 || (uint32_t) i >= file->header->numWords
+        || !file_check(file, file->header->countsOffset + (uint64_t) i * sizeof(uint32_t), sizeof(uint32_t))
+        || file->counts[i] > file->header->numPostings || file->counts[i] > INT_MAX) {
+        return 0;
+    }
+    return file->counts[i];
+}
+
+int indexfile_numBlocks(const indexfile_t* file, const int i){
+    return (indexfile_numPostings(file, i) + POSTINGS_BLOCK - 1) / POSTINGS_BLOCK;
+}
+
+bool indexfile_blockSkip(const indexfile_t* file, const int i, const int block, int* lastDocID, int* maxCount){
+    const indexfile_skip_t* skip = file_skip(file, i, block);
+    if (skip == NULL) {
+        return false;
+    }
+    *lastDocID = skip->lastDocID;
+    *maxCount = skip->maxCount;
+    return true;
+}
+
+int indexfile_decodeBlock(const indexfile_t* file, const int i, const int block, int* docIDs, int* counts){
+    const indexfile_skip_t* skip = file_skip(file, i, block);
+    if (skip == NULL || skip->offset > file->header->postingsBytes) {
+        return 0;
+    }
+    // The block ends where the next one (of this word or the next) starts; check its bytes
+    uint64_t next = skip - file->skips + 1;
+    uint64_t end = file->header->postingsBytes;
+    if (next < file->header->numBlocks) {
+        if (!file_check(file, file->header->skipsOffset + next * sizeof(indexfile_skip_t), sizeof(indexfile_skip_t))) {
+            return 0;
+        }
+        end = skip[1].offset;
+    }
+    if (end < skip->offset || end > file->header->postingsBytes
+        || !file_check(file, file->header->postingsOffset + skip->offset, end - skip->offset)) {
+        return 0;
+    }
+    int prevDocID = (block == 0) ? 0 : skip[-1].lastDocID;
+    int n = indexfile_numPostings(file, i) - block * POSTINGS_BLOCK;
+    if (n > POSTINGS_BLOCK) {
+        n = POSTINGS_BLOCK;
+    }
+    if (postings_decode(file->postings + skip->offset, file->header->postingsBytes - skip->offset, n,
+                        prevDocID, docIDs, counts) == 0) {
+        return 0; // Runs off the section
+    }
+    // The writer only writes increasing docIDs and positive counts, ending at the block's lastDocID
+    for (int j = 0; j < n; j++) {
+        if (docIDs[j] <= prevDocID || counts[j] < 1 || counts[j] > skip->maxCount) {
+            return 0;
+        }
+        prevDocID = docIDs[j];
+    }
+    return (prevDocID == skip->lastDocID) ? n : 0;
+}
+
+bool indexfile_iteratePostings(const indexfile_t* file, const int i, void* arg,
+                               bool (*itemfunc)(void* arg, const int docID, const int count)){
+    int numBlocks = indexfile_numBlocks(file, i);
+    if (itemfunc == NULL) {
+        return false;
+    }
+    if (numBlocks == 0) { // Sound only for a word of the file whose count is 0: it has field postings alone
+        return file != NULL && i >= 0 && (uint32_t) i < file->header->numWords
+            && file_check(file, file->header->countsOffset + (uint64_t) i * sizeof(uint32_t), sizeof(uint32_t))
+            && file->counts[i] == 0;
+    }
+    int docIDs[POSTINGS_BLOCK];
+    int counts[POSTINGS_BLOCK];
+    for (int block = 0; block < numBlocks; block++) {
+        int n = indexfile_decodeBlock(file, i, block, docIDs, counts);
+        if (n == 0) {
+            return false; // Damaged
+        }
+        for (int j = 0; j < n; j++) {
+            if (!(*itemfunc)(arg, docIDs[j], counts[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool indexfile_blockPositions(const indexfile_t* file, const int i, const int block,
+                              const uint8_t** positions, size_t* length){
+    if (file == NULL || file->positions == NULL || positions == NULL || length == NULL) {
+        return false;
+    }
+    const indexfile_skip_t* skip = file_skip(file, i, block);
+    if (skip == NULL) {
+        return false;
+    }
+    // The block's positions end where the next block's (of this word or the next) start
+    const indexfile_header_t* header = file->header;
+    uint64_t b = skip - file->skips;
+    bool last = (b + 1 == header->numBlocks);
+    if (!file_check(file, header->positionBlocksOffset + b * sizeof(uint64_t), (last ? 1 : 2) * sizeof(uint64_t))) {
+        return false;
+    }
+    uint64_t start = file->positionBlocks[b];
+    uint64_t end = last ? header->positionsBytes : file->positionBlocks[b + 1];
+    if (start > end || end > header->positionsBytes || !file_check(file, header->positionsOffset + start, end - start)) {
+        return false;
+    }
+    *positions = file->positions + start;
+    *length = end - start;
+    return true;
+}
+
+bool indexfile_iterateFields(const indexfile_t* file, const int i, void* arg,
+                             bool (*itemfunc)(void* arg, const int field, const int docID, const int count)){
+    if (file == NULL || file->fields == NULL || itemfunc == NULL || i < 0 || (uint32_t) i >= file->header->numWords) {
+        return false;
+    }
+    // The word's run ends where the next word's starts
+    const indexfile_header_t* header = file->header;
+    if (!file_check(file, header->fieldOffsetsOffset + (uint64_t) i * sizeof(uint64_t), 2 * sizeof(uint64_t))) {
+        return false;
+    }
+    uint64_t start = file->fieldOffsets[i];
+    uint64_t end = file->fieldOffsets[i + 1];
+    if (start > end || end > header->fieldsBytes || !file_check(file, header->fieldsOffset + start, end - start)) {
+        return false;
+    }
+    if (start == end) {
+        return true; // In no field
+    }
+
+    // A mask of the fields present, then for each in turn its number of postings and their blocks
+    const uint8_t* in = file->fields + start;
+    size_t avail = end - start;
+    uint8_t mask = *in++;
+    avail--;
+    int docIDs[POSTINGS_BLOCK];
+    int counts[POSTINGS_BLOCK];
+    for (int field = 0; mask != 0 && field < INDEXFILE_MAX_FIELDS; field++) {
+        if ((mask & (1u << field)) == 0) {
+            continue;
+        }
+        mask &= ~(1u << field);
+        uint32_t numPostings;
+        size_t used = varint_get(in, avail, &numPostings);
+        if (used == 0 || numPostings == 0) {
+            return false;
+        }
+        in += used;
+        avail -= used;
+        int prevDocID = 0;
+        for (uint32_t done = 0; done < numPostings; ) {
+            int n = (numPostings - done < POSTINGS_BLOCK) ? (int) (numPostings - done) : POSTINGS_BLOCK;
+            used = postings_decode(in, avail, n, prevDocID, docIDs, counts);
+            if (used == 0) {
+                return false; // Runs off the word's run
+            }
+            in += used;
+            avail -= used;
+            for (int j = 0; j < n; j++) {
+                if (docIDs[j] <= prevDocID || counts[j] < 1) {
+                    return false;
+                }
+                prevDocID = docIDs[j];
+                if (!(*itemfunc)(arg, field, docIDs[j], counts[j])) {
+                    return false;
+                }
+            }
+            done += n;
+        }
+    }
+    return mask == 0 && avail == 0;
+}
+
+uint64_t indexfile_numChunks(const indexfile_t* file){
+    return file == NULL ? 0 : file->header->numChunks;
+}
+
+bool indexfile_checkChunk(const indexfile_t* file, const uint64_t chunk, uint64_t* offset, uint64_t* length){
+    if (file == NULL || chunk >= file->header->numChunks) {
+        return false;
+    }
+    uint64_t start = file->header->postingsOffset + chunk * file->header->chunkBytes;
+    uint64_t bytes = file->header->checksumsOffset - start;
+    if (bytes > file->header->chunkBytes) {
+        bytes = file->header->chunkBytes;
+    }
+    if (offset != NULL) {
+        *offset = start;
+    }
+    if (length != NULL) {
+        *length = bytes;
+    }
+    uint8_t state = atomic_load_explicit(&file->checks->state[chunk], memory_order_relaxed);
+    if (state == CHUNK_UNCHECKED) {
+        state = chunk_verify(file, chunk);
+    }
+    return state == CHUNK_GOOD;
+}
+
+void indexfile_close(indexfile_t* file){
+    if (file != NULL) {
+        munmap((void*) file->map, file->size);
+        free(file->checks);
+        mem_free(file->path);
+        mem_free(file);
+    }
+}
+
+
+/**************** local functions ****************/
+/* Finish the current word: encode its last block and keep it, or drop it if it got neither postings nor
+ * field postings. Return writer->ok */
+static bool writer_closeWord(indexfile_writer_t* writer){
+    if (writer->pendingPositions > 0) { // The last posting's positions never came
+        writer->ok = false;
+    }
+    if (writer->open) {
+        writer->open = false;
+        if (writer->blockLength > 0) {
+            writer_flushBlock(writer);
+        }
+        if (writer->ok && (writer->currentPostings > 0 || writer->numCurrentFields > 0) && writer_keepFields(writer)) {
+            writer_keepWord(writer);
+        }
+    }
+    return writer->ok;
+}
+
+/* Add the current word to the words section and dictionary: whole if it starts a block of words,
+ * else as the length of the prefix it shares with the word before (one byte) and the rest */
+static bool writer_keepWord(indexfile_writer_t* writer){
+    size_t len = strlen(writer->current);
+    size_t shared = 0;
+    bool head = (writer->numWords % INDEXFILE_WORD_BLOCK == 0);
+    if (!head) {
+        while (shared < INDEXFILE_MAX_SHARED && writer->current[shared] == writer->last[shared]) {
+            shared++; // Stops by the NUL of the shorter word, as the words differ
+        }
+    }
+    size_t bytes = (head ? 0 : 1) + len - shared + 1;
+    if (!grow(&writer->words, &writer->wordCapacity, writer->wordBytes + bytes, 1)
+        || !grow(&writer->counts, &writer->countCapacity, writer->numWords + 1, sizeof(uint32_t))
+        || (head && !grow(&writer->dict, &writer->dictCapacity, writer->numWordBlocks + 1,
+                          sizeof(indexfile_wordBlock_t)))) {
+        writer->ok = false;
+        return false;
+    }
+    if (head) {
+        indexfile_wordBlock_t* wordBlock = &writer->dict[writer->numWordBlocks++];
+        wordBlock->wordOffset = writer->wordBytes;
+        wordBlock->firstBlock = writer->currentFirstBlock;
+    } else {
+        writer->words[writer->wordBytes++] = (char) shared;
+    }
+    memcpy(writer->words + writer->wordBytes, writer->current + shared, len - shared + 1);
+    writer->wordBytes += len - shared + 1;
+    writer->counts[writer->numWords++] = writer->currentPostings;
+    if (len + 1 > writer->maxWordBytes) {
+        writer->maxWordBytes = len + 1;
+    }
+
+    // The current word becomes the last one; its buffer is reused for the next
+    char* last = writer->last;
+    size_t lastCapacity = writer->lastCapacity;
+    writer->last = writer->current;
+    writer->lastCapacity = writer->currentCapacity;
+    writer->current = last;
+    writer->currentCapacity = lastCapacity;
+    return true;
+}
+
+/* Encode the current word's field postings at the end of the fields section, noting where they start:
+ * a mask of the fields it is in, then for each its number of postings and their postings blocks. A word
+ * in no field takes no bytes. Called before writer_keepWord counts the word */
+static bool writer_keepFields(indexfile_writer_t* writer){
+    if ((writer->flags & INDEXFILE_FIELDS) == 0) {
+        return true;
+    }
+    size_t n = writer->numCurrentFields;
+    size_t most = 1 + INDEXFILE_MAX_FIELDS * (INDEXFILE_MAX_VARINT + POSTINGS_MAX_BYTES(POSTINGS_BLOCK))
+        + (n / POSTINGS_BLOCK) * POSTINGS_MAX_BYTES(POSTINGS_BLOCK);
+    if (!grow(&writer->fieldOffsets, &writer->fieldOffsetCapacity, writer->numWords + 1, sizeof(uint64_t))
+        || (n > 0 && !grow(&writer->fields, &writer->fieldCapacity, writer->fieldBytes + most, 1))) {
+        writer->ok = false;
+        return false;
+    }
+    writer->fieldOffsets[writer->numWords] = writer->fieldBytes;
+    if (n == 0) {
+        return true;
+    }
+    uint8_t* mask = &writer->fields[writer->fieldBytes++];
+    *mask = 0;
+    int docIDs[POSTINGS_BLOCK];
+    int counts[POSTINGS_BLOCK];
+    size_t end;
+    for (size_t start = 0; start < n; start = end) {
+        int field = writer->currentFields[start].field;
+        end = start + 1;
+        while (end < n && writer->currentFields[end].field == field) {
+            end++;
+        }
+        *mask |= 1u << field;
+        writer->fieldBytes += varint_put(end - start, writer->fields + writer->fieldBytes);
+        int prevDocID = 0;
+        for (size_t block = start; block < end; block += POSTINGS_BLOCK) {
+            int length = (end - block < POSTINGS_BLOCK) ? (int) (end - block) : POSTINGS_BLOCK;
+            for (int j = 0; j < length; j++) {
+                docIDs[j] = writer->currentFields[block + j].docID;
+                counts[j] = writer->currentFields[block + j].count;
+            }
+            writer->fieldBytes += postings_encode(docIDs, counts, length, prevDocID, writer->fields + writer->fieldBytes);
+            prevDocID = docIDs[length - 1];
+        }
+    }
+    return true;
+}
+
+/* Encode the postings buffered for the current word as one block, noting its skip record */
+static bool writer_flushBlock(indexfile_writer_t* writer){
+    if (!grow(&writer->skips, &writer->skipCapacity, writer->numBlocks + 1, sizeof(indexfile_skip_t))) {
+        writer->ok = false;
+        return false;
+    }
+    if (writer->flags & INDEXFILE_POSITIONS) { // Where the block's positions start
+        if (!grow(&writer->positionBlocks, &writer->positionBlockCapacity, writer->numBlocks + 1, sizeof(uint64_t))) {
+            writer->ok = false;
+            return false;
+        }
+        writer->positionBlocks[writer->numBlocks] = writer->blockPositions;
+    }
+    indexfile_skip_t* skip = &writer->skips[writer->numBlocks++];
+    skip->offset = writer->postingsBytes;
+    skip->lastDocID = writer->blockDocIDs[writer->blockLength - 1];
+    skip->maxCount = 0;
+    for (int j = 0; j < writer->blockLength; j++) {
+        if (writer->blockCounts[j] > skip->maxCount) {
+            skip->maxCount = writer->blockCounts[j];
+        }
+    }
+
+    uint8_t bytes[POSTINGS_MAX_BYTES(POSTINGS_BLOCK)];
+    size_t used = postings_encode(writer->blockDocIDs, writer->blockCounts, writer->blockLength,
+                                  writer->blockPrevDocID, bytes);
+    writer->blockPrevDocID = writer->blockDocIDs[writer->blockLength - 1];
+    writer->blockLength = 0;
+    if (!writer_write(writer, bytes, used)) {
+        return false;
+    }
+    writer->postingsBytes += used;
+    return true;
+}
+
+/* Write the next bytes of the file after the header, adding them to the checksum of their chunk,
+ * and noting each chunk's checksum as it fills; false (and writer->ok false) on a write error */
+static bool writer_write(indexfile_writer_t* writer, const void* data, const size_t length){
+    if (fwrite(data, 1, length, writer->fp) != length) {
+        writer->ok = false;
+        return false;
+    }
+    const uint8_t* bytes = data;
+    size_t left = length;
+    while (left > 0) {
+        size_t n = INDEXFILE_CHUNK - writer->chunkFill;
+        n = (n < left) ? n : left;
+        writer->chunkCrc = crc32c_update(writer->chunkCrc, bytes, n);
+        writer->chunkFill += n;
+        bytes += n;
+        left -= n;
+        if (writer->chunkFill == INDEXFILE_CHUNK) {
+            if (!grow(&writer->checksums, &writer->checksumCapacity, writer->numChunks + 1, sizeof(uint32_t))) {
+                writer->ok = false;
+                return false;
+            }
+            writer->checksums[writer->numChunks++] = writer->chunkCrc;
+            writer->chunkCrc = 0;
+            writer->chunkFill = 0;
+        }
+    }
+    return true;
+}
+
+/* Write count zero bytes, as writer_write does */
+static bool writer_padding(indexfile_writer_t* writer, const uint64_t count){
+    static const uint8_t zeros[64];
+    for (uint64_t left = count; left > 0; ) {
+        size_t n = (left < sizeof(zeros)) ? left : sizeof(zeros);
+        if (!writer_write(writer, zeros, n)) {
+            return false;
+        }
+        left -= n;
+    }
+    return true;
+}
+
+/* Write value as a varint, 7 bits a byte, low bits first, the top bit set on all but the last; return
+ * the bytes it took (at most INDEXFILE_MAX_VARINT) */
+static size_t varint_put(uint32_t value, uint8_t* out){
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t) value;
+    return n;
+}
+
+/* Read a varint written by varint_put from in, which has avail bytes left; return the bytes it took, or 0
+ * if it runs past avail or is too long */
+static size_t varint_get(const uint8_t* in, const size_t avail, uint32_t* value){
+    uint32_t result = 0;
+    for (size_t n = 0; n < avail && n < INDEXFILE_MAX_VARINT; n++) {
+        result |= (uint32_t) (in[n] & 0x7F) << (7 * n);
+        if ((in[n] & 0x80) == 0) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+/* Make room for needed items of itemSize in the array *array points to, doubling its capacity as
+ * needed; false if out of memory */
+static bool grow(void* array, size_t* capacity, const size_t needed, const size_t itemSize){
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t newCapacity = (*capacity == 0) ? 1024 : *capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    void* grown = realloc(*(void**) array, newCapacity * itemSize);
+    if (grown == NULL) {
+        return false;
+    }
+    *(void**) array = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+/* Return the header's checksum: the CRC-32C of the header with headerCrc 0, then of the chunks' checksums */
+static uint32_t header_crc(const indexfile_header_t* header, const uint32_t* checksums){
+    indexfile_header_t copy = *header;
+    copy.headerCrc = 0;
+    uint32_t crc = crc32c_update(0, &copy, sizeof(copy));
+    return crc32c_update(crc, checksums, header->numChunks * sizeof(uint32_t));
+}
+
+/* Check the bytes [offset, offset + length) of the file against the checksums of the chunks
+ * holding them, verifying each chunk the first time it is used; false if one is damaged (reported
+ * once per file) or the bytes aren't in the checksummed sections */
+static bool file_check(const indexfile_t* file, const uint64_t offset, const uint64_t length){
+    const indexfile_header_t* header = file->header;
+    if (offset < header->postingsOffset || offset > header->checksumsOffset
+        || length > header->checksumsOffset - offset) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    uint64_t last = (offset + length - 1 - header->postingsOffset) / header->chunkBytes;
+    for (uint64_t c = (offset - header->postingsOffset) / header->chunkBytes; c <= last; c++) {
+        uint8_t state = atomic_load_explicit(&file->checks->state[c], memory_order_relaxed);
+        if (state == CHUNK_UNCHECKED) {
+            state = chunk_verify(file, c);
+        }
+        if (state != CHUNK_GOOD) {
+            if (!atomic_exchange(&file->checks->reported, true)) {
+                uint64_t start = header->postingsOffset + c * header->chunkBytes;
+                uint64_t end = (header->checksumsOffset - start > header->chunkBytes)
+                    ? start + header->chunkBytes : header->checksumsOffset;
+                fprintf(stderr, "Warning: index file %s is damaged: bytes %llu to %llu do not match their checksum\n",
+                        file->path, (unsigned long long) start, (unsigned long long) end - 1);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Compute a chunk's checksum, and note and return whether it matches. Threads may verify a chunk at
+ * once; they reach the same answer */
+static uint8_t chunk_verify(const indexfile_t* file, const uint64_t chunk){
+    const indexfile_header_t* header = file->header;
+    uint64_t start = header->postingsOffset + chunk * header->chunkBytes;
+    uint64_t bytes = header->checksumsOffset - start;
+    if (bytes > header->chunkBytes) {
+        bytes = header->chunkBytes;
+    }
+    uint8_t state = (crc32c_update(0, file->map + start, bytes) == file->checksums[chunk]) ? CHUNK_GOOD : CHUNK_DAMAGED;
+    atomic_store_explicit(&file->checks->state[chunk], state, memory_order_relaxed);
+    return state;
+}
+
+/* Return the skip record of a block of word number i; NULL if either is out of range or damaged. A
+ * word's first block follows the blocks of the words before it in its block of words */
+static const indexfile_skip_t* file_skip(const indexfile_t* file, const int i, const int block){
+    if (block < 0 || block >= indexfile_numBlocks(file, i)) {
+        return NULL;
+    }
+    uint32_t wordBlock = i / file->header->wordBlock;
+    if (!file_check(file, file->header->dictOffset + wordBlock * sizeof(indexfile_wordBlock_t),
+                    sizeof(indexfile_wordBlock_t))) {
+        return NULL;
+    }
+    uint64_t firstBlock = file->dict[wordBlock].firstBlock;
+    for (int j = wordBlock * file->header->wordBlock; j < i; j++) {
+        firstBlock += indexfile_numBlocks(file, j);
+    }
+    if (firstBlock > file->header->numBlocks || (uint64_t) block >= file->header->numBlocks - firstBlock
+        || !file_check(file, file->header->skipsOffset + (firstBlock + block) * sizeof(indexfile_skip_t),
+                       sizeof(indexfile_skip_t))) {
+        return NULL;
+    }
+    return &file->skips[firstBlock + block];
+}
+
+/* Check a block of words, with its dictionary record and the next block's (where it ends); false if
+ * damaged */
+static bool words_check(const indexfile_t* file, const uint64_t wordBlock){
+    const indexfile_header_t* header = file->header;
+    bool last = (wordBlock + 1 == file->numWordBlocks);
+    if (!file_check(file, header->dictOffset + wordBlock * sizeof(indexfile_wordBlock_t),
+                    (last ? 1 : 2) * sizeof(indexfile_wordBlock_t))) {
+        return false;
+    }
+    uint64_t offset = file->dict[wordBlock].wordOffset;
+    uint64_t end = last ? header->wordBytes : file->dict[wordBlock + 1].wordOffset;
+    return offset < end && end <= header->wordBytes && file_check(file, header->wordsOffset + offset, end - offset);
+}
+
+/* Decode the first word of a block of words into word (room for maxWordBytes), with its length and
+ * the position of the next word's coding; false if the block is damaged */
+static bool words_head(const indexfile_t* file, const uint64_t wordBlock, char* word, size_t* len, uint64_t* pos){
+    if (!words_check(file, wordBlock)) {
+        return false;
+    }
+    uint64_t offset = file->dict[wordBlock].wordOffset;
+    if (offset >= file->header->wordBytes) {
+        return false;
+    }
+    size_t n = strlen(file->words + offset); // The section ends with a NUL
+    if (n + 1 > file->header->maxWordBytes) {
+        return false;
+    }
+    memcpy(word, file->words + offset, n + 1);
+    *len = n;
+    *pos = offset + n + 1;
+    return true;
+}
+
+/* Decode the word after word (len long) from its coding at *pos, and move past it; false if damaged */
+static bool words_next(const indexfile_t* file, char* word, size_t* len, uint64_t* pos){
+    if (*pos + 1 >= file->header->wordBytes) {
+        return false;
+    }
+    size_t shared = (uint8_t) file->words[*pos];
+    const char* suffix = file->words + *pos + 1;
+    size_t n = strlen(suffix);
+    if (shared > *len || shared + n + 1 > file->header->maxWordBytes) {
+        return false;
+    }
+    memcpy(word + shared, suffix, n + 1);
+    *len = shared + n;
+    *pos += n + 2;
+    return true;
+}
+
+/* Return the number of the first word w with strncmp(w, key, n) >= 0 (> 0 if after), decoded into
+ * word; numWords if there is none, -1 if the dictionary is damaged. Words in strcmp order are in
+ * order by their first n bytes too, so this is a binary search of the blocks' first words and a
+ * scan of one block */
+static int words_search(const indexfile_t* file, const char* key, const size_t n, const bool after, char* word){
+    uint64_t low = 0;
+    uint64_t high = file->numWordBlocks;  // ends as the first block whose first word is the answer
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (!words_check(file, mid) || file->dict[mid].wordOffset >= file->header->wordBytes) {
+            return -1;
+        }
+        int cmp = strncmp(file->words + file->dict[mid].wordOffset, key, n);
+        if (after ? cmp > 0 : cmp >= 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    size_t len;
+    uint64_t pos;
+    if (low == 0) {
+        return words_head(file, 0, word, &len, &pos) ? 0 : -1;
+    }
+    // Past the first word of block low - 1: the answer is later in that block, or block low's first
+    uint32_t wordBlock = file->header->wordBlock;
+    uint64_t end = (low * wordBlock < file->header->numWords) ? low * wordBlock : file->header->numWords;
+    if (!words_head(file, low - 1, word, &len, &pos)) {
+        return -1;
+    }
+    for (uint64_t i = (low - 1) * wordBlock + 1; i < end; i++) {
+        if (!words_next(file, word, &len, &pos)) {
+            return -1;
+        }
+        int cmp = strncmp(word, key, n);
+        if (after ? cmp > 0 : cmp >= 0) {
+            return i;
+        }
+    }
+    if (end < file->header->numWords && !words_head(file, low, word, &len, &pos)) {
+        return -1;
+    }
+    return end;
+}
+
+/* Parse " digits" at *cursor into value and move past it; false if there is no number */
+static bool parse_int(char** cursor, long* value){
+    char* p = *cursor;
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p < '0' || *p > '9') {
+        return false;
+    }
+    long n = 0;
+    for ( ; *p >= '0' && *p <= '9'; p++) {
+        n = n * 10 + (*p - '0');
+        if (n > INT32_MAX) {
+            return false;
+        }
+    }
+    *cursor = p;
+    *value = n;
+    return true;
+}
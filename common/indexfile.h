@@ -0,0 +1,388 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: indexfile.h
+Description: header file for CS50 indexfile module
+
+ * An "indexfile" is the binary form of an index file. A querier maps it into
+ * memory and searches it where it lies: opening one reads a fixed-size header
+ * and nothing else, however large the index, where loading the text format
+ * parses every line. Words are front-coded in blocks of 16: the first word
+ * of a block is whole, and each after it is the length of the prefix it
+ * shares with the word before plus the rest, which in sorted order is most
+ * of each word. A word is looked up by binary search of the blocks' first
+ * words and a scan of one block; the words with a given prefix are a run
+ * found the same way. Each word's postings are one compressed run in the file
+ * (see postings.h), decoded a block at a time as they are read. Each block
+ * has a skip record giving its largest docID and count, so a reader looking
+ * for a docID can pass over whole blocks without decoding them. A positional
+ * file (INDEXFILE_POSITIONS) also holds where in its document each posting's
+ * word occurs, in a section of its own after the rest: searches that don't
+ * ask for positions never read it. A file with fields (INDEXFILE_FIELDS)
+ * also holds, for each word, how often it occurs in the title, headings or
+ * anchor text of each document it is in (anchor text counting toward the
+ * page the link points to): a run of postings per field beside the word's
+ * own, so a word is stored once however many fields it is in, and a word in
+ * no field costs one offset.
+ *
+ * Everything after the header is checksummed in chunks of 64 KB, each with
+ * its CRC-32C (crc32c.h), and the header with the checksums has one too.
+ * Opening a file checks the header's; a chunk is checked the first time a
+ * word, skip record or block of postings in it is used, so a search of a
+ * huge file reads and checks only the chunks it touches. Damage is reported
+ * once, and the damaged part reads as missing rather than as wrong postings.
+ *
+ * File layout (host byte order; sections start 8-byte aligned, except the
+ * words, which need no alignment):
+ *   header:   "TSEI" magic, uint32 version, flags, number of words, size of
+ *             the longest word (with its NUL), words per block, bytes per
+ *             chunk, and the header's checksum (the CRC-32C of the header
+ *             with this field 0, then of the checksums section); then uint64
+ *             number of postings, offset and size of the postings, offset
+ *             and size of the words, offset and number of the skip records,
+ *             offsets of the dictionary and the counts, offsets of the
+ *             position blocks and positions and size of the positions,
+ *             offsets of the field offsets and fields and size of the fields,
+ *             offset of the checksums and number of chunks, and the size of
+ *             the whole file
+ *   postings: each word's postings, in increasing docID order, as postings
+ *             blocks; the runs are in the order of the words, and are
+ *             followed by POSTINGS_PADDING zero bytes
+ *   words:    the words in strcmp order, in blocks: the first word of a
+ *             block NUL-terminated, then for each other word a byte giving
+ *             the length of the prefix it shares with the word before (at
+ *             most 255) and the rest of it, NUL-terminated
+ *   skips:    one record per block, in the order of the blocks: offset of
+ *             the block in the postings section, its last docID, its
+ *             largest count
+ *   dictionary: one record per block of words: offset of the block in the
+ *             words section, index of its first word's first skip record
+ *             (the other words' blocks follow, a word's postings taking
+ *             ceil(postings / POSTINGS_BLOCK) blocks)
+ *   counts:   uint32 number of postings of each word
+ *   position blocks: with INDEXFILE_POSITIONS only, uint64 offset in the
+ *             positions section of each block's positions, in the order of
+ *             the skip records
+ *   positions: with INDEXFILE_POSITIONS only, the positions of each posting
+ *             of each block in turn (postings.h); a block's run ends where
+ *             the next block's starts
+ *   field offsets: with INDEXFILE_FIELDS only, uint64 offset in the fields
+ *             section of each word's field postings, and one more where the
+ *             last word's run ends
+ *   fields:   with INDEXFILE_FIELDS only, for each word in any field a byte
+ *             with bit f set if it is in field f, then for each such field
+ *             in turn a varint (as positions are coded) number of postings
+ *             and the postings as blocks, the docIDs of each field starting
+ *             from 0; followed by POSTINGS_PADDING zero bytes
+ *   checksums: uint32 CRC-32C of each chunk of the file from the postings
+ *             to the end of the fields (the last chunk may be short)
+ * The version changes whenever the layout does; readers reject versions they
+ * do not know, so an old querier never misreads a newer index.
+ */
+
+#ifndef __INDEXFILE_H
+#define __INDEXFILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "postings.h"  // for POSTINGS_BLOCK
+
+/**************** global types ****************/
+typedef struct indexfile indexfile_t;                // an open (mapped) index file
+typedef struct indexfile_writer indexfile_writer_t;  // an index file being written
+
+/* Header flags */
+#define INDEXFILE_STEMMED 0x1u    // words are stems (built with make STEM=1)
+#define INDEXFILE_POSITIONS 0x2u  // each posting has its positions (built with indexer -p)
+#define INDEXFILE_FIELDS 0x4u     // words have field postings (built with indexer -f)
+
+#define INDEXFILE_MAX_FIELDS 8    // fields a file can have, numbered from 0
+
+
+/**************** indexfile_is ****************/
+/* Tell whether the file at path starts like a binary index (of any version).
+ *
+ * We return:
+ *   true if it has the binary index magic; false otherwise, or if it can't be read.
+ */
+bool indexfile_is(const char* path);
+
+
+/**************** indexfile_create ****************/
+/* Start writing a binary index file.
+ *
+ * Caller provides:
+ *   path to write (replaced if it exists), header flags (INDEXFILE_STEMMED,
+ *   INDEXFILE_POSITIONS, INDEXFILE_FIELDS, or 0)
+ * We return:
+ *   a new writer; NULL if the file can't be created or out of memory.
+ * Caller is responsible for:
+ *   adding words in increasing strcmp order with indexfile_addWord, each
+ *   followed by its postings (with INDEXFILE_POSITIONS, each posting followed
+ *   by its positions) and then any field postings, then calling
+ *   indexfile_finish().
+ */
+indexfile_writer_t* indexfile_create(const char* path, const uint32_t flags);
+
+
+/**************** indexfile_addWord ****************/
+/* Start the next word; its postings follow with indexfile_addPosting.
+ *
+ * We return:
+ *   false if the word is not greater than the previous one, is empty, or on
+ *   a write error (which indexfile_finish will report too).
+ * Notes:
+ *   a word given no postings is left out of the file, unless it is given
+ *   field postings (a word only in link text, in a docID shard).
+ */
+bool indexfile_addWord(indexfile_writer_t* writer, const char* word);
+
+
+/**************** indexfile_addPosting ****************/
+/* Add a posting of the current word.
+ *
+ * We return:
+ *   false if there is no current word, docID is not greater than its last
+ *   docID, count < 1, or on a write error.
+ */
+bool indexfile_addPosting(indexfile_writer_t* writer, const int docID, const int count);
+
+
+/**************** indexfile_addPositions ****************/
+/* Add the positions of the posting just added, to a file created with
+ * INDEXFILE_POSITIONS.
+ *
+ * Caller provides:
+ *   the posting's count of positions, increasing from 0 up
+ * We return:
+ *   false if the file has no positions, n isn't the posting's count, the
+ *   positions are out of order, or out of memory.
+ * Notes:
+ *   the positions are kept in memory until indexfile_finish writes them,
+ *   after everything else. A posting left without its positions fails the
+ *   next indexfile_addPosting, indexfile_addWord or indexfile_finish.
+ */
+bool indexfile_addPositions(indexfile_writer_t* writer, const int* positions, const int n);
+
+
+/**************** indexfile_addField ****************/
+/* Add a field posting of the current word, to a file created with
+ * INDEXFILE_FIELDS: the word occurs count times in field of document docID.
+ *
+ * Caller provides:
+ *   the word's field postings after its postings, in increasing order of
+ *   field (0 <= field < INDEXFILE_MAX_FIELDS), then of docID
+ * We return:
+ *   false if the file has no fields, there is no current word, the field
+ *   posting is out of order or invalid, or out of memory.
+ * Notes:
+ *   a field posting's docID need not be among the word's postings (anchor
+ *   text counts toward the page linked to). Field postings are kept in
+ *   memory until indexfile_finish writes them.
+ */
+bool indexfile_addField(indexfile_writer_t* writer, const int field, const int docID, const int count);
+
+
+/**************** indexfile_finish ****************/
+/* Write the words, dictionary and header, close the file and free the writer.
+ *
+ * We return:
+ *   true if the whole file was written; false if any step failed (the
+ *   partial file is removed).
+ */
+bool indexfile_finish(indexfile_writer_t* writer);
+
+
+/**************** indexfile_fromText ****************/
+/* Convert a text index file (word docID count ...; words in strcmp order, as
+ * saveIndex_toPage writes them) to a binary one, a line at a time.
+ *
+ * We return:
+ *   true on success; false if the text can't be read, is malformed or out of
+ *   order, or the binary file can't be written.
+ */
+bool indexfile_fromText(const char* textPath, const char* path, const uint32_t flags);
+
+
+/**************** indexfile_open ****************/
+/* Map a binary index file into memory.
+ *
+ * We return:
+ *   the open file; NULL if it can't be mapped or isn't a binary index of a
+ *   version we know.
+ * Notes:
+ *   only the header and its checksum are checked here (a mismatch is
+ *   reported); the rest is checked as it is used, each chunk against its
+ *   checksum the first time, so a damaged file yields missing words (and
+ *   one warning) rather than wrong results or crashes.
+ *   Caller is responsible for later calling indexfile_close().
+ */
+indexfile_t* indexfile_open(const char* path);
+
+
+/**************** indexfile_flags ****************/
+/* Return the header flags of an open file (0 if file is NULL). */
+uint32_t indexfile_flags(const indexfile_t* file);
+
+
+/**************** indexfile_numWords ****************/
+/* Return the number of words in an open file (0 if file is NULL). */
+int indexfile_numWords(const indexfile_t* file);
+
+
+/**************** indexfile_maxWordBytes ****************/
+/* Return the size of the longest word of an open file, with its NUL: the room
+ * indexfile_word needs (1 if file is NULL or has no words). */
+int indexfile_maxWordBytes(const indexfile_t* file);
+
+
+/**************** indexfile_word ****************/
+/* Decode word number i (0 <= i < indexfile_numWords) in strcmp order.
+ *
+ * Caller provides:
+ *   room for indexfile_maxWordBytes() bytes at word
+ * We return:
+ *   true with the word at word; false if i is out of range or the words
+ *   are damaged.
+ * Notes:
+ *   this decodes up to 15 words before it; use indexfile_iterateWords to
+ *   walk words in order.
+ */
+bool indexfile_word(const indexfile_t* file, const int i, char* word);
+
+
+/**************** indexfile_iterateWords ****************/
+/* Call itemfunc(arg, i, word) for words number first to end - 1, in order,
+ * decoding each from the one before.
+ *
+ * We return:
+ *   true if every word was passed on; false if the range is invalid, the
+ *   words are damaged, out of memory, or itemfunc returned false (which
+ *   stops the walk).
+ * Notes:
+ *   word is only valid during the call.
+ */
+bool indexfile_iterateWords(const indexfile_t* file, const int first, const int end, void* arg,
+                            bool (*itemfunc)(void* arg, const int i, const char* word));
+
+
+/**************** indexfile_find ****************/
+/* Find a word by binary search of the dictionary.
+ *
+ * We return:
+ *   its number (for indexfile_word and indexfile_iteratePostings); -1 if absent.
+ */
+int indexfile_find(const indexfile_t* file, const char* word);
+
+
+/**************** indexfile_findPrefix ****************/
+/* Find the words that start with prefix (all of them, for ""), which are
+ * consecutive in strcmp order.
+ *
+ * We return:
+ *   how many there are, with the number of the first at *first; 0 if none.
+ */
+int indexfile_findPrefix(const indexfile_t* file, const char* prefix, int* first);
+
+
+/**************** indexfile_numPostings ****************/
+/* Return the number of postings of word number i; 0 if i is out of range. */
+int indexfile_numPostings(const indexfile_t* file, const int i);
+
+
+/**************** indexfile_numBlocks ****************/
+/* Return the number of postings blocks of word number i; 0 if i is out of range. */
+int indexfile_numBlocks(const indexfile_t* file, const int i);
+
+
+/**************** indexfile_blockSkip ****************/
+/* Read the skip record of a block of word number i, without decoding the block.
+ *
+ * We return:
+ *   true, with the block's last docID and largest count; false if i or
+ *   block is out of range.
+ */
+bool indexfile_blockSkip(const indexfile_t* file, const int i, const int block, int* lastDocID, int* maxCount);
+
+
+/**************** indexfile_decodeBlock ****************/
+/* Decode a block of postings of word number i.
+ *
+ * Caller provides:
+ *   room for POSTINGS_BLOCK docIDs and counts
+ * We return:
+ *   the number of postings in the block (POSTINGS_BLOCK, or fewer for a
+ *   word's last block); 0 if i or block is out of range, or the block is
+ *   damaged (runs off its section, or disagrees with its skip record).
+ */
+int indexfile_decodeBlock(const indexfile_t* file, const int i, const int block, int* docIDs, int* counts);
+
+
+/**************** indexfile_iteratePostings ****************/
+/* Decode the postings of word number i, calling itemfunc on each in
+ * increasing docID order.
+ *
+ * We return:
+ *   true if every posting was passed on (a word with only field postings has
+ *   none); false if i is out of range, the postings are damaged, or itemfunc
+ *   returned false (which stops the walk).
+ * Notes:
+ *   a damaged run is cut off at the block where the damage is found.
+ */
+bool indexfile_iteratePostings(const indexfile_t* file, const int i, void* arg,
+                               bool (*itemfunc)(void* arg, const int docID, const int count));
+
+
+/**************** indexfile_blockPositions ****************/
+/* Find the positions of a block of postings of word number i.
+ *
+ * We return:
+ *   true, with the run of positions of the block's postings at *positions,
+ *   *length bytes long (decode it with postings_decodePositions, a posting's
+ *   count of positions at a time); false if the file has no positions, i or
+ *   block is out of range, or the run is damaged.
+ */
+bool indexfile_blockPositions(const indexfile_t* file, const int i, const int block,
+                              const uint8_t** positions, size_t* length);
+
+
+/**************** indexfile_iterateFields ****************/
+/* Decode the field postings of word number i, calling itemfunc on each in
+ * increasing order of field, then of docID.
+ *
+ * We return:
+ *   true if every field posting was passed on (a word in no field has none);
+ *   false if the file has no fields, i is out of range, the field postings
+ *   are damaged, or itemfunc returned false (which stops the walk).
+ */
+bool indexfile_iterateFields(const indexfile_t* file, const int i, void* arg,
+                             bool (*itemfunc)(void* arg, const int field, const int docID, const int count));
+
+
+/**************** indexfile_numChunks ****************/
+/* Return the number of checksummed chunks of an open file (0 if file is NULL). */
+uint64_t indexfile_numChunks(const indexfile_t* file);
+
+
+/**************** indexfile_checkChunk ****************/
+/* Check a chunk of an open file against its checksum, as using it would.
+ *
+ * Caller provides:
+ *   the chunk's number (0 <= chunk < indexfile_numChunks); where to put the
+ *   file offset and length of its bytes, or NULLs
+ * We return:
+ *   true if the chunk matches its checksum; false if not, or chunk is out of range.
+ * Notes:
+ *   each chunk is checked once per open file, by whichever thread gets to
+ *   it first; so threads checking different chunks verify a file in parallel.
+ *   Unlike using the chunk, this reports nothing.
+ */
+bool indexfile_checkChunk(const indexfile_t* file, const uint64_t chunk, uint64_t* offset, uint64_t* length);
+
+
+/**************** indexfile_close ****************/
+/* Unmap the file. We ignore a NULL file. */
+void indexfile_close(indexfile_t* file);
+
+#endif // __INDEXFILE_H
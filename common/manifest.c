@@ -0,0 +1,240 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: manifest.c
+Description: (CS-50) Module to read and write the binary page directory manifest.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "manifest.h"
+#include "webpage.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const char MANIFEST_MAGIC[4] = {'T', 'S', 'E', 'M'};
+static const uint32_t MANIFEST_VERSION = 1;
+
+/**************** local types ****************/
+typedef struct manifest_header {
+    char magic[4];        // "TSEM"
+    uint32_t version;     // MANIFEST_VERSION
+    uint32_t count;       // number of records
+    uint32_t reserved;    // keeps urlBytes 8-byte aligned
+    uint64_t urlBytes;    // size of the URL pool
+} manifest_header_t;
+
+/**************** global types ****************/
+typedef struct manifest {
+    manifest_entry_t* entries;  // growable array of records
+    int count;                  // records in use
+    int capacity;               // records allocated
+    char* urls;                 // pool of NUL-terminated URLs
+    uint64_t urlBytes;          // bytes in use in the pool
+    uint64_t urlCapacity;       // bytes allocated for the pool
+} manifest_t;
+
+/**************** local functions ****************/
+static uint64_t fnv1a_hash(const char* data, size_t len);
+static char* manifest_path(const char* pageDirectory, const char* name);
+
+
+/**************** global functions ****************/
+manifest_t* manifest_new(void){
+    manifest_t* manifest = mem_calloc(1, sizeof(manifest_t));
+    return manifest; // Fields start out zero / NULL
+}
+
+bool manifest_add(manifest_t* manifest, const webpage_t* page, const int docID){
+    if (manifest == NULL || page == NULL || webpage_getHTML(page) == NULL || docID <= 0) {
+        return false;
+    }
+    const char* url = webpage_getURL(page);
+    const char* html = webpage_getHTML(page);
+    size_t urlLen = strlen(url);
+    size_t htmlLen = strlen(html);
+
+    // Grow the record array and the URL pool geometrically
+    if (manifest->count == manifest->capacity) {
+        int capacity = manifest->capacity == 0 ? 64 : manifest->capacity * 2;
+        manifest_entry_t* entries = realloc(manifest->entries, capacity * sizeof(manifest_entry_t));
+        if (entries == NULL) {
+            return false;
+        }
+        manifest->entries = entries;
+        manifest->capacity = capacity;
+    }
+    if (manifest->urlBytes + urlLen + 1 > manifest->urlCapacity) {
+        uint64_t capacity = manifest->urlCapacity == 0 ? 4096 : manifest->urlCapacity;
+        while (manifest->urlBytes + urlLen + 1 > capacity) {
+            capacity *= 2;
+        }
+        char* urls = realloc(manifest->urls, capacity);
+        if (urls == NULL) {
+            return false;
+        }
+        manifest->urls = urls;
+        manifest->urlCapacity = capacity;
+    }
+
+    // Mirror the layout written by pagedir_save: "URL\n" "depth\n" HTML
+    char depthStr[16];
+    int depthLen = snprintf(depthStr, sizeof(depthStr), "%d", webpage_getDepth(page));
+
+    manifest_entry_t* entry = &manifest->entries[manifest->count++];
+    entry->docID = docID;
+    entry->depth = webpage_getDepth(page);
+    entry->htmlOffset = urlLen + 1 + depthLen + 1;
+    entry->size = entry->htmlOffset + htmlLen;
+    entry->urlOffset = manifest->urlBytes;
+    entry->fetchTime = (int64_t) time(NULL);
+    entry->hash = fnv1a_hash(html, htmlLen);
+
+    memcpy(manifest->urls + manifest->urlBytes, url, urlLen + 1);
+    manifest->urlBytes += urlLen + 1;
+    return true;
+}
+
+bool manifest_save(manifest_t* manifest, const char* pageDirectory){
+    if (manifest == NULL || pageDirectory == NULL) {
+        return false;
+    }
+    char* tmpPath = manifest_path(pageDirectory, ".manifest.tmp");
+    char* path = manifest_path(pageDirectory, ".manifest");
+    if (tmpPath == NULL || path == NULL) {
+        mem_free(tmpPath);
+        mem_free(path);
+        return false;
+    }
+
+    manifest_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = MANIFEST_VERSION;
+    header.count = manifest->count;
+    header.urlBytes = manifest->urlBytes;
+
+    // Write under a temporary name, then rename into place
+    bool ok = false;
+    FILE* fp = fopen(tmpPath, "wb");
+    if (fp != NULL) {
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1
+            && fwrite(manifest->entries, sizeof(manifest_entry_t), manifest->count, fp) == (size_t) manifest->count
+            && fwrite(manifest->urls, 1, manifest->urlBytes, fp) == manifest->urlBytes;
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && rename(tmpPath, path) == 0;
+        if (!ok) {
+            remove(tmpPath);
+        }
+    }
+    mem_free(tmpPath);
+    mem_free(path);
+    return ok;
+}
+
+manifest_t* manifest_load(const char* pageDirectory){
+    if (pageDirectory == NULL) {
+        return NULL;
+    }
+    char* path = manifest_path(pageDirectory, ".manifest");
+    if (path == NULL) {
+        return NULL;
+    }
+    FILE* fp = fopen(path, "rb");
+    mem_free(path);
+    if (fp == NULL) {
+        return NULL; // No manifest (e.g. written by an older crawler)
+    }
+
+    manifest_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1
+        || memcmp(header.magic, MANIFEST_MAGIC, sizeof(header.magic)) != 0
+        || header.version != MANIFEST_VERSION) {
+        fclose(fp);
+        return NULL;
+    }
+
+    manifest_t* manifest = manifest_new();
+    if (manifest == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    manifest->entries = malloc((header.count > 0 ? header.count : 1) * sizeof(manifest_entry_t));
+    manifest->urls = malloc(header.urlBytes > 0 ? header.urlBytes : 1);
+    if (manifest->entries == NULL || manifest->urls == NULL
+        || fread(manifest->entries, sizeof(manifest_entry_t), header.count, fp) != header.count
+        || fread(manifest->urls, 1, header.urlBytes, fp) != header.urlBytes) {
+        fclose(fp);
+        manifest_delete(manifest);
+        return NULL;
+    }
+    fclose(fp);
+
+    manifest->count = manifest->capacity = header.count;
+    manifest->urlBytes = manifest->urlCapacity = header.urlBytes;
+
+    // Reject records that point outside the URL pool, or a pool that isn't terminated
+    if (manifest->urlBytes > 0 && manifest->urls[manifest->urlBytes - 1] != '\0') {
+        manifest_delete(manifest);
+        return NULL;
+    }
+    for (int i = 0; i < manifest->count; i++) {
+        if (manifest->entries[i].urlOffset >= manifest->urlBytes) {
+            manifest_delete(manifest);
+            return NULL;
+        }
+    }
+    return manifest;
+}
+
+int manifest_count(const manifest_t* manifest){
+    return manifest == NULL ? 0 : manifest->count;
+}
+
+const manifest_entry_t* manifest_get(const manifest_t* manifest, const int i){
+    if (manifest == NULL || i < 0 || i >= manifest->count) {
+        return NULL;
+    }
+    return &manifest->entries[i];
+}
+
+const char* manifest_getURL(const manifest_t* manifest, const manifest_entry_t* entry){
+    if (manifest == NULL || entry == NULL || entry->urlOffset >= manifest->urlBytes) {
+        return NULL;
+    }
+    return manifest->urls + entry->urlOffset;
+}
+
+void manifest_delete(manifest_t* manifest){
+    if (manifest != NULL) {
+        free(manifest->entries);
+        free(manifest->urls);
+        mem_free(manifest);
+    }
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* 64-bit FNV-1a hash, used to detect pages whose content changed between crawls */
+static uint64_t fnv1a_hash(const char* data, size_t len){
+    uint64_t hash = 14695981039346656037ULL; // FNV offset basis
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;          // FNV prime
+    }
+    return hash;
+}
+
+/* Build the string pageDirectory/name; caller frees */
+static char* manifest_path(const char* pageDirectory, const char* name){
+    size_t len = strlen(pageDirectory) + strlen(name) + 2;
+    char* path = mem_malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%s", pageDirectory, name);
+    }
+    return path;
+}
@@ -0,0 +1,112 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: manifest.h
+Description: header file for CS50 manifest module
+
+ * A "manifest" is a binary table of contents for a page directory, written by
+ * the crawler next to the .crawler file as pageDirectory/.manifest. It holds
+ * one fixed-size record per saved page, so readers can learn the number of
+ * documents, their sizes, depths and content hashes without opening any page.
+ *
+ * File layout (host byte order):
+ *   header:  "TSEM" magic, uint32 version, uint32 count, uint32 reserved,
+ *            uint64 number of bytes in the URL pool
+ *   records: count manifest_entry_t structs, in increasing docID order
+ *   URLs:    pool of NUL-terminated URL strings, indexed by urlOffset
+ */
+
+#ifndef __MANIFEST_H
+#define __MANIFEST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "webpage.h"  // for webpage_t type
+
+/**************** global types ****************/
+typedef struct manifest manifest_t;  // opaque to users of the module
+
+/* One record per saved page. Fields are fixed-width so the file can be read
+ * with a single fread and indexed directly. */
+typedef struct manifest_entry {
+    int32_t docID;        // file name of the page within pageDirectory
+    int32_t depth;        // crawl depth of the page
+    uint64_t htmlOffset;  // byte offset of the HTML within the page file
+    uint64_t size;        // total size of the page file in bytes
+    uint64_t urlOffset;   // offset of the page's URL within the URL pool
+    int64_t fetchTime;    // time the page was fetched (seconds since epoch)
+    uint64_t hash;        // 64-bit FNV-1a hash of the HTML
+} manifest_entry_t;
+
+
+/**************** manifest_new ****************/
+/* Create a new, empty manifest.
+ *
+ * We return:
+ *   pointer to a new manifest; NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling manifest_delete().
+ */
+manifest_t* manifest_new(void);
+
+
+/**************** manifest_add ****************/
+/* Record a page that was just saved with pagedir_save().
+ *
+ * Caller provides:
+ *   valid manifest, fetched webpage (HTML not NULL), the docID it was saved as
+ * We return:
+ *   true if the record was added; false on bad parameters or out of memory.
+ * We do:
+ *   compute the page file's size and HTML offset exactly as pagedir_save()
+ *   lays them out, hash the HTML, and stamp the record with the current time.
+ */
+bool manifest_add(manifest_t* manifest, const webpage_t* page, const int docID);
+
+
+/**************** manifest_save ****************/
+/* Write the manifest to pageDirectory/.manifest.
+ *
+ * We return:
+ *   true on success; false if the file cannot be written.
+ * Notes:
+ *   the file is written under a temporary name and renamed into place, so a
+ *   reader never sees a partially written manifest.
+ */
+bool manifest_save(manifest_t* manifest, const char* pageDirectory);
+
+
+/**************** manifest_load ****************/
+/* Load pageDirectory/.manifest.
+ *
+ * We return:
+ *   pointer to a new manifest; NULL if there is no manifest or it is
+ *   malformed (e.g. directories written by older crawlers).
+ * Caller is responsible for:
+ *   later calling manifest_delete().
+ */
+manifest_t* manifest_load(const char* pageDirectory);
+
+
+/**************** manifest_count ****************/
+/* Return the number of records in the manifest; 0 if manifest is NULL. */
+int manifest_count(const manifest_t* manifest);
+
+
+/**************** manifest_get ****************/
+/* Return the i'th record (0 <= i < manifest_count), or NULL if out of range.
+ * Records are in increasing docID order. */
+const manifest_entry_t* manifest_get(const manifest_t* manifest, const int i);
+
+
+/**************** manifest_getURL ****************/
+/* Return the URL of a record; the string belongs to the manifest. */
+const char* manifest_getURL(const manifest_t* manifest, const manifest_entry_t* entry);
+
+
+/**************** manifest_delete ****************/
+/* Free all memory held by the manifest. We ignore NULL. */
+void manifest_delete(manifest_t* manifest);
+
+#endif // __MANIFEST_H
@@ -0,0 +1,335 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: merge.c
+Description: (CS-50) Module to merge index files k ways in bounded memory.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // for getline
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include "merge.h"
+#include "indexfile.h"
+#include "stemmer.h"
+#include "mem.h"
+
+/**************** local types ****************/
+/* An input being merged, at its current word */
+typedef struct merge_stream {
+    const char* word;       // current word; NULL once the input is done
+    FILE* fp;               // a text input: its file and current line, split into word and postings
+    char* line;
+    size_t capacity;
+    char* postings;         // "docID count ..." after the word (inside line)
+    indexfile_t* file;      // a binary input: its mapping and the number of the current word
+    int current;
+    char* wordBuf;          // the current word of a binary input
+    const uint8_t* dead;
+    int deadBytes;
+} merge_stream_t;
+
+/* One posting of the word being merged */
+typedef struct merge_posting {
+    int docID;
+    int count;
+} merge_posting_t;
+
+/* The postings of the word being merged, gathered from every input holding it */
+typedef struct merge_word {
+    merge_posting_t* postings;
+    int numPostings;
+    int capacity;
+    bool sorted;            // docIDs increase in the order gathered
+    const merge_stream_t* stream;   // the input being gathered, for its tombstones
+} merge_word_t;
+
+/**************** local functions ****************/
+static bool stream_open(merge_stream_t* stream, const merge_input_t* input);
+static bool stream_advance(merge_stream_t* stream);
+static bool stream_gather(merge_stream_t* stream, merge_word_t* gathered);
+static void stream_close(merge_stream_t* stream);
+static bool gather_posting(void* arg, const int docID, const int count);
+static int compare_postings(const void* a, const void* b);
+static bool stream_less(const merge_stream_t* streams, const int a, const int b);
+static void heap_siftDown(int* heap, const int size, int i, const merge_stream_t* streams);
+
+
+/**************** global functions ****************/
+bool merge_indexes(const merge_input_t* inputs, const int numInputs, const char* path, const bool binary){
+    if (inputs == NULL || numInputs < 1 || path == NULL) {
+        return false;
+    }
+    merge_stream_t* streams = mem_calloc(numInputs, sizeof(merge_stream_t));
+    int* heap = mem_malloc(numInputs * sizeof(int)); // min-heap of input numbers, keyed by current word
+    bool ok = (streams != NULL && heap != NULL);
+    int heapSize = 0;
+
+    // Open every input at its first word
+    for (int n = 0; ok && n < numInputs; n++) {
+        ok = stream_open(&streams[n], &inputs[n]) && stream_advance(&streams[n]);
+        if (!ok) {
+            fprintf(stderr, "Error: cannot read index %s to merge\n", inputs[n].path);
+        } else if (streams[n].word != NULL) {
+            heap[heapSize++] = n;
+        }
+    }
+    for (int i = heapSize / 2 - 1; ok && i >= 0; i--) {
+        heap_siftDown(heap, heapSize, i, streams);
+    }
+
+    FILE* out = NULL;
+    indexfile_writer_t* writer = NULL;
+    if (ok && binary) {
+        ok = (writer = indexfile_create(path, stemmer_enabled() ? INDEXFILE_STEMMED : 0)) != NULL;
+    } else if (ok) {
+        ok = (out = fopen(path, "w")) != NULL;
+    }
+
+    // Repeatedly take the smallest word and gather its postings from every input that has it
+    merge_word_t gathered = {NULL, 0, 0, true, NULL};
+    char* word = NULL;
+    size_t wordCapacity = 0;
+    while (ok && heapSize > 0) {
+        size_t len = strlen(streams[heap[0]].word);
+        if (len + 1 > wordCapacity) {
+            char* bigger = realloc(word, len + 1);
+            if (bigger == NULL) {
+                ok = false;
+                break;
+            }
+            word = bigger;
+            wordCapacity = len + 1;
+        }
+        memcpy(word, streams[heap[0]].word, len + 1); // The input's word is about to be replaced
+
+        gathered.numPostings = 0;
+        gathered.sorted = true;
+        while (ok && heapSize > 0 && strcmp(streams[heap[0]].word, word) == 0) {
+            merge_stream_t* stream = &streams[heap[0]];
+            ok = stream_gather(stream, &gathered) && stream_advance(stream);
+            if (!ok) {
+                fprintf(stderr, "Error: cannot merge index %s at '%s'\n", inputs[heap[0]].path, word);
+                break;
+            }
+            if (stream->word == NULL) { // Input exhausted: drop it from the heap
+                heap[0] = heap[--heapSize];
+            }
+            heap_siftDown(heap, heapSize, 0, streams);
+        }
+        if (!ok || gathered.numPostings == 0) {
+            continue; // Every posting dead: leave the word out
+        }
+
+        // Postings out of order (or repeated) are sorted, and a docID's counts added
+        int numPostings = gathered.numPostings;
+        if (!gathered.sorted) {
+            qsort(gathered.postings, gathered.numPostings, sizeof(merge_posting_t), compare_postings);
+            numPostings = 0;
+            for (int j = 0; j < gathered.numPostings; j++) {
+                merge_posting_t* posting = &gathered.postings[j];
+                if (numPostings > 0 && gathered.postings[numPostings - 1].docID == posting->docID) {
+                    int* count = &gathered.postings[numPostings - 1].count;
+                    *count = (*count > INT_MAX - posting->count) ? INT_MAX : *count + posting->count;
+                } else {
+                    gathered.postings[numPostings++] = *posting;
+                }
+            }
+        }
+        if (binary) {
+            ok = indexfile_addWord(writer, word);
+            for (int j = 0; ok && j < numPostings; j++) {
+                ok = indexfile_addPosting(writer, gathered.postings[j].docID, gathered.postings[j].count);
+            }
+        } else {
+            fputs(word, out);
+            for (int j = 0; j < numPostings; j++) {
+                fprintf(out, " %d %d", gathered.postings[j].docID, gathered.postings[j].count);
+            }
+            fputc('\n', out);
+        }
+    }
+    free(word);
+    free(gathered.postings);
+
+    if (writer != NULL) {
+        ok = indexfile_finish(writer) && ok;
+    }
+    if (out != NULL) {
+        ok = ok && !ferror(out);
+        ok = (fclose(out) == 0) && ok;
+    }
+    if (!ok && (writer != NULL || out != NULL)) {
+        remove(path);
+    }
+    for (int n = 0; streams != NULL && n < numInputs; n++) {
+        stream_close(&streams[n]);
+    }
+    mem_free(streams);
+    mem_free(heap);
+    return ok;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Open an input: a binary index is mapped, a text index read a line at a time */
+static bool stream_open(merge_stream_t* stream, const merge_input_t* input){
+    if (input->path == NULL) {
+        return false;
+    }
+    stream->current = -1;
+    stream->dead = input->dead;
+    stream->deadBytes = (input->dead != NULL) ? input->deadBytes : 0;
+    if (indexfile_is(input->path)) {
+        stream->file = indexfile_open(input->path);
+        stream->wordBuf = (stream->file != NULL) ? malloc(indexfile_maxWordBytes(stream->file)) : NULL;
+        return stream->wordBuf != NULL;
+    }
+    stream->fp = fopen(input->path, "r");
+    return stream->fp != NULL;
+}
+
+/* Move to the input's next word (word is NULL past the last); false if the input is damaged */
+static bool stream_advance(merge_stream_t* stream){
+    stream->word = NULL;
+    if (stream->file != NULL) {
+        if (stream->current + 1 >= indexfile_numWords(stream->file)) {
+            return true;
+        }
+        stream->current++;
+        if (!indexfile_word(stream->file, stream->current, stream->wordBuf)) {
+            return false;
+        }
+        stream->word = stream->wordBuf;
+        return true;
+    }
+
+    ssize_t n;
+    do { // Skip blank lines
+        n = getline(&stream->line, &stream->capacity, stream->fp);
+        if (n <= 0) {
+            return !ferror(stream->fp);
+        }
+        if (stream->line[n - 1] == '\n') {
+            stream->line[--n] = '\0';
+        }
+    } while (n == 0);
+    char* space = strchr(stream->line, ' ');
+    if (space == NULL) {
+        stream->postings = stream->line + n; // Word with no postings
+    } else {
+        *space = '\0';
+        stream->postings = space + 1;
+    }
+    stream->word = stream->line;
+    return true;
+}
+
+/* Add the live postings of the input's current word to gathered; false if they are malformed or
+ * out of memory */
+static bool stream_gather(merge_stream_t* stream, merge_word_t* gathered){
+    gathered->stream = stream;
+    if (stream->file != NULL) {
+        return indexfile_iteratePostings(stream->file, stream->current, gathered, gather_posting);
+    }
+
+    // docID count [docID count]...
+    char* cursor = stream->postings;
+    while (true) {
+        while (*cursor == ' ') {
+            cursor++;
+        }
+        if (*cursor == '\0') {
+            return true;
+        }
+        char* end;
+        errno = 0;
+        long docID = strtol(cursor, &end, 10);
+        if (end == cursor || *end != ' ' || errno != 0 || docID < 1 || docID > INT_MAX) {
+            return false;
+        }
+        cursor = end;
+        long count = strtol(cursor, &end, 10);
+        if (end == cursor || (*end != ' ' && *end != '\0') || errno != 0 || count < 0 || count > INT_MAX) {
+            return false;
+        }
+        cursor = end;
+        if (!gather_posting(gathered, (int) docID, (int) count)) {
+            return false;
+        }
+    }
+}
+
+static void stream_close(merge_stream_t* stream){
+    if (stream->fp != NULL) {
+        fclose(stream->fp);
+    }
+    free(stream->line);
+    indexfile_close(stream->file);
+    free(stream->wordBuf);
+}
+
+/* Append a posting of the word being merged, unless the input's tombstones drop it or its count is
+ * 0 (a hidden posting) */
+static bool gather_posting(void* arg, const int docID, const int count){
+    merge_word_t* gathered = arg;
+    const merge_stream_t* stream = gathered->stream;
+    if (count <= 0 || (docID / 8 < stream->deadBytes && (stream->dead[docID / 8] & (1 << (docID % 8))) != 0)) {
+        return true;
+    }
+    if (gathered->numPostings == gathered->capacity) {
+        int capacity = (gathered->capacity == 0) ? 64 : gathered->capacity * 2;
+        merge_posting_t* postings = realloc(gathered->postings, capacity * sizeof(merge_posting_t));
+        if (postings == NULL) {
+            return false;
+        }
+        gathered->postings = postings;
+        gathered->capacity = capacity;
+    }
+    int n = gathered->numPostings;
+    if (n > 0 && gathered->postings[n - 1].docID >= docID) {
+        gathered->sorted = false;
+    }
+    gathered->postings[n].docID = docID;
+    gathered->postings[n].count = count;
+    gathered->numPostings++;
+    return true;
+}
+
+/* qsort comparator for postings, by docID; equal docIDs keep no particular order, as counts are added */
+static int compare_postings(const void* a, const void* b){
+    int docA = ((const merge_posting_t*) a)->docID;
+    int docB = ((const merge_posting_t*) b)->docID;
+    return (docA > docB) - (docA < docB);
+}
+
+/* Order inputs by current word, then by input number so a word's postings are gathered in input order */
+static bool stream_less(const merge_stream_t* streams, const int a, const int b){
+    int cmp = strcmp(streams[a].word, streams[b].word);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+static void heap_siftDown(int* heap, const int size, int i, const merge_stream_t* streams){
+    while (true) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && stream_less(streams, heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < size && stream_less(streams, heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        int tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
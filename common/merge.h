@@ -0,0 +1,53 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: merge.h
+Description: header file for CS50 merge module
+
+ * Merging index files. Every way of building an index in pieces ends in a
+ * merge: SPIMI runs, incremental deltas folded into each other or into the
+ * base. merge_indexes streams any number of index files, text or binary,
+ * into one. Their words are merged k ways through a heap, each input
+ * holding just its current word (one line of a text file, or one decoded
+ * word of a mapped binary file), so memory holds one word per input plus
+ * the postings of the word being written, however large the inputs are.
+ *
+ * Each input may carry tombstones: a bitmap of docIDs whose postings in
+ * that input are dropped (bit d is dead[d / 8] & (1 << (d % 8)), the
+ * layout of a segment's .dead file). A word's postings are taken from the
+ * inputs in order and concatenated while their docIDs increase, as when
+ * the inputs hold consecutive docID ranges; otherwise they are sorted by
+ * docID, and counts of a docID found in several inputs are added.
+ */
+
+#ifndef __MERGE_H
+#define __MERGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************** global types ****************/
+typedef struct merge_input {
+    const char* path;       // an index file, text (saveIndex_toPage) or binary (saveIndex_toBinary)
+    const uint8_t* dead;    // tombstones: this input's postings of these docIDs are dropped; NULL for none
+    int deadBytes;          // length of dead
+} merge_input_t;
+
+
+/**************** merge_indexes ****************/
+/* Merge index files into one.
+ *
+ * Caller provides:
+ *   the inputs, how many there are (at least 1), the file to write (not one
+ *   of the inputs), and whether to write it as binary.
+ * We return:
+ *   true on success; false if an input can't be read or is malformed, or
+ *   the output can't be written (the partial output is then removed).
+ * We guarantee:
+ *   the output is what saving an index holding every live posting of every
+ *   input would write: words in strcmp order, each with its postings in
+ *   increasing docID order, and no word whose postings are all dead.
+ */
+bool merge_indexes(const merge_input_t* inputs, const int numInputs, const char* path, const bool binary);
+
+#endif // __MERGE_H
@@ -5,26 +5,68 @@ File: pagedir.c
 Description: A module for a Tiny Search Engine Crawler
 */
 
+#define _GNU_SOURCE  // for syncfs
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "pagedir.h"
 #include "webpage.h"
 #include "file.h"
 #include "mem.h"     // for mem_assert
+#include "manifest.h"
+
+/**************** local types ****************/
+/* A serialized page waiting to be written */
+typedef struct pagedir_job {
+    int docID;     // file name within pageDirectory
+    char* data;    // "URL\n" "depth\n" HTML, exactly as pagedir_save writes it
+    size_t len;    // bytes in data
+} pagedir_job_t;
+
+/**************** global types ****************/
+typedef struct pagedir_writer {
+    char* pageDirectory;      // where pages are written
+    int dirfd;                // open descriptor for pageDirectory, used to sync it
+    pagedir_job_t* queue;     // ring buffer of pending pages
+    int capacity;             // slots in the ring buffer
+    int head;                 // index of the oldest pending page
+    int count;                // number of pending pages
+    int segmentSize;          // pages written between syncs
+    bool closing;             // set by pagedir_writer_close
+    bool failed;              // set by the writer thread if any write fails
+    pthread_mutex_t lock;     // protects queue, head, count, closing
+    pthread_cond_t notEmpty;  // signaled when a page is queued or closing is set
+    pthread_cond_t notFull;   // signaled when the writer takes pages off the queue
+    pthread_t thread;         // the writer thread
+} pagedir_writer_t;
+
+/**************** local functions ****************/
+static void* writer_thread(void* arg);
+static int writer_writePage(pagedir_writer_t* writer, pagedir_job_t* job);
+static bool writer_syncSegment(pagedir_writer_t* writer, int* fds, int* numOpen);
 
 /* Function to create the hidden file .crawler in the "pageDirectory: directory */
 bool pagedir_init(const char* pageDirectory) {
-    char* pathname = mem_malloc(strlen(pageDirectory) + 10); // Construct the pathname for the .crawler file
+    char* pathname = mem_malloc(strlen(pageDirectory) + 12); // Room for "/.crawler" or "/.manifest"
     sprintf(pathname, "%s/.crawler", pageDirectory);
     
     FILE* fp = fopen(pathname, "w"); // Open the file for writing
-    mem_free(pathname);
     
     if (fp == NULL) { // Exit with false status if error
+        mem_free(pathname);
         return false;
     }
+
+    // Remove any manifest left by an earlier crawl; it no longer describes this directory
+    sprintf(pathname, "%s/.manifest", pageDirectory);
+    remove(pathname);
+    mem_free(pathname);
     
     fclose(fp); // Close new file
     return true;
@@ -55,6 +97,118 @@ void pagedir_save(const webpage_t* page, const char* pageDirectory, const int do
 }
 
 
+pagedir_writer_t* pagedir_writer_new(const char* pageDirectory, const int queueSize, const int segmentSize){
+    if (pageDirectory == NULL || queueSize <= 0 || segmentSize <= 0) {
+        return NULL;
+    }
+    pagedir_writer_t* writer = mem_calloc(1, sizeof(pagedir_writer_t));
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->pageDirectory = mem_malloc(strlen(pageDirectory) + 1);
+    writer->queue = mem_calloc(queueSize, sizeof(pagedir_job_t));
+    writer->dirfd = open(pageDirectory, O_RDONLY);
+    if (writer->pageDirectory == NULL || writer->queue == NULL || writer->dirfd < 0) {
+        if (writer->dirfd >= 0) {
+            close(writer->dirfd);
+        }
+        mem_free(writer->pageDirectory);
+        mem_free(writer->queue);
+        mem_free(writer);
+        return NULL;
+    }
+    strcpy(writer->pageDirectory, pageDirectory);
+    writer->capacity = queueSize;
+    writer->segmentSize = segmentSize;
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->notEmpty, NULL);
+    pthread_cond_init(&writer->notFull, NULL);
+    if (pthread_create(&writer->thread, NULL, writer_thread, writer) != 0) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->notEmpty);
+        pthread_cond_destroy(&writer->notFull);
+        close(writer->dirfd);
+        mem_free(writer->pageDirectory);
+        mem_free(writer->queue);
+        mem_free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+
+bool pagedir_writer_save(pagedir_writer_t* writer, const webpage_t* page, const int docID){
+    if (writer == NULL || page == NULL || webpage_getHTML(page) == NULL || docID <= 0) {
+        return false;
+    }
+
+    // Serialize the page once, on this thread, so the caller can delete it right away
+    const char* url = webpage_getURL(page);
+    const char* html = webpage_getHTML(page);
+    char depthStr[16];
+    int depthLen = snprintf(depthStr, sizeof(depthStr), "%d", webpage_getDepth(page));
+    size_t urlLen = strlen(url);
+    size_t htmlLen = strlen(html);
+
+    pagedir_job_t job;
+    job.docID = docID;
+    job.len = urlLen + 1 + depthLen + 1 + htmlLen;
+    job.data = malloc(job.len);
+    if (job.data == NULL) {
+        return false;
+    }
+    char* p = job.data;
+    memcpy(p, url, urlLen);
+    p += urlLen;
+    *p++ = '\n';
+    memcpy(p, depthStr, depthLen);
+    p += depthLen;
+    *p++ = '\n';
+    memcpy(p, html, htmlLen);
+
+    // Wait for room in the queue, then hand the page to the writer thread
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == writer->capacity && !writer->failed) {
+        pthread_cond_wait(&writer->notFull, &writer->lock);
+    }
+    if (writer->failed) {
+        pthread_mutex_unlock(&writer->lock);
+        free(job.data);
+        return false;
+    }
+    writer->queue[(writer->head + writer->count) % writer->capacity] = job;
+    writer->count++;
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_mutex_unlock(&writer->lock);
+    return true;
+}
+
+
+bool pagedir_writer_close(pagedir_writer_t* writer){
+    if (writer == NULL) {
+        return false;
+    }
+
+    // Let the thread drain the queue, then wait for it to finish
+    pthread_mutex_lock(&writer->lock);
+    writer->closing = true;
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    bool ok = !writer->failed;
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->notEmpty);
+    pthread_cond_destroy(&writer->notFull);
+    close(writer->dirfd);
+    mem_free(writer->pageDirectory);
+    mem_free(writer->queue);
+    mem_free(writer);
+    return ok;
+}
+
+
 bool is_crawler_directory(const char* dir_path) {
     if (dir_path == NULL) {
         return false;
@@ -136,14 +290,238 @@ webpage_t* webpage_create_fromFile(FILE* fp){
 }
 
 
+int pagedir_listDocs(const char* pageDirectory, int** docIDs, uint64_t** sizes){
+    manifest_t* manifest = manifest_load(pageDirectory);
+    int numDocs = 0;
+    int capacity = manifest_count(manifest) > 0 ? manifest_count(manifest) : 64;
+    *docIDs = malloc(capacity * sizeof(int));
+    *sizes = malloc(capacity * sizeof(uint64_t));
+    if (*docIDs == NULL || *sizes == NULL) {
+        fprintf(stderr, "Error: out of memory listing documents in %s\n", pageDirectory);
+        manifest_delete(manifest);
+        free(*docIDs);
+        free(*sizes);
+        return -1;
+    }
+
+    if (manifest != NULL) {
+        // The manifest lists every saved document, so a missing file is reported and skipped, not fatal
+        for (int i = 0; i < manifest_count(manifest); i++) {
+            (*docIDs)[numDocs] = manifest_get(manifest, i)->docID;
+            (*sizes)[numDocs++] = manifest_get(manifest, i)->size;
+        }
+        manifest_delete(manifest);
+        if (numDocs == 0) {
+            fprintf(stderr, "Error: manifest in %s lists no documents\n", pageDirectory);
+            free(*docIDs);
+            free(*sizes);
+            return -1;
+        }
+        return numDocs;
+    }
+
+    // No manifest (older crawler): count files until we can't open one (end of crawled files)
+    int path_len = strlen(pageDirectory) + 20;
+    char* filepath = mem_malloc(path_len);
+    for (int docID = 1; filepath != NULL; docID++) {
+        snprintf(filepath, path_len, "%s/%d", pageDirectory, docID);
+        FILE* fp = fopen(filepath, "r");
+        if (fp == NULL) {
+            break; // We've reached the end
+        }
+        fclose(fp);
+        if (numDocs == capacity) {
+            capacity *= 2;
+            int* moreIDs = realloc(*docIDs, capacity * sizeof(int));
+            if (moreIDs != NULL) {
+                *docIDs = moreIDs;
+            }
+            uint64_t* moreSizes = realloc(*sizes, capacity * sizeof(uint64_t));
+            if (moreSizes != NULL) {
+                *sizes = moreSizes;
+            }
+            if (moreIDs == NULL || moreSizes == NULL) {
+                numDocs = 0; // Out of memory
+                break;
+            }
+        }
+        (*docIDs)[numDocs] = docID;
+        (*sizes)[numDocs++] = 1; // Sizes unknown; balance by document count
+    }
+    mem_free(filepath);
+
+    if (numDocs == 0) { // Not even the first file exists
+        fprintf(stderr, "Error: Unable to open file %s/1\n", pageDirectory);
+        free(*docIDs);
+        free(*sizes);
+        return -1;
+    }
+    return numDocs;
+}
+
+
+webpage_t* pagedir_load(const char* pageDirectory, const int docID){
+    if (pageDirectory == NULL || docID <= 0) {
+        return NULL;
+    }
+    int path_len = strlen(pageDirectory) + 20;  // Room for "/" and the docID
+    char* filepath = mem_malloc(path_len);
+    if (filepath == NULL) {
+        return NULL;
+    }
+    snprintf(filepath, path_len, "%s/%d", pageDirectory, docID);
+
+    FILE* fp = fopen(filepath, "r");
+    mem_free(filepath);
+    if (fp == NULL) {
+        return NULL;
+    }
+    webpage_t* page = webpage_create_fromFile(fp);
+    fclose(fp);
+    return page;
+}
+
+
 char* get_url(char* pageDirectory, int docID){
-    int path_len = strlen(pageDirectory) + 5;  // Store the buffer length for docID
+    int path_len = strlen(pageDirectory) + 13;  // Room for "/", any int docID and the NUL
     char* filepath = malloc(path_len); // Allocate memory for the filepath string
     sprintf(filepath, "%s/%d", pageDirectory, docID); // Create the filepath
     
     FILE* fp = fopen(filepath, "r");
-    char* URL = file_readLine(fp); // Read in URL from first line of the file
     mem_free(filepath); // Free URL
+    if (fp == NULL) {
+        return NULL; // No such document
+    }
+    char* URL = file_readLine(fp); // Read in URL from first line of the file
     fclose(fp);
     return URL;
-}
\ No newline at end of file
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Writer thread: take every queued page at once, write each one, and sync once per segment */
+static void* writer_thread(void* arg){
+    pagedir_writer_t* writer = arg;
+    pagedir_job_t* batch = malloc(writer->capacity * sizeof(pagedir_job_t));
+    int* fds = malloc(writer->segmentSize * sizeof(int)); // files written since the last sync
+    int numOpen = 0;
+    bool ok = (batch != NULL && fds != NULL);
+
+    while (true) {
+        pthread_mutex_lock(&writer->lock);
+        while (writer->count == 0 && !writer->closing) {
+            pthread_cond_wait(&writer->notEmpty, &writer->lock);
+        }
+        if (writer->count == 0) { // Closing and nothing left to write
+            pthread_mutex_unlock(&writer->lock);
+            break;
+        }
+
+        // Take the whole queue as one batch
+        int numJobs = 0;
+        while (writer->count > 0) {
+            if (batch != NULL) {
+                batch[numJobs++] = writer->queue[writer->head];
+            } else {
+                free(writer->queue[writer->head].data); // Can't write without a batch buffer
+            }
+            writer->head = (writer->head + 1) % writer->capacity;
+            writer->count--;
+        }
+        pthread_cond_broadcast(&writer->notFull);
+        pthread_mutex_unlock(&writer->lock);
+
+        for (int i = 0; i < numJobs; i++) {
+            if (ok) {
+                int fd = writer_writePage(writer, &batch[i]);
+                if (fd < 0) {
+                    ok = false;
+                } else {
+                    fds[numOpen++] = fd;
+                    if (numOpen == writer->segmentSize) { // End of a segment
+                        ok = writer_syncSegment(writer, fds, &numOpen);
+                    }
+                }
+            }
+            free(batch[i].data);
+        }
+
+        if (!ok) { // Record the failure and wake up any producer waiting for room
+            pthread_mutex_lock(&writer->lock);
+            writer->failed = true;
+            pthread_cond_broadcast(&writer->notFull);
+            pthread_mutex_unlock(&writer->lock);
+        }
+    }
+
+    if (fds != NULL && !writer_syncSegment(writer, fds, &numOpen)) {
+        ok = false;
+    }
+    if (!ok) {
+        pthread_mutex_lock(&writer->lock);
+        writer->failed = true;
+        pthread_mutex_unlock(&writer->lock);
+    }
+    free(batch);
+    free(fds);
+    return NULL;
+}
+
+/* Write one serialized page with a single write (retrying short writes); return its open fd, or -1 on error */
+static int writer_writePage(pagedir_writer_t* writer, pagedir_job_t* job){
+    int path_len = strlen(writer->pageDirectory) + 20;
+    char* pathname = malloc(path_len);
+    if (pathname == NULL) {
+        return -1;
+    }
+    snprintf(pathname, path_len, "%s/%d", writer->pageDirectory, job->docID);
+
+    int fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open file %s\n", pathname);
+        free(pathname);
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < job->len) {
+        ssize_t n = write(fd, job->data + written, job->len - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            fprintf(stderr, "Error: failed writing %s\n", pathname);
+            close(fd);
+            free(pathname);
+            return -1;
+        }
+        written += n;
+    }
+    free(pathname);
+    return fd;
+}
+
+/* Make every file written in this segment durable, then close them */
+static bool writer_syncSegment(pagedir_writer_t* writer, int* fds, int* numOpen){
+    if (*numOpen == 0) {
+        return true;
+    }
+    bool ok = true;
+#ifdef __linux__
+    // One syncfs covers every file in the segment and the directory entries
+    ok = (syncfs(writer->dirfd) == 0);
+#else
+    for (int i = 0; i < *numOpen; i++) {
+        ok = (fsync(fds[i]) == 0) && ok;
+    }
+    ok = (fsync(writer->dirfd) == 0) && ok;
+#endif
+    for (int i = 0; i < *numOpen; i++) {
+        ok = (close(fds[i]) == 0) && ok;
+    }
+    *numOpen = 0;
+    if (!ok) {
+        fprintf(stderr, "Error: failed to sync pages to %s\n", writer->pageDirectory);
+    }
+    return ok;
+}
@@ -9,6 +9,7 @@ Description: header file for CS50 pagedir module
 #define __PAGEDIR_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "webpage.h"  // for webpage_t type
 
 /* Initialize the page directory by creating the .crawler file.
@@ -27,6 +28,55 @@ bool pagedir_init(const char* pageDirectory);
 void pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID);
 
 
+/**************** pagedir_writer ****************/
+/* A write-behind stage for pagedir_save: pages are queued by the crawl loop and
+ * written to pageDirectory by a background thread, so disk latency does not add
+ * to network latency. The writer batches whatever is queued, writes each page
+ * with a single large write, and makes pages durable once per segment of
+ * pages rather than once per page.
+ */
+typedef struct pagedir_writer pagedir_writer_t;
+
+
+/**************** pagedir_writer_new ****************/
+/* Start a writer thread for pageDirectory.
+ *
+ * Caller provides:
+ *   pageDirectory - an initialized page directory (see pagedir_init)
+ *   queueSize - maximum number of pages waiting to be written (must be > 0)
+ *   segmentSize - number of pages written between syncs to disk (must be > 0)
+ * We return:
+ *   pointer to a new writer; NULL on bad parameters or error starting the thread.
+ * Caller is responsible for:
+ *   later calling pagedir_writer_close().
+ */
+pagedir_writer_t* pagedir_writer_new(const char* pageDirectory, const int queueSize, const int segmentSize);
+
+
+/**************** pagedir_writer_save ****************/
+/* Queue a webpage to be saved as pageDirectory/docID, in the same file format
+ * as pagedir_save. The page is copied, so caller may delete it right away.
+ *
+ * We return:
+ *   true if the page was queued; false on bad parameters, out of memory, or if
+ *   an earlier write has already failed.
+ * Notes:
+ *   blocks while the queue is full, so memory use stays bounded.
+ */
+bool pagedir_writer_save(pagedir_writer_t* writer, const webpage_t* page, const int docID);
+
+
+/**************** pagedir_writer_close ****************/
+/* Write out all queued pages, sync them to disk, stop the thread and free the writer.
+ *
+ * We return:
+ *   true if every queued page was written and synced; false otherwise.
+ * Notes:
+ *   we ignore NULL writer (and return false).
+ */
+bool pagedir_writer_close(pagedir_writer_t* writer);
+
+
 /* Check if the pageDirectory argument , dir_path, is a valid directory created by the crawler.
  * Parameters:
  *   dir_path - the directory to check
@@ -51,6 +101,37 @@ bool is_crawler_directory(const char* dir_path);
 webpage_t* webpage_create_fromFile(FILE* fp);
 
 
+/**************** pagedir_listDocs ****************/
+/* List the documents in a page directory, in increasing docID order.
+ *
+ * Caller provides:
+ *   pageDirectory - a directory written by the crawler
+ *   docIDs, sizes - where to store two new arrays of numDocs entries
+ * We return:
+ *   the number of documents; -1 on error (no documents, out of memory),
+ *   after printing an error message.
+ * We do:
+ *   use pageDirectory/.manifest when there is one, with each document's size
+ *   in bytes; otherwise probe pageDirectory/1, /2, ... until a file cannot be
+ *   opened, giving every document size 1.
+ * Caller is responsible for:
+ *   later calling free() on *docIDs and *sizes (only when we return > 0).
+ */
+int pagedir_listDocs(const char* pageDirectory, int** docIDs, uint64_t** sizes);
+
+
+/**************** pagedir_load ****************/
+/* Load the webpage saved as pageDirectory/docID.
+ *
+ * We return:
+ *   pointer to new webpage_t (URL, depth and HTML filled in), or NULL if the
+ *   file cannot be opened or read.
+ * Caller is responsible for:
+ *   later calling webpage_delete with the returned pointer.
+ */
+webpage_t* pagedir_load(const char* pageDirectory, const int docID);
+
+
 /**************** get_url ****************/
 /* 
  * Retrieve the URL for a document from its file in the page directory.
@@ -0,0 +1,255 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: postings.c
+Description: (CS-50) Module to compress blocks of postings with StreamVByte, decoding with SIMD where available.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include "postings.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define POSTINGS_X86 1
+#endif
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+/* Decode n values of one stream into out; with delta, each value is a gap added to the one before (prev first) */
+typedef void (*decode_fn)(const uint8_t* controls, const uint8_t* data, const int n, uint32_t prev,
+                          const bool delta, uint32_t* out);
+
+/*------------------------------------------------- Local Functions --------------------------------------------------*/
+static void choose_decode(void);
+static size_t stream_encode(const uint32_t* values, const int n, uint8_t* out);
+static size_t stream_length(const uint8_t* controls, const int n);
+static void decode_scalar(const uint8_t* controls, const uint8_t* data, const int n, uint32_t prev,
+                          const bool delta, uint32_t* out);
+#ifdef POSTINGS_X86
+static void decode_ssse3(const uint8_t* controls, const uint8_t* data, const int n, uint32_t prev,
+                         const bool delta, uint32_t* out);
+#endif
+
+/*------------------------------------------------- Local Variables --------------------------------------------------*/
+static pthread_once_t decodeOnce = PTHREAD_ONCE_INIT;
+static decode_fn decode = decode_scalar;
+static const char* decodeName = "scalar";
+static uint8_t lengths[256];       // bytes of data the four values of a control byte take
+static uint8_t shuffles[256][16];  // for each control byte, where each output byte comes from (0x80: zero)
+
+
+/*----------------------------------------------- Global Functions ----------------------------------------------------*/
+size_t postings_encode(const int* docIDs, const int* counts, const int n, const int prevDocID, uint8_t* out){
+    uint32_t values[POSTINGS_BLOCK];
+    int prev = prevDocID;
+    for (int i = 0; i < n; i++) {
+        values[i] = (uint32_t) (docIDs[i] - prev);
+        prev = docIDs[i];
+    }
+    size_t used = stream_encode(values, n, out);
+    for (int i = 0; i < n; i++) {
+        values[i] = (uint32_t) counts[i];
+    }
+    return used + stream_encode(values, n, out + used);
+}
+
+
+size_t postings_decode(const uint8_t* in, const size_t avail, const int n, const int prevDocID,
+                       int* docIDs, int* counts){
+    pthread_once(&decodeOnce, choose_decode);
+    size_t numControls = (n + 3) / 4;
+    if (n < 1 || n > POSTINGS_BLOCK || avail < 2 * numControls) {
+        return 0;
+    }
+    // Both streams must lie within the section; their controls say how long they are
+    size_t gapBytes = stream_length(in, n);
+    if (gapBytes > avail - numControls) {
+        return 0;
+    }
+    size_t countBytes = stream_length(in + gapBytes, n);
+    if (countBytes > avail - gapBytes) {
+        return 0;
+    }
+    (*decode)(in, in + numControls, n, (uint32_t) prevDocID, true, (uint32_t*) docIDs);
+    (*decode)(in + gapBytes, in + gapBytes + numControls, n, 0, false, (uint32_t*) counts);
+    return gapBytes + countBytes;
+}
+
+
+size_t postings_encodePositions(const int* positions, const int n, uint8_t* out){
+    uint8_t* at = out;
+    int prev = -1;
+    for (int i = 0; i < n; i++) {
+        uint32_t gap = (uint32_t) (positions[i] - prev);
+        prev = positions[i];
+        for ( ; gap >= 0x80; gap >>= 7) {
+            *at++ = (uint8_t) (gap | 0x80);
+        }
+        *at++ = (uint8_t) gap;
+    }
+    return at - out;
+}
+
+
+size_t postings_decodePositions(const uint8_t* in, const size_t avail, const int n, int* positions){
+    size_t used = 0;
+    int64_t prev = -1;
+    for (int i = 0; i < n; i++) {
+        uint32_t gap = 0;
+        uint8_t byte;
+        int shift = 0;
+        do {
+            if (used == avail || shift > 28) {
+                return 0;
+            }
+            byte = in[used++];
+            gap |= (uint32_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (gap == 0 || prev + gap > INT_MAX) {
+            return 0;
+        }
+        prev += gap;
+        positions[i] = (int) prev;
+    }
+    return used;
+}
+
+
+size_t postings_skipPositions(const uint8_t* in, const size_t avail, const long n){
+    // Each position ends with the first byte whose top bit is clear; count eight of those at a time
+    const uint64_t tops = 0x8080808080808080ull;
+    size_t used = 0;
+    long left = n;
+    while (avail - used >= 8) {
+        uint64_t word;
+        memcpy(&word, in + used, sizeof(word));
+        long ends = __builtin_popcountll(~word & tops);
+        if (ends >= left) {
+            break;
+        }
+        left -= ends;
+        used += 8;
+    }
+    while (left > 0) {
+        if (used == avail) {
+            return 0;
+        }
+        left -= (in[used++] < 0x80);
+    }
+    return used;
+}
+
+
+const char* postings_simd(void){
+    pthread_once(&decodeOnce, choose_decode);
+    return decodeName;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Build the tables, and pick SSSE3 if the CPU has it, unless TSE_POSTINGS=scalar */
+static void choose_decode(void){
+    for (int c = 0; c < 256; c++) {
+        int offset = 0;
+        for (int k = 0; k < 4; k++) {
+            int len = ((c >> (2 * k)) & 3) + 1;
+            for (int j = 0; j < 4; j++) {
+                shuffles[c][4 * k + j] = (j < len) ? offset + j : 0x80;
+            }
+            offset += len;
+        }
+        lengths[c] = offset;
+    }
+    const char* wanted = getenv("TSE_POSTINGS");
+    if (wanted != NULL && strcmp(wanted, "scalar") == 0) {
+        return;
+    }
+#ifdef POSTINGS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        decode = decode_ssse3;
+        decodeName = "ssse3";
+    }
+#endif
+}
+
+/* Write n values as a control byte per four values, then the values' bytes; return the bytes written */
+static size_t stream_encode(const uint32_t* values, const int n, uint8_t* out){
+    size_t numControls = (n + 3) / 4;
+    memset(out, 0, numControls);
+    uint8_t* data = out + numControls;
+    for (int i = 0; i < n; i++) {
+        uint32_t value = values[i];
+        int len = (value < (1u << 8)) ? 1 : (value < (1u << 16)) ? 2 : (value < (1u << 24)) ? 3 : 4;
+        out[i / 4] |= (len - 1) << (2 * (i % 4));
+        for (int b = 0; b < len; b++) {
+            *data++ = (uint8_t) (value >> (8 * b));
+        }
+    }
+    return data - out;
+}
+
+/* Return the bytes a stream of n values takes, controls included */
+static size_t stream_length(const uint8_t* controls, const int n){
+    size_t numControls = (n + 3) / 4;
+    size_t length = numControls;
+    for (int i = 0; i < n / 4; i++) {
+        length += lengths[controls[i]];
+    }
+    for (int i = n / 4 * 4; i < n; i++) { // The last control byte may be part full
+        length += ((controls[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    }
+    return length;
+}
+
+/* Portable decoder, one value at a time */
+static void decode_scalar(const uint8_t* controls, const uint8_t* data, const int n, uint32_t prev,
+                          const bool delta, uint32_t* out){
+    for (int i = 0; i < n; i++) {
+        int len = ((controls[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t value = 0;
+        for (int b = 0; b < len; b++) {
+            value |= (uint32_t) data[b] << (8 * b);
+        }
+        data += len;
+        if (delta) {
+            prev += value;
+            value = prev;
+        }
+        out[i] = value;
+    }
+}
+
+#ifdef POSTINGS_X86
+/* SSSE3 decoder: one 16-byte load and one shuffle place four values; with delta, two shifted adds
+ * turn four gaps into running sums. It may read up to 15 bytes past the stream (see POSTINGS_PADDING).
+ * Only called if the CPU has SSSE3. */
+__attribute__((target("ssse3")))
+static void decode_ssse3(const uint8_t* controls, const uint8_t* data, const int n, uint32_t prev,
+                         const bool delta, uint32_t* out){
+    __m128i base = _mm_set1_epi32((int) prev);
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4) {
+        uint8_t control = controls[i / 4];
+        __m128i bytes = _mm_loadu_si128((const __m128i*) data);
+        __m128i values = _mm_shuffle_epi8(bytes, _mm_loadu_si128((const __m128i*) shuffles[control]));
+        data += lengths[control];
+        if (delta) {
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+            values = _mm_add_epi32(values, base);
+            base = _mm_shuffle_epi32(values, 0xFF);
+        }
+        _mm_storeu_si128((__m128i*) (out + i), values);
+    }
+    if (i < n) { // The last one to three values
+        decode_scalar(controls + i / 4, data, n - i, (delta && i > 0) ? out[i - 1] : prev, delta, out + i);
+    }
+}
+#endif
@@ -0,0 +1,94 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: postings.h
+Description: header file for CS50 postings module
+
+ * Compressed posting lists for binary index files. A word's postings are
+ * cut into blocks of POSTINGS_BLOCK (the last may be shorter). A block holds
+ * two streams: the gaps between successive docIDs (the first gap is from
+ * the last docID of the previous block, or from 0), then the counts. Gaps
+ * and counts are small numbers, so each stream is StreamVByte-coded: a
+ * control byte per four values, with two bits giving each value's length
+ * (1 to 4 bytes), followed by the values' bytes, little-endian. Keeping the
+ * lengths apart from the data lets a decoder place four values at once with
+ * one byte shuffle (SSSE3, chosen when first used; plain C elsewhere).
+ *
+ * A positional index also keeps, for each posting, the positions of the
+ * word in the document (see tokenizer_position), in increasing order. They
+ * are coded apart from the blocks, in a stream of their own, so reading
+ * postings never touches them: each position is the gap from the one
+ * before (from -1 for the first, so every gap is at least 1) as a varint of
+ * 7 bits a byte, low bits first, the top bit set on all but the last byte.
+ *
+ * The environment variable TSE_POSTINGS=scalar forces the plain C decoder,
+ * for testing.
+ */
+
+#ifndef __POSTINGS_H
+#define __POSTINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**************** global constants ****************/
+#define POSTINGS_BLOCK 128    // postings per block
+#define POSTINGS_PADDING 16   // readable bytes a decoder may need past the end of a block
+#define POSTINGS_MAX_BYTES(n) (2 * (((n) + 3) / 4 + 4 * (n)))  // most bytes a block of n postings takes
+#define POSTINGS_MAX_POSITION_BYTES(n) (5 * (size_t) (n))       // most bytes n positions take
+
+/**************** postings_encode ****************/
+/* Encode a block of postings.
+ *
+ * Caller provides:
+ *   n (1 <= n <= POSTINGS_BLOCK) docIDs, increasing and greater than
+ *   prevDocID, with their counts (> 0); room for POSTINGS_MAX_BYTES(n) at out
+ * We return:
+ *   the number of bytes written.
+ */
+size_t postings_encode(const int* docIDs, const int* counts, const int n, const int prevDocID, uint8_t* out);
+
+/**************** postings_decode ****************/
+/* Decode a block of n postings.
+ *
+ * Caller provides:
+ *   the block at in, with avail bytes left in its section and at least
+ *   POSTINGS_PADDING readable bytes after those; n; the docID before the
+ *   block (0 for a word's first block); room for n docIDs and n counts
+ * We return:
+ *   the number of bytes the block took; 0 if it would run past avail.
+ * Notes:
+ *   a damaged block may decode to docIDs out of order, or counts < 1.
+ */
+size_t postings_decode(const uint8_t* in, const size_t avail, const int n, const int prevDocID,
+                       int* docIDs, int* counts);
+
+/**************** postings_encodePositions ****************/
+/* Encode the positions of one posting.
+ *
+ * Caller provides:
+ *   n >= 1 positions, increasing from 0 up; room for POSTINGS_MAX_POSITION_BYTES(n) at out
+ * We return:
+ *   the number of bytes written.
+ */
+size_t postings_encodePositions(const int* positions, const int n, uint8_t* out);
+
+/**************** postings_decodePositions ****************/
+/* Decode the n >= 1 positions of one posting from in, which has avail bytes left.
+ *
+ * We return:
+ *   the number of bytes they took; 0 if they would run past avail, or are
+ *   damaged (a gap of 0, or a position past INT_MAX).
+ */
+size_t postings_decodePositions(const uint8_t* in, const size_t avail, const int n, int* positions);
+
+/**************** postings_skipPositions ****************/
+/* Return the number of bytes n >= 1 positions at in take, without decoding
+ * them (eight bytes at a time); 0 if they would run past avail. */
+size_t postings_skipPositions(const uint8_t* in, const size_t avail, const long n);
+
+/**************** postings_simd ****************/
+/* Return the name of the decoder in use: "ssse3" or "scalar". */
+const char* postings_simd(void);
+
+#endif // __POSTINGS_H
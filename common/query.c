@@ -8,25 +8,76 @@
 
 #include "query.h"
 #include "word.h"
+#include "stopword.h"
+#include "stemmer.h"
 #include "mem.h"
 #include "counters.h"
-#include "hashtable.h"
+#include "index.h"
 #include "pagedir.h"
 
+/* ------------------------------------------------ Local Constants ---------------------------------------------------------*/
+static const int QUERY_MIN_LENGTH = 3;      // Shorter words are not indexed (as index.c's INDEX_MIN_LENGTH)
+static const char* PLACEHOLDER = "*";       // In a phrase, a word the index doesn't hold: it only takes up a position
+static const int NEAR_MAX_DIGITS = 6;       // near/k takes k from 1 to 999999
+
+/* ------------------------------------------------ Local Types -------------------------------------------------------------*/
+/* A word of an andsequence, on its own or in a phrase, as score_andsequence walks its postings */
+typedef struct query_term {
+    index_cursor_t* cursor;
+    int chain;          // -1: scored by its count; else the phrase or run of near/k operands it is in
+    long lo[2], hi[2];  // in a chain, after its first word: this word's position less the word before's
+                        // must be in [lo[0], hi[0]] or [lo[1], hi[1]]
+    int* positions;     // the current document's positions that the chain reaches (count_chain)
+    int capacity;
+} query_term_t;
+
+/* The documents kept so far by rank_results */
+typedef struct query_ranking {
+    query_hit_t* hits;  // with k > 0, a heap whose root ranks last of them
+    int num_hits;
+    int capacity;
+    int k;              // < 1: keep every match
+    int num_matches;
+    bool ok;            // false if out of memory
+} query_ranking_t;
+
 /* ------------------------------------------------ Declare local functions -------------------------------------------------*/
 static bool is_query_valid(char** words, int num_words);
-static void counter_copy_helper(void* arg, const int key, const int count);
-static void copy_counters(counters_t* src, counters_t* new);
-static void intersection_helper(void* arg, const int key, const int count);
-static void intersect_counters(counters_t* result, counters_t* counters2);
-static void union_helper(void* arg, const int key, const int count);
-static void union_counters(counters_t* result, counters_t* counters2);
-static void count_non_zero(void* arg, const int key, const int count);
-static void find_max_docID(void* arg, const int key, const int count);
+static int remove_stopwords(char** words, int num_words);
+static void stem_words(char** words, int num_words);
+static void score_andsequence(index_t** shards, const int num_shards, char** words, int num_words, const int* weights,
+                              counters_t* result);
+static bool is_wildcard(const char* word);
+static bool is_near(const char* word);
+static bool is_operator(const char* word);
+static int near_length(const char* str);
+static char* read_token(const char* query_str, int* position, bool* quoted);
+static void prepare_phrase(char* phrase);
+static void stem_phrase(char* phrase);
+static int open_terms(index_t** shards, const int num_shards, char** words, int num_words, const int* weights,
+                      query_term_t* terms);
+static int score_chains(query_term_t* terms, const int num_terms);
+static int count_chain(query_term_t* terms, const int first, const int last);
+static index_cursor_t* open_cursor(index_t** shards, const int num_shards, const char* word, const int* weights);
+static int compare_cursors(const void* a, const void* b);
+static void rank_hit(void* arg, const int key, const int count);
+static void heap_up(query_hit_t* heap, int i);
+static void heap_down(query_hit_t* heap, const int n, int i);
 
 
 /* ------------------------------------------------- Global Functions -------------------------------------------------------*/
-counters_t* process_query_array(char** words, int num_words, hashtable_t* index){    
+counters_t* process_query_array(char** words, int num_words, index_t* index){
+    return process_query_terms(words, num_words, &index, 1);
+}
+
+
+counters_t* process_query_terms(char** words, int num_words, index_t** shards, const int num_shards){
+    return process_query_weighted(words, num_words, shards, num_shards, NULL);
+}
+
+
+counters_t* process_query_weighted(char** words, int num_words, index_t** shards, const int num_shards,
+                                   const int* weights){
     // Create counters instance to hold the overall result (union of andsequences) and store pointer
     counters_t* result = counters_new();
     if (result == NULL) {
@@ -35,51 +86,15 @@ counters_t* process_query_array(char** words, int num_words, hashtable_t* index)
         return NULL;
     }
     
-    // Loop through the words array
+    // Loop through the words array, an andsequence (up to the next 'or' or the end) at a time
     int i = 0;
     while (i < num_words) {
-        // Process an andsequence (from current position until 'or' or end)
-        counters_t* and_result = counters_new(); // Create counters instance for each andsequence and store pointer
-        if (and_result == NULL) {
-            fprintf(stderr, "Error: failed to create and_result counters\n");
-            counters_delete(result);
-            return NULL;
-        }
-        
-        // First word in andsequence
-        counters_t* word_counters = hashtable_find(index, words[i]); // Get pointer to counters for this word
-        if (word_counters != NULL) {
-            copy_counters(word_counters, and_result); // Copy scores from this word to and_result
-        }
-        i++; // Move to next word
-        
-        // Process remaining words in andsequence
-        while (i < num_words && strcmp(words[i], "or") != 0) {
-            if (strcmp(words[i], "and") == 0) { // Skip word 'and'
-                i++;
-            }
-            word_counters = hashtable_find(index, words[i]); // Get pointer to counters for this word
-            
-            // Intersect with running result
-            if (word_counters != NULL) {
-                intersect_counters(and_result, word_counters); // Take minimum of scores (characteristic of AND operation)
-            } else { // No documents have this word
-                counters_delete(and_result);
-                and_result = counters_new();
-                break; // No need to continue this andsequence
-            }
-            
-            i++; // Move to next word
-        }
-        
-        // Union the and_result with the overall result
-        union_counters(result, and_result);
-        counters_delete(and_result);
-        
-        // Skip the 'or' to start the next andsequence
-        if (i < num_words && strcmp(words[i], "or") == 0) {
-            i++;
+        int end = i;
+        while (end < num_words && strcmp(words[end], "or") != 0) {
+            end++;
         }
+        score_andsequence(shards, num_shards, &words[i], end - i, weights, result); // Add its scores to the union
+        i = end + 1; // Skip the 'or'
     }
     return result;
 }
@@ -93,13 +108,31 @@ char** tokenize_query(char* query_str, int* word_count) {
         return NULL;
     }
     
-    // First pass: verify the query contains only letters and spaces
+    // First pass: verify the query contains only letters, spaces and paired quotes, '*' only to end a
+    // word outside quotes, and digits and '/' only in a near/k operator
+    bool quoted = false;
     for (int i = 0; query_str[i] != '\0'; i++) {
-        if (!isalpha(query_str[i]) && !isspace(query_str[i])) {
+        if (query_str[i] == '"') {
+            quoted = !quoted;
+            continue;
+        }
+        int near = (!quoted && (i == 0 || isspace(query_str[i - 1]) || query_str[i - 1] == '"'))
+            ? near_length(&query_str[i]) : 0;
+        if (near > 0) {
+            i += near - 1;
+            continue;
+        }
+        bool wildcard = (!quoted && query_str[i] == '*' && i > 0 && isalpha(query_str[i - 1])
+                         && (query_str[i + 1] == '\0' || isspace(query_str[i + 1])));
+        if (!isalpha(query_str[i]) && !isspace(query_str[i]) && !wildcard) {
             printf("Error: bad character '%c' in query.\n", query_str[i]);
             return NULL;
         }
     }
+    if (quoted) {
+        printf("Error: unpaired '\"' in query.\n");
+        return NULL;
+    }
     
     // Count the maximum possible number of words
     int max_possible_words = strlen(query_str) + 1; // Estimate the maximum number of words (conservatively)
@@ -112,9 +145,13 @@ char** tokenize_query(char* query_str, int* word_count) {
     }
 
     char* word;
-    while ((word = str_readWord(query_str, &position)) != NULL) {
-        // Store the word in the array
+    bool phrase;
+    while ((word = read_token(query_str, &position, &phrase)) != NULL) {
+        // Store the word (or phrase) in the array
         word_normalize(word);
+        if (phrase) {
+            prepare_phrase(word);
+        }
         words[*word_count] = word;
         (*word_count)++;
 
@@ -127,56 +164,73 @@ char** tokenize_query(char* query_str, int* word_count) {
     if (!is_query_valid(words, *word_count)){ // Error statements within the function
         return NULL;
     }
+    *word_count = remove_stopwords(words, *word_count); // The index has no stopwords to match
+    if (stemmer_enabled()) {
+        stem_words(words, *word_count); // Match the stems the indexer stored
+    }
     return words;
 }
 
+
+bool query_isPositional(char** words, int num_words){
+    for (int i = 0; i < num_words; i++) {
+        if (strchr(words[i], ' ') != NULL || is_near(words[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void print_ranked_results(counters_t* result_counters, char* pageDirectory){
-    
-    // Count how many documents have non-zero scores
+    query_hit_t* hits = NULL;
     int num_matches = 0;
-    counters_iterate(result_counters, &num_matches, count_non_zero);
-    
-    if (num_matches == 0) {
-        printf("No documents match.\n");
+    int num_hits = rank_results(result_counters, 0, &hits, &num_matches);
+    if (num_hits < 0) {
+        fprintf(stderr, "Error: failed to rank the results\n");
         return;
     }
-    
-    // Create a copy of the counters to work with
-    counters_t* copy = counters_new();
-    if (copy == NULL) {
-        fprintf(stderr, "Error: failed to create counters copy\n");
+    print_hits(hits, num_hits, num_matches, pageDirectory);
+    free(hits);
+}
+
+
+int rank_results(counters_t* result_counters, const int k, query_hit_t** hits, int* num_matches){
+    query_ranking_t ranking = {NULL, 0, 0, k, 0, true};
+    counters_iterate(result_counters, &ranking, rank_hit);
+    if (!ranking.ok) {
+        free(ranking.hits);
+        return -1;
+    }
+    if (ranking.num_hits > 1) {
+        qsort(ranking.hits, ranking.num_hits, sizeof(query_hit_t), compare_hits);
+    }
+    *hits = ranking.hits;
+    *num_matches = ranking.num_matches;
+    return ranking.num_hits;
+}
+
+
+int compare_hits(const void* a, const void* b){
+    const query_hit_t* hitA = a;
+    const query_hit_t* hitB = b;
+    if (hitA->score != hitB->score) {
+        return (hitA->score < hitB->score) - (hitA->score > hitB->score);
+    }
+    return (hitA->docID < hitB->docID) - (hitA->docID > hitB->docID);
+}
+
+
+void print_hits(const query_hit_t* hits, const int num_hits, const int num_matches, char* pageDirectory){
+    if (num_matches == 0) {
+        printf("No documents match.\n");
         return;
     }
-    
-    // Copy all scores to our working copy
-    counters_iterate(result_counters, copy, counter_copy_helper);
-    
-    // Print heading
     printf("Matches %d documents (ranked):\n", num_matches);
-    
-    // Repeatedly find the highest-scoring document and print it
-    for (int i = 0; i < num_matches; i++) {
-        // Define a temporary struct instance to store a docID and max rank
-        struct {
-            int max_docID;
-            int max_score;
-        } max = {0, 0}; // Create a new instance every iteration
-        
-        counters_iterate(copy, &max, find_max_docID); // Find max score in current state of counters
-        
-        if (max.max_score > 0) {
-            char* url = get_url(pageDirectory, max.max_docID); // Get the URL for this document
-            
-            // Print document information
-            printf("score %4d doc %4d: %s\n", max.max_score, max.max_docID, url);
-            
-            mem_free(url); // Free the URL
-            
-            // Set this doc's score to zero so it won't be found again
-            counters_set(copy, max.max_docID, 0);
-        }
-    }
-    counters_delete(copy); // Free memory
+    for (int i = 0; i < num_hits; i++) {
+        char* url = get_url(pageDirectory, hits[i].docID); // Get the URL for this document
+        printf("score %4d doc %4d: %s\n", hits[i].score, hits[i].docID, url != NULL ? url : "(missing)");
+        mem_free(url); // Free the URL
+    }
 }
 
 
@@ -241,83 +295,503 @@ static bool is_query_valid(char** words, int num_words) {
             return false;
         }
     }
+
+    // Rule 4: 'near/k' joins two words or phrases, so it cannot be first or last, or next to
+    // another operator or a prefix
+    for (int i = 0; i < num_words; i++) {
+        if (!is_near(words[i])) {
+            continue;
+        }
+        if (i == 0 || i == num_words - 1) {
+            fprintf(stderr, "Error: '%s' cannot be %s\n", words[i], (i == 0) ? "first" : "last");
+            return false;
+        }
+        if (is_operator(words[i + 1])) {
+            fprintf(stderr, "Error: '%s' and '%s' cannot be adjacent\n", words[i], words[i + 1]);
+            return false;
+        }
+        if (is_wildcard(words[i - 1]) || is_wildcard(words[i + 1])) {
+            fprintf(stderr, "Error: '%s' cannot be next to a prefix\n", words[i]);
+            return false;
+        }
+    }
+    for (int i = 0; i < num_words - 1; i++) {
+        if (is_near(words[i + 1]) && is_operator(words[i])) {
+            fprintf(stderr, "Error: '%s' and '%s' cannot be adjacent\n", words[i], words[i + 1]);
+            return false;
+        }
+    }
     return true; // If all checks passed, query is valid
 }
 
+/* Drop the stopwords of a valid query (and phrases of nothing but stopwords), along with every 'and'
+ * (andsequences are implicit), any 'or' left with no words on one side and any 'near/k' that lost a
+ * word; return the new number of words. An andsequence made only of stopwords disappears, so
+ * "cat or the" is searched as "cat", and "cat near/2 the" as "cat". */
+static int remove_stopwords(char** words, int num_words){
+    int kept = 0;
+    bool dropped = false; // the word before was dropped
+    for (int i = 0; i < num_words; i++) {
+        char* word = words[i];
+        bool drop;
+        if (strcmp(word, "or") == 0) {
+            drop = (kept == 0 || strcmp(words[kept - 1], "or") == 0);
+        } else if (is_near(word)) { // Never last, in a valid query
+            drop = dropped || strcmp(words[i + 1], PLACEHOLDER) == 0 || stopword_is(words[i + 1], strlen(words[i + 1]));
+        } else {
+            drop = (strcmp(word, "and") == 0 || strcmp(word, PLACEHOLDER) == 0 || stopword_is(word, strlen(word)));
+        }
+        dropped = drop;
+        if (drop) {
+            free(word);
+        } else {
+            words[kept++] = word;
+        }
+    }
+    if (kept > 0 && strcmp(words[kept - 1], "or") == 0) {
+        free(words[--kept]);
+    }
+    return kept;
+}
+
 
-/* Copy all entries from src counters to new counters */
-static void copy_counters(counters_t* src, counters_t* new){
-    counters_iterate(src, new, counter_copy_helper); // Iterate over source counters and copy to destination
+/* Replace each word of a query (but not an operator or a prefix), and each word of a phrase, with
+ * its stem, in place */
+static void stem_words(char** words, int num_words){
+    for (int i = 0; i < num_words; i++) {
+        if (strchr(words[i], ' ') != NULL) {
+            stem_phrase(words[i]);
+        } else if (!is_operator(words[i]) && !is_wildcard(words[i])) {
+            words[i][stemmer_word(words[i], strlen(words[i]))] = '\0';
+        }
+    }
 }
 
 
-/* Union two counters objects, summing the counts for each docID */
-static void union_counters(counters_t* result, counters_t* counters2){
-    // Iterate over counters2 and update result
-    counters_iterate(counters2, result, union_helper);
+/* Add the score of each document matching an andsequence (the minimum count of its words there) to
+ * result. The words' postings are walked together, rarest word first: each candidate docID is sought
+ * in the other words' postings, which skip ahead by block and gallop, so a common word costs about
+ * as much as the rare word's postings rather than its own. A phrase or near/k counts in a document
+ * that has all its words as the number of times they are placed as asked (score_chains). */
+static void score_andsequence(index_t** shards, const int num_shards, char** words, int num_words, const int* weights,
+                              counters_t* result){
+    int num_terms = 0; // The words, each word of a phrase on its own
+    for (int i = 0; i < num_words; i++) {
+        for (const char* c = words[i]; *c != '\0'; c++) {
+            num_terms += (*c == ' ');
+        }
+        num_terms += !is_operator(words[i]);
+    }
+    index_cursor_t** cursors = malloc(num_terms * sizeof(index_cursor_t*));
+    query_term_t* terms = calloc(num_terms, sizeof(query_term_t));
+    if (cursors == NULL || terms == NULL) {
+        fprintf(stderr, "Error: failed to allocate andsequence cursors\n");
+        free(cursors);
+        free(terms);
+        return;
+    }
+    int num_cursors = open_terms(shards, num_shards, words, num_words, weights, terms);
+    bool missing = (num_cursors < 0); // No documents have some word, so none match
+    bool positional = false;
+    for (int i = 0; i < num_cursors; i++) {
+        cursors[i] = terms[i].cursor;
+        positional |= (terms[i].chain >= 0);
+    }
+
+    if (num_cursors > 0 && !missing) {
+        qsort(cursors, num_cursors, sizeof(index_cursor_t*), compare_cursors);
+        int docID = index_cursor_docID(cursors[0]);
+        while (docID > 0) {
+            // Seek docID in the other words; one that has to pass it gives the next candidate
+            int score = index_cursor_count(cursors[0]);
+            int k = 1;
+            for ( ; k < num_cursors; k++) {
+                if (!index_cursor_seek(cursors[k], docID)) {
+                    docID = 0; // A word has no more documents
+                    break;
+                }
+                if (index_cursor_docID(cursors[k]) > docID) {
+                    break;
+                }
+                int count = index_cursor_count(cursors[k]);
+                score = (count < score) ? count : score;
+            }
+            if (docID == 0) {
+                break;
+            }
+            if (k == num_cursors) { // In every word: add the score, then go on to the rarest word's next
+                score = positional ? score_chains(terms, num_cursors) : score;
+                if (score > 0) {
+                    counters_set(result, docID, counters_get(result, docID) + score);
+                }
+                docID = index_cursor_next(cursors[0]) ? index_cursor_docID(cursors[0]) : 0;
+            } else {
+                docID = index_cursor_seek(cursors[0], index_cursor_docID(cursors[k]))
+                    ? index_cursor_docID(cursors[0]) : 0;
+            }
+        }
+    }
+    for (int i = 0; i < num_terms; i++) {
+        index_cursor_delete(terms[i].cursor);
+        free(terms[i].positions);
+    }
+    free(terms);
+    free(cursors);
 }
 
 
-/* Intersect two counters objects, keeping the minimum count for each docID */
-static void intersect_counters(counters_t* result, counters_t* counters2){
-    // Create an array of counters pointers
-    counters_t* counters_array[2];
-    counters_array[0] = result;
-    counters_array[1] = counters2;
-    
-    // Iterate over all items in result and update them
-    counters_iterate(result, counters_array, intersection_helper);
+/* Open a cursor for each word of an andsequence, and each word of its phrases, in order, and note
+ * the phrase or near/k chain each is in (-1 for a word on its own) and how its positions must follow
+ * the word before's. Only words on their own are weighted by field, as chains need positions. Return
+ * the number of terms; -1 if some word is in no document (terms opened so far are still in terms, for
+ * the caller to delete). */
+static int open_terms(index_t** shards, const int num_shards, char** words, int num_words, const int* weights,
+                      query_term_t* terms){
+    int num_terms = 0;
+    int chain = -1;
+    int near = 0;  // k of the near/k before this word or phrase; 0 if none
+    int span = 0;  // positions the word or phrase before covers, less one
+    for (int i = 0; i < num_words; i++) {
+        if (is_near(words[i])) {
+            near = atoi(words[i] + strlen("near/"));
+            continue;
+        }
+        if (is_operator(words[i])) {
+            continue;
+        }
+        // A phrase's words are copied and split, since shards may search the same words at once
+        char* phrase = malloc(strlen(words[i]) + 1);
+        if (phrase == NULL) {
+            return -1;
+        }
+        strcpy(phrase, words[i]);
+        int extent = 0;
+        for (char* c = phrase; *c != '\0'; c++) {
+            extent += (*c == ' ');
+        }
+        if (near == 0 && (extent > 0 || (i + 1 < num_words && is_near(words[i + 1])))) {
+            chain++; // A phrase, or a word before a near/k: it starts a chain
+        }
+        bool chained = (extent > 0 || near > 0 || (i + 1 < num_words && is_near(words[i + 1])));
+        int offset = 0;   // the word's position in the phrase
+        int before = -1;  // the position in the phrase of the word before that isn't a placeholder
+        for (char* part = phrase, * next; part != NULL; part = next, offset++) {
+            next = strchr(part, ' ');
+            if (next != NULL) {
+                *next++ = '\0';
+            }
+            if (strcmp(part, PLACEHOLDER) == 0) {
+                continue;
+            }
+            query_term_t* term = &terms[num_terms];
+            term->cursor = open_cursor(shards, num_shards, part, chained ? NULL : weights);
+            if (term->cursor == NULL) {
+                free(phrase);
+                return -1;
+            }
+            num_terms++;
+            term->chain = chained ? chain : -1;
+            term->lo[1] = 1;
+            term->hi[1] = 0; // Empty, unless near/k allows either order
+            if (before >= 0) { // Within the phrase: exactly so many positions on
+                term->lo[0] = term->hi[0] = offset - before;
+            } else if (near > 0) { // Starts within near of the last word before, on either side
+                term->lo[0] = 1;
+                term->hi[0] = near;
+                term->lo[1] = -((long) near + span + extent);
+                term->hi[1] = -(1 + (long) span + extent);
+            }
+            before = offset;
+        }
+        free(phrase);
+        near = 0;
+        span = extent;
+    }
+    return num_terms;
 }
 
 
-/* Helper function for copying counter entries */
-static void counter_copy_helper(void* arg, const int key, const int count){
-    counters_t* new = arg;
-    counters_set(new, key, count);
+/* Score the current document (which every term's cursor is on): the least count of the words on
+ * their own, and of the number of times each chain is placed as asked; 0 if a chain never is */
+static int score_chains(query_term_t* terms, const int num_terms){
+    int score = -1;
+    for (int first = 0; first < num_terms && score != 0; ) {
+        int last = first;
+        int count;
+        if (terms[first].chain < 0) {
+            count = index_cursor_count(terms[first].cursor);
+        } else {
+            while (last + 1 < num_terms && terms[last + 1].chain == terms[first].chain) {
+                last++;
+            }
+            count = count_chain(terms, first, last);
+        }
+        score = (score < 0 || count < score) ? count : score;
+        first = last + 1;
+    }
+    return (score < 0) ? 0 : score;
 }
 
 
-/* Helper function for union operation */
-static void union_helper(void* arg, const int key, const int count){
-    counters_t* result = arg;
-    int curr_count = counters_get(result, key); // Get current count in result
-    counters_set(result, key, curr_count + count); // Add this count to current value
+/* Count the placings of a chain's words in the current document: keep the first word's positions,
+ * then each next word's that are at an allowed offset from a kept position of the word before. Both
+ * lists are increasing, so each step is one merge-like pass. Return the number kept of the last word. */
+static int count_chain(query_term_t* terms, const int first, const int last){
+    int kept = 0;
+    for (int t = first; t <= last; t++) {
+        query_term_t* term = &terms[t];
+        int count = index_cursor_count(term->cursor);
+        if (count > term->capacity) {
+            int* positions = realloc(term->positions, count * sizeof(int));
+            if (positions == NULL) {
+                return 0;
+            }
+            term->positions = positions;
+            term->capacity = count;
+        }
+        int n = index_cursor_positions(term->cursor, term->positions);
+        if (t == first) {
+            kept = n;
+            continue;
+        }
+        // Keep position p if a kept position of the word before is in [p - hi, p - lo], for either range
+        const int* before = terms[t - 1].positions;
+        int num_before = kept;
+        int a = 0;
+        int b = 0;
+        kept = 0;
+        for (int i = 0; i < n; i++) {
+            long p = term->positions[i];
+            while (a < num_before && before[a] < p - term->hi[0]) {
+                a++;
+            }
+            while (b < num_before && before[b] < p - term->hi[1]) {
+                b++;
+            }
+            if ((a < num_before && before[a] <= p - term->lo[0])
+                || (b < num_before && before[b] <= p - term->lo[1])) {
+                term->positions[kept++] = (int) p;
+            }
+        }
+        if (kept == 0) {
+            break;
+        }
+    }
+    return kept;
 }
 
 
-/* Helper function for intersection operation */
-static void intersection_helper(void* arg, const int key, const int count) {
-    counters_t** counters_array = (counters_t**)arg; // arg is a pointer to an array of two counters pointers
-    counters_t* result = counters_array[0];
-    counters_t* counters2 = counters_array[1];
-    
-    int count2 = counters_get(counters2, key); // Get count from second counters
-    
-    if (count2 == 0) { // If DocID is not in counters2, remove from result
-        counters_set(result, key, 0);
-    } else { // Update to minimum of the two counts
-        counters_set(result, key, (count < count2) ? count : count2); // If count < count2 use count, otherwise count2
+/* Return true if word is a prefix search, like "play*" */
+static bool is_wildcard(const char* word){
+    size_t len = strlen(word);
+    return len > 1 && word[len - 1] == '*' && strchr(word, ' ') == NULL;
+}
+
+
+/* Return true if word is a near/k operator (tokenize_query let only those have a '/') */
+static bool is_near(const char* word){
+    return strchr(word, '/') != NULL;
+}
+
+
+/* Return true if word is 'and', 'or' or a near/k */
+static bool is_operator(const char* word){
+    return strcmp(word, "and") == 0 || strcmp(word, "or") == 0 || is_near(word);
+}
+
+
+/* Return the length of the near/k operator (any case) str starts with, if it is one and ends there;
+ * else 0 */
+static int near_length(const char* str){
+    const char* near = "near/";
+    int len = 0;
+    while (near[len] != '\0' && tolower(str[len]) == near[len]) {
+        len++;
+    }
+    if (len < 5) {
+        return 0;
+    }
+    while (isdigit(str[len]) && len - 5 < NEAR_MAX_DIGITS) {
+        len++;
     }
+    bool ended = (str[len] == '\0' || isspace(str[len]) || str[len] == '"');
+    return (len > 5 && ended && atoi(str + 5) > 0) ? len : 0;
 }
 
-/* Helper function to count non-zero items in counters */
-static void count_non_zero(void* arg, const int key, const int count){
-    int* n = arg;
-    
-    if (count > 0) {
-        (*n)++;
+
+/* Read the next word, or phrase in double quotes, of a query from query_str[*position] on, and move
+ * *position past it. A word ends at a space or quote. Return a new string, with room for one more
+ * character than it holds (prepare_phrase may use it), and set *quoted; NULL at the end. */
+static char* read_token(const char* query_str, int* position, bool* quoted){
+    while (isspace(query_str[*position])) {
+        (*position)++;
     }
+    if (query_str[*position] == '\0') {
+        return NULL;
+    }
+    *quoted = (query_str[*position] == '"');
+    int start = *position + *quoted;
+    int end = start;
+    while (query_str[end] != '\0' && query_str[end] != '"' && (*quoted || !isspace(query_str[end]))) {
+        end++;
+    }
+    *position = end + (*quoted && query_str[end] == '"'); // Past a closing quote
+    char* token = malloc(end - start + 2);
+    if (token != NULL) {
+        memcpy(token, &query_str[start], end - start);
+        token[end - start] = '\0';
+    }
+    return token;
 }
 
-/* Helper function to find the maximum score and its document ID */
-static void find_max_docID(void* arg, const int key, const int count){
-    struct {
-        int max_docID;
-        int max_score;
-    }* max = arg;
-    
-    if (count > max->max_score) {
-        max->max_docID = key;
-        max->max_score = count;
+
+/* Rewrite a (lowercase) phrase in place as its words separated by single spaces, each word the
+ * index doesn't hold (a stopword, or too short) replaced by a placeholder that only keeps its
+ * position, and none at either end. A phrase of one word becomes that word, and one of no words
+ * the index holds a lone placeholder, which remove_stopwords drops. */
+static void prepare_phrase(char* phrase){
+    int length = 0;  // of the rewritten phrase so far
+    int end = 0;     // of its last word that isn't a placeholder
+    int i = 0;
+    while (phrase[i] != '\0') {
+        while (isspace(phrase[i])) {
+            i++;
+        }
+        int start = i;
+        while (phrase[i] != '\0' && !isspace(phrase[i])) {
+            i++;
+        }
+        int len = i - start;
+        if (len == 0) {
+            break;
+        }
+        bool indexed = (len >= QUERY_MIN_LENGTH && !stopword_is(&phrase[start], len));
+        if (!indexed && end == 0) {
+            continue; // No placeholder before the first word
+        }
+        if (length > 0) {
+            phrase[length++] = ' ';
+        }
+        if (indexed) {
+            memmove(&phrase[length], &phrase[start], len);
+            length += len;
+            end = length;
+        } else {
+            phrase[length++] = *PLACEHOLDER;
+        }
+    }
+    if (end == 0) {
+        strcpy(phrase, PLACEHOLDER);
+    } else {
+        phrase[end] = '\0';
+    }
+}
+
+
+/* Stem each word of a phrase (but not placeholders), in place */
+static void stem_phrase(char* phrase){
+    int length = 0;
+    for (int i = 0; phrase[i] != '\0'; ) {
+        int len = strcspn(&phrase[i], " ");
+        memmove(&phrase[length], &phrase[i], len);
+        bool placeholder = (len == 1 && phrase[length] == *PLACEHOLDER);
+        length += placeholder ? len : stemmer_word(&phrase[length], len);
+        i += len;
+        if (phrase[i] == ' ') {
+            phrase[length++] = ' ';
+            i++;
+        }
+    }
+    phrase[length] = '\0';
+}
+
+
+/* Open a cursor over a word's postings, in the term shard that holds the word; a prefix search's
+ * walks every word with the prefix in every shard, its counts summed per document. With weights, its
+ * field postings are added in if the shard has them. NULL if no document has the word (or any word
+ * with the prefix). */
+static index_cursor_t* open_cursor(index_t** shards, const int num_shards, const char* word, const int* weights){
+    if (!is_wildcard(word)) {
+        index_t** shard = &shards[index_termShard(word, num_shards)];
+        return (weights != NULL && index_hasFields(*shard)) ? index_cursor_newWeighted(shard, 1, word, false, weights)
+                                                             : index_cursor_new(*shard, word);
     }
-}
\ No newline at end of file
+    // The prefix, without its '*', copied: shards may search the same words at once
+    size_t len = strlen(word) - 1;
+    char* prefix = malloc(len + 1);
+    if (prefix == NULL) {
+        return NULL;
+    }
+    memcpy(prefix, word, len);
+    prefix[len] = '\0';
+    index_cursor_t* cursor = index_cursor_newWeighted(shards, num_shards, prefix, true, weights);
+    free(prefix);
+    return cursor;
+}
+
+
+/* qsort comparator for cursors, fewest postings first */
+static int compare_cursors(const void* a, const void* b){
+    int sizeA = index_cursor_size(*(index_cursor_t* const*) a);
+    int sizeB = index_cursor_size(*(index_cursor_t* const*) b);
+    return (sizeA > sizeB) - (sizeA < sizeB);
+}
+
+
+/* counters_iterate helper for rank_results: keep a document if it is among the k best so far */
+static void rank_hit(void* arg, const int key, const int count){
+    query_ranking_t* ranking = arg;
+    if (count <= 0 || !ranking->ok) {
+        return;
+    }
+    ranking->num_matches++;
+    query_hit_t hit = {key, count};
+    if (ranking->k > 0 && ranking->num_hits == ranking->k) {
+        if (compare_hits(&hit, &ranking->hits[0]) < 0) { // Beats the worst kept document, which it replaces
+            ranking->hits[0] = hit;
+            heap_down(ranking->hits, ranking->num_hits, 0);
+        }
+        return;
+    }
+    if (ranking->num_hits == ranking->capacity) {
+        int capacity = (ranking->k > 0) ? ranking->k : (ranking->capacity == 0) ? 64 : ranking->capacity * 2;
+        query_hit_t* hits = realloc(ranking->hits, capacity * sizeof(query_hit_t));
+        if (hits == NULL) {
+            ranking->ok = false;
+            return;
+        }
+        ranking->hits = hits;
+        ranking->capacity = capacity;
+    }
+    ranking->hits[ranking->num_hits++] = hit;
+    if (ranking->k > 0) {
+        heap_up(ranking->hits, ranking->num_hits - 1);
+    }
+}
+
+/* Move heap[i] up until its parent ranks after it */
+static void heap_up(query_hit_t* heap, int i){
+    while (i > 0 && compare_hits(&heap[i], &heap[(i - 1) / 2]) > 0) {
+        query_hit_t swap = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = swap;
+        i = (i - 1) / 2;
+    }
+}
+
+/* Move heap[i] down until it ranks after both its children */
+static void heap_down(query_hit_t* heap, const int n, int i){
+    while (2 * i + 1 < n) {
+        int child = 2 * i + 1;
+        if (child + 1 < n && compare_hits(&heap[child + 1], &heap[child]) > 0) {
+            child++; // The child that ranks last
+        }
+        if (compare_hits(&heap[child], &heap[i]) <= 0) {
+            break;
+        }
+        query_hit_t swap = heap[i];
+        heap[i] = heap[child];
+        heap[child] = swap;
+        i = child;
+    }
+}
@@ -9,15 +9,26 @@ Description: header file for CS50 query module
 #define __QUERY_H
 
 #include "counters.h"
-#include "hashtable.h"
+#include "index.h"
+
+/**************** global constants ****************/
+/* Default weights of process_query_weighted, by field: INDEX_TITLE, INDEX_HEADING, INDEX_ANCHOR */
+#define QUERY_FIELD_WEIGHTS {3, 2, 2}
+
+/**************** global types ****************/
+typedef struct query_hit {
+    int docID;
+    int score;
+} query_hit_t;  // one ranked document of a query's results
 
 /**************** process_query_array ****************/
 /* 
  * Process a tokenized query according to the BNF grammar and return matching documents.
  * 
- * The query grammar has two non-terminals:
+ * The query grammar has three non-terminals:
  *   query       ::= <andsequence> [or <andsequence>]...
- *   andsequence ::= <word> [ [and] <word>]...
+ *   andsequence ::= <unit> [ [and] <unit>]...
+ *   unit        ::= <word> | "<phrase>" [near/k <word> | near/k "<phrase>"]...
  *
  * Caller provides:
  *   words - array of tokenized query words (must not be NULL)
@@ -27,12 +38,57 @@ Description: header file for CS50 query module
  * Returns:
  *   A counters object with document IDs and their scores, or NULL on error
  *   For AND sequences, scores are the minimum count across all words
+ *   A word ending in '*' (like "play*") matches every word with that prefix, and
+ *   counts in a document as the sum of their counts there
  *   For OR operations, scores are the sum of the AND sequence scores
+ *   A phrase counts in a document as the number of times its words are there
+ *   one after another (with any stopword between them in the query taking a
+ *   position); u near/k v as the number of times the start of one is within k
+ *   positions after the end of the other, in either order. Both need an index
+ *   with positions (index_hasPositions); on one without, they match nothing.
  *
  * Caller is responsible for:
  *   Later freeing the returned counters with counters_delete()
  */
-counters_t* process_query_array(char** words, int num_words, hashtable_t* index);
+counters_t* process_query_array(char** words, int num_words, index_t* index);
+
+/**************** process_query_terms ****************/
+/*
+ * Process a tokenized query, like process_query_array, on an index split by term (see shard.h).
+ *
+ * Caller provides:
+ *   words, num_words - as for process_query_array
+ *   shards, num_shards - the term shards, in order; shard index_termShard(w, num_shards) holds word w
+ *
+ * Returns:
+ *   the counters process_query_array returns for the unsplit index, or NULL on error
+ *
+ * Notes:
+ *   Each word is looked up only in the shard holding it, so a two-word query
+ *   touches at most two shards; a prefix ("play*") is looked up in all of them.
+ *   process_query_array(words, num_words, index) is process_query_terms(words, num_words, &index, 1).
+ */
+counters_t* process_query_terms(char** words, int num_words, index_t** shards, const int num_shards);
+
+/**************** process_query_weighted ****************/
+/*
+ * Process a tokenized query, like process_query_terms, ranking with fields (see index.h).
+ *
+ * Caller provides:
+ *   words, num_words, shards, num_shards - as for process_query_terms
+ *   weights - INDEX_FIELDS weights (as QUERY_FIELD_WEIGHTS), or NULL
+ *
+ * Returns:
+ *   the counters process_query_terms returns, except that a word (or prefix) on its own counts in a
+ *   document as its count there plus each field's weight times its count in that field
+ *   (index_cursor_newWeighted); so a document named by links to it matches their words
+ *
+ * Notes:
+ *   Words of a phrase or near/k are matched by position, so count as before.
+ *   On an index without fields, or with NULL weights, this is process_query_terms.
+ */
+counters_t* process_query_weighted(char** words, int num_words, index_t** shards, const int num_shards,
+                                   const int* weights);
 
 /**************** tokenize_query ****************/
 /* 
@@ -47,8 +103,19 @@ counters_t* process_query_array(char** words, int num_words, hashtable_t* index)
  *   The array is terminated by a NULL pointer
  *
  * We validate:
- *   The query contains only letters and spaces
- *   The query follows syntax rules (operators cannot be first/last, operators cannot be adjacent)
+ *   The query contains only letters, spaces and paired double quotes, except that a word
+ *   outside quotes may end in one '*', and an operator near/k (any case; k from 1 to 999999)
+ *   The query follows syntax rules (operators cannot be first/last, operators cannot be adjacent,
+ *   near/k cannot be next to a prefix)
+ *
+ * We do:
+ *   Return a quoted phrase as one string, its words separated by single spaces; words the
+ *   indexer does not index become "*" placeholders, which only keep their position, and a
+ *   phrase of one indexed word is that word
+ *   Drop stopwords (which the indexer never indexes) once the query is validated,
+ *   with the 'and's and any 'or' or near/k they leave without words on one side
+ *   Stem the remaining words (each word of a phrase) but not prefixes, if this build stems
+ *   words (as the indexer does)
  *
  * Notes:
  *   Prints appropriate error messages for invalid queries
@@ -57,6 +124,11 @@ counters_t* process_query_array(char** words, int num_words, hashtable_t* index)
 char** tokenize_query(char* query_str, int* word_count);
 
 
+/**************** query_isPositional ****************/
+/* Return true if a tokenized query has a phrase or near/k, so needs an index with positions. */
+bool query_isPositional(char** words, int num_words);
+
+
 /**************** print_ranked_results ****************/
 /* 
  * Print the documents that match a query, in decreasing order by score.
@@ -66,23 +138,57 @@ char** tokenize_query(char* query_str, int* word_count);
  *   pageDirectory - path to the directory containing the crawled pages (must not be NULL)
  *
  * We do:
- *   Count the number of documents with non-zero scores
- *   If no matches, print a message and return
- *   Otherwise, create a copy of the counters to work with
- *   Print the total number of matching documents
- *   Repeatedly find the highest-scoring document and print its score, ID, and URL
- *   Clean up memory when done
+ *   Rank every document with a non-zero score (rank_results), then print them (print_hits)
+ */
+void print_ranked_results(counters_t* result_counters, char* pageDirectory);
+
+/**************** rank_results ****************/
+/*
+ * Find the k best documents of a query's results, best first.
+ *
+ * Caller provides:
+ *   result_counters - a counters data structure mapping docIDs to scores (must not be NULL)
+ *   k - how many documents to keep; k < 1 keeps every match
+ *   hits - where to store a new array of the kept documents
+ *   num_matches - where to store the number of documents with non-zero scores
+ *
+ * Returns:
+ *   The number of documents in *hits (at most k); -1 if out of memory
+ *
+ * We do:
+ *   Keep the best k seen so far in a heap whose root is the worst of them, so
+ *   each document costs at most log k, then sort the k (compare_hits)
+ *
+ * Caller is responsible for:
+ *   Later calling free(*hits)
+ */
+int rank_results(counters_t* result_counters, const int k, query_hit_t** hits, int* num_matches);
+
+/**************** compare_hits ****************/
+/*
+ * qsort comparator for query_hit_t: higher score first, and of equal scores the larger docID first,
+ * so the ranking doesn't depend on the order documents were found in.
+ */
+int compare_hits(const void* a, const void* b);
+
+/**************** print_hits ****************/
+/*
+ * Print ranked documents.
+ *
+ * Caller provides:
+ *   hits, num_hits - ranked documents, best first (as from rank_results)
+ *   num_matches - how many documents matched in all (may be more than num_hits)
+ *   pageDirectory - path to the directory containing the crawled pages (must not be NULL)
  *
  * We print:
  *   "No documents match." if no documents match
  *   Otherwise, "Matches N documents (ranked):" followed by
- *   One line per document with format "score SSSS doc DDDD: URL"
+ *   One line per hit with format "score SSSS doc DDDD: URL"
  *
  * Notes:
- *   Uses helper functions to find max scores and copy counters
  *   URLs are retrieved from the page directory and freed after printing
  */
-void print_ranked_results(counters_t* result_counters, char* pageDirectory);
+void print_hits(const query_hit_t* hits, const int num_hits, const int num_matches, char* pageDirectory);
 
 /**************** free_words ****************/
 /* 
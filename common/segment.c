@@ -0,0 +1,787 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: segment.c
+Description: (CS-50) Module for incremental index updates: delta segments, tombstones and compaction.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "segment.h"
+#include "index.h"
+#include "indexfile.h"
+#include "merge.h"
+#include "manifest.h"
+#include "pagedir.h"
+#include "webpage.h"
+#include "file.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const int SEGMENT_MAX_DELTAS = 16;   // compact once an update leaves this many deltas
+static const int SEGMENT_MERGE_FACTOR = 4;  // deltas of one tier merged at a time; base to deltas size ratio
+static const long SEGMENT_TIER_BYTES = 64 * 1024; // deltas up to this size are in the lowest tier
+static const int DELTA_WORDS = 700;         // expected words in a delta being built
+
+/**************** local types ****************/
+/* The contents of indexFilename.segments */
+typedef struct segment_state {
+    int generation;       // number of the newest delta ever written
+    int* deltas;          // generations of the live deltas, oldest first
+    int numDeltas;
+    int* docIDs;          // indexed documents, in increasing docID order
+    uint64_t* hashes;     // content hash of each indexed document
+    int numDocs;
+} segment_state_t;
+
+/* A set of docIDs, one bit each */
+typedef struct segment_bitmap {
+    uint8_t* bits;
+    int numBytes;
+} segment_bitmap_t;
+
+/* Context for filter_word and merge_word: the index to change, the word being visited, and the
+ * dead documents (filter) or the delta being merged (merge) */
+typedef struct segment_visit {
+    index_t* index;
+    const char* word;
+    const segment_bitmap_t* dead;
+    index_t* delta;
+} segment_visit_t;
+
+/**************** local functions ****************/
+static char* segment_path(const char* indexFilename, const char* suffix, const int generation);
+static bool state_read(const char* indexFilename, segment_state_t* state, bool* exists, const bool withDocs);
+static bool state_write(const char* indexFilename, const segment_state_t* state);
+static bool state_fromManifest(segment_state_t* state, const manifest_t* manifest);
+static void state_free(segment_state_t* state);
+static bool bitmap_grow(segment_bitmap_t* bitmap, const int numBytes);
+static bool bitmap_set(segment_bitmap_t* bitmap, const int docID);
+static bool bitmap_test(const segment_bitmap_t* bitmap, const int docID);
+static bool bitmap_read(const char* path, segment_bitmap_t* bitmap);
+static bool bitmap_write(const char* path, const segment_bitmap_t* bitmap);
+static index_t* load_file(const char* path);
+static long file_size(const char* path);
+static int delta_tier(const long size);
+static bool merge_segments(const char* indexFilename, const segment_state_t* state, const bool withBase,
+                           const int first, const int count, const char* path, const bool binary,
+                           segment_bitmap_t* dead);
+static bool merge_deltas(const char* indexFilename, segment_state_t* state, const int first, const int count);
+static void remove_deltas(const char* indexFilename, const int* deltas, const int numDeltas);
+static void filter_word(void* arg, const char* word);
+static void filter_posting(void* arg, const int docID, const int count);
+static void merge_word(void* arg, const char* word);
+static void merge_posting(void* arg, const int docID, const int count);
+
+
+/**************** global functions ****************/
+bool segment_reset(const char* pageDirectory, const char* indexFilename){
+    if (pageDirectory == NULL || indexFilename == NULL) {
+        return false;
+    }
+    segment_state_t old;
+    bool exists = false;
+    if (!state_read(indexFilename, &old, &exists, true)) {
+        exists = false; // Unreadable state: nothing we can clean up
+    }
+
+    bool ok = true;
+    manifest_t* manifest = manifest_load(pageDirectory);
+    if (manifest == NULL) {
+        // No content hashes to compare against later, so incremental updates are unavailable
+        char* path = segment_path(indexFilename, ".segments", 0);
+        if (path != NULL) {
+            remove(path);
+            mem_free(path);
+        }
+    } else {
+        segment_state_t state;
+        memset(&state, 0, sizeof(state));
+        state.generation = exists ? old.generation : 0; // Never reuse a delta name a reader may hold
+        ok = state_fromManifest(&state, manifest) && state_write(indexFilename, &state);
+        state_free(&state);
+        manifest_delete(manifest);
+        if (!ok) {
+            fprintf(stderr, "Error: cannot write %s.segments\n", indexFilename);
+        }
+    }
+
+    if (exists) {
+        if (ok) {
+            remove_deltas(indexFilename, old.deltas, old.numDeltas);
+        }
+        state_free(&old);
+    }
+    return ok;
+}
+
+int segment_update(const char* pageDirectory, const char* indexFilename){
+    if (pageDirectory == NULL || indexFilename == NULL) {
+        return -1;
+    }
+    segment_state_t state;
+    bool exists = false;
+    if (!state_read(indexFilename, &state, &exists, true)) {
+        fprintf(stderr, "Error: cannot read %s.segments\n", indexFilename);
+        return -1;
+    }
+    if (!exists) {
+        fprintf(stderr, "Error: %s has no incremental state; run a full build first\n", indexFilename);
+        return -1;
+    }
+    manifest_t* manifest = manifest_load(pageDirectory);
+    if (manifest == NULL) {
+        fprintf(stderr, "Error: incremental updates need %s/.manifest\n", pageDirectory);
+        state_free(&state);
+        return -1;
+    }
+
+    // Walk the manifest and the recorded documents (both in increasing docID order) side by side
+    segment_bitmap_t dead = {NULL, 0};
+    int* changed = malloc((manifest_count(manifest) + 1) * sizeof(int));
+    int numChanged = 0;
+    int numDeleted = 0;
+    bool ok = (changed != NULL);
+    int i = 0;
+    int j = 0;
+    while (ok && (i < manifest_count(manifest) || j < state.numDocs)) {
+        const manifest_entry_t* entry = manifest_get(manifest, i);
+        if (j == state.numDocs || (entry != NULL && entry->docID < state.docIDs[j])) {
+            changed[numChanged++] = entry->docID;           // New document
+            ok = bitmap_set(&dead, entry->docID);
+            i++;
+        } else if (entry == NULL || state.docIDs[j] < entry->docID) {
+            ok = bitmap_set(&dead, state.docIDs[j]);        // Deleted document
+            numDeleted++;
+            j++;
+        } else {
+            if (entry->hash != state.hashes[j]) {
+                changed[numChanged++] = entry->docID;       // Changed document
+                ok = bitmap_set(&dead, entry->docID);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    int result = -1;
+    if (!ok) {
+        fprintf(stderr, "Error: out of memory comparing %s with %s\n", pageDirectory, indexFilename);
+    } else if (numChanged + numDeleted == 0) {
+        result = 0; // Index is already up to date
+    } else {
+        // Index only the new and changed documents into the next delta
+        index_t* delta = index_new(DELTA_WORDS);
+        ok = (delta != NULL);
+        for (int k = 0; ok && k < numChanged; k++) {
+            webpage_t* page = pagedir_load(pageDirectory, changed[k]);
+            if (page == NULL) {
+                fprintf(stderr, "Error: cannot read document %s/%d\n", pageDirectory, changed[k]);
+                ok = false;
+            } else {
+                indexPage(page, changed[k], delta);
+                webpage_delete(page);
+            }
+        }
+
+        int generation = state.generation + 1;
+        char* deltaPath = segment_path(indexFilename, "", generation);
+        char* deadPath = segment_path(indexFilename, ".dead", generation);
+        int* deltas = realloc(state.deltas, (state.numDeltas + 1) * sizeof(int));
+        if (deltas != NULL) {
+            state.deltas = deltas;
+        }
+        ok = ok && deltaPath != NULL && deadPath != NULL && deltas != NULL
+            && saveIndex_toPage(delta, deltaPath) && bitmap_write(deadPath, &dead);
+
+        // Publishing the new segments file is the commit point of the update
+        if (ok) {
+            segment_state_t next = {generation, state.deltas, state.numDeltas + 1, NULL, NULL, 0};
+            next.deltas[state.numDeltas] = generation;
+            ok = state_fromManifest(&next, manifest) && state_write(indexFilename, &next);
+            free(next.docIDs);
+            free(next.hashes);
+            if (ok) {
+                state.numDeltas++;
+            }
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: cannot write delta segment %s\n", deltaPath != NULL ? deltaPath : indexFilename);
+            if (deltaPath != NULL) {
+                remove(deltaPath);
+            }
+            if (deadPath != NULL) {
+                remove(deadPath);
+            }
+        } else {
+            result = numChanged + numDeleted;
+        }
+        index_delete(delta);
+        mem_free(deltaPath);
+        mem_free(deadPath);
+
+        // The update is published; now merge deltas as the policy says, so loading stays quick
+        if (ok && !segment_maintain(indexFilename)) {
+            fprintf(stderr, "Warning: update succeeded but merging the segments of %s failed\n", indexFilename);
+        }
+    }
+
+    free(changed);
+    free(dead.bits);
+    manifest_delete(manifest);
+    state_free(&state);
+    return result;
+}
+
+bool segment_compact(const char* indexFilename){
+    if (indexFilename == NULL) {
+        return false;
+    }
+    segment_state_t state;
+    bool exists = false;
+    if (!state_read(indexFilename, &state, &exists, true)) {
+        fprintf(stderr, "Error: cannot read %s.segments\n", indexFilename);
+        return false;
+    }
+    if (!exists || state.numDeltas == 0) {
+        if (exists) {
+            state_free(&state);
+        }
+        return true; // Nothing to merge
+    }
+
+    // Stream the base and deltas into a new base, which keeps the format of the old one
+    bool binary = indexfile_is(indexFilename);
+    char* tmpPath = segment_path(indexFilename, ".tmp", 0);
+    bool ok = tmpPath != NULL
+        && merge_segments(indexFilename, &state, true, 0, state.numDeltas, tmpPath, binary, NULL)
+        && rename(tmpPath, indexFilename) == 0;
+
+    // The new base already holds every delta; a reader that still pairs it with the old
+    // deltas gets the same postings again, so the order of these steps is safe
+    if (ok) {
+        int numDeltas = state.numDeltas;
+        state.numDeltas = 0;
+        ok = state_write(indexFilename, &state);
+        if (ok) {
+            remove_deltas(indexFilename, state.deltas, numDeltas);
+        }
+    } else if (tmpPath != NULL) {
+        remove(tmpPath);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: cannot compact %s\n", indexFilename);
+    }
+    mem_free(tmpPath);
+    state_free(&state);
+    return ok;
+}
+
+bool segment_maintain(const char* indexFilename){
+    if (indexFilename == NULL) {
+        return false;
+    }
+    while (true) {
+        segment_state_t state;
+        bool exists = false;
+        if (!state_read(indexFilename, &state, &exists, true)) {
+            fprintf(stderr, "Error: cannot read %s.segments\n", indexFilename);
+            return false;
+        }
+        if (!exists || state.numDeltas == 0) {
+            if (exists) {
+                state_free(&state);
+            }
+            return true;
+        }
+
+        // Fold everything into the base once the deltas are many, or large next to the base
+        long* sizes = malloc(state.numDeltas * sizeof(long));
+        long deltaBytes = 0;
+        for (int k = 0; sizes != NULL && k < state.numDeltas; k++) {
+            char* deltaPath = segment_path(indexFilename, "", state.deltas[k]);
+            sizes[k] = (deltaPath != NULL) ? file_size(deltaPath) : 0;
+            deltaBytes += sizes[k];
+            mem_free(deltaPath);
+        }
+        if (sizes == NULL || state.numDeltas >= SEGMENT_MAX_DELTAS
+            || deltaBytes * SEGMENT_MERGE_FACTOR >= file_size(indexFilename)) {
+            free(sizes);
+            state_free(&state);
+            return segment_compact(indexFilename);
+        }
+
+        // Otherwise merge the lowest tier holding SEGMENT_MERGE_FACTOR or more deltas in a row
+        int first = -1;
+        int count = 0;
+        int tier = 0;
+        for (int k = 0; k < state.numDeltas; ) {
+            int end = k + 1;
+            while (end < state.numDeltas && delta_tier(sizes[end]) == delta_tier(sizes[k])) {
+                end++;
+            }
+            if (end - k >= SEGMENT_MERGE_FACTOR && (first < 0 || delta_tier(sizes[k]) < tier)) {
+                first = k;
+                count = end - k;
+                tier = delta_tier(sizes[k]);
+            }
+            k = end;
+        }
+        free(sizes);
+        bool ok = (first < 0) || merge_deltas(indexFilename, &state, first, count);
+        state_free(&state);
+        if (first < 0 || !ok) {
+            return ok;
+        }
+    }
+}
+
+index_t* segment_load(const char* indexFilename){
+    if (indexFilename == NULL) {
+        return NULL;
+    }
+    segment_state_t state;
+    bool exists = false;
+    if (!state_read(indexFilename, &state, &exists, false)) { // Readers need only the deltas
+        return NULL;
+    }
+    index_t* index = load_file(indexFilename);
+    if (!exists || index == NULL || state.numDeltas == 0) { // Nothing to fold in or hide
+        if (exists) {
+            state_free(&state);
+        }
+        return index;
+    }
+
+    // Load every delta with its tombstones
+    index_t** deltas = mem_calloc(state.numDeltas + 1, sizeof(index_t*));
+    segment_bitmap_t* tombs = mem_calloc(state.numDeltas + 1, sizeof(segment_bitmap_t));
+    bool ok = (deltas != NULL && tombs != NULL);
+    for (int k = 0; ok && k < state.numDeltas; k++) {
+        char* deltaPath = segment_path(indexFilename, "", state.deltas[k]);
+        char* deadPath = segment_path(indexFilename, ".dead", state.deltas[k]);
+        ok = deltaPath != NULL && deadPath != NULL
+            && (deltas[k] = load_file(deltaPath)) != NULL && bitmap_read(deadPath, &tombs[k]);
+        if (!ok) {
+            fprintf(stderr, "Error: cannot load delta segment %s\n", deltaPath != NULL ? deltaPath : indexFilename);
+        }
+        mem_free(deltaPath);
+        mem_free(deadPath);
+    }
+
+    if (ok && state.numDeltas > 0 && index_isMapped(index)) {
+        // A mapped base is read-only: copy it into memory to fold the deltas into it
+        index_t* copy = index_new(0);
+        if (copy != NULL) {
+            segment_visit_t visit = {copy, NULL, NULL, index};
+            index_iterate(index, &visit, merge_word);
+        }
+        index_delete(index);
+        index = copy;
+        ok = (index != NULL);
+    }
+
+    if (ok) {
+        // A delta's tombstones hide postings in every older segment: walk newest to oldest,
+        // hiding each segment's postings under the union of the tombstones of newer ones
+        segment_bitmap_t dead = {NULL, 0};
+        for (int k = state.numDeltas - 1; ok && k >= 0; k--) {
+            segment_visit_t visit = {deltas[k], NULL, &dead, NULL};
+            index_iterate(deltas[k], &visit, filter_word);
+            ok = bitmap_grow(&dead, tombs[k].numBytes);
+            for (int b = 0; ok && b < tombs[k].numBytes; b++) {
+                dead.bits[b] |= tombs[k].bits[b];
+            }
+        }
+        if (ok) {
+            segment_visit_t visit = {index, NULL, &dead, NULL};
+            index_iterate(index, &visit, filter_word);
+            // What is left of each segment is disjoint; fold the deltas into the base
+            for (int k = 0; k < state.numDeltas; k++) {
+                visit.delta = deltas[k];
+                index_iterate(deltas[k], &visit, merge_word);
+            }
+        }
+        free(dead.bits);
+    }
+
+    for (int k = 0; deltas != NULL && k < state.numDeltas; k++) {
+        index_delete(deltas[k]);
+        if (tombs != NULL) {
+            free(tombs[k].bits);
+        }
+    }
+    mem_free(deltas);
+    mem_free(tombs);
+    state_free(&state);
+    if (!ok) {
+        index_delete(index);
+        return NULL;
+    }
+    return index;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Build indexFilename + suffix, or indexFilename.deltaN + suffix when generation > 0; caller frees */
+static char* segment_path(const char* indexFilename, const char* suffix, const int generation){
+    size_t len = strlen(indexFilename) + strlen(suffix) + 32;
+    char* path = mem_malloc(len);
+    if (path != NULL) {
+        if (generation > 0) {
+            snprintf(path, len, "%s.delta%d%s", indexFilename, generation, suffix);
+        } else {
+            snprintf(path, len, "%s%s", indexFilename, suffix);
+        }
+    }
+    return path;
+}
+
+/* Read indexFilename.segments into state; *exists is false (and state empty) if there is none.
+ * Without withDocs, stop at the first document line: the generation and deltas come first, so
+ * loading an index reads a few lines however many documents it has.
+ * Returns false if the file exists but cannot be parsed. */
+static bool state_read(const char* indexFilename, segment_state_t* state, bool* exists, const bool withDocs){
+    memset(state, 0, sizeof(*state));
+    *exists = false;
+    char* path = segment_path(indexFilename, ".segments", 0);
+    if (path == NULL) {
+        return false;
+    }
+    FILE* fp = fopen(path, "r");
+    mem_free(path);
+    if (fp == NULL) {
+        return true;
+    }
+    *exists = true;
+
+    bool ok = true;
+    int deltaCapacity = 0;
+    int docCapacity = 0;
+    char* line;
+    while (ok && (line = file_readLine(fp)) != NULL) {
+        if (!withDocs && strncmp(line, "doc ", 4) == 0) {
+            mem_free(line);
+            break;
+        }
+        int number;
+        int docID;
+        uint64_t hash;
+        if (sscanf(line, "generation %d", &number) == 1) {
+            state->generation = number;
+        } else if (sscanf(line, "delta %d", &number) == 1) {
+            if (state->numDeltas == deltaCapacity) {
+                deltaCapacity = deltaCapacity == 0 ? 8 : deltaCapacity * 2;
+                int* deltas = realloc(state->deltas, deltaCapacity * sizeof(int));
+                ok = (deltas != NULL);
+                state->deltas = ok ? deltas : state->deltas;
+            }
+            if (ok) {
+                state->deltas[state->numDeltas++] = number;
+            }
+        } else if (sscanf(line, "doc %d %" SCNx64, &docID, &hash) == 2) {
+            if (state->numDocs == docCapacity) {
+                docCapacity = docCapacity == 0 ? 256 : docCapacity * 2;
+                int* docIDs = realloc(state->docIDs, docCapacity * sizeof(int));
+                state->docIDs = docIDs != NULL ? docIDs : state->docIDs;
+                uint64_t* hashes = realloc(state->hashes, docCapacity * sizeof(uint64_t));
+                state->hashes = hashes != NULL ? hashes : state->hashes;
+                ok = (docIDs != NULL && hashes != NULL);
+            }
+            if (ok) {
+                state->docIDs[state->numDocs] = docID;
+                state->hashes[state->numDocs++] = hash;
+            }
+        } else if (line[0] != '\0') {
+            ok = false; // Not a line we wrote
+        }
+        mem_free(line);
+    }
+    fclose(fp);
+    if (!ok) {
+        state_free(state);
+        *exists = false;
+    }
+    return ok;
+}
+
+/* Write state to indexFilename.segments through a temporary file and rename(2) */
+static bool state_write(const char* indexFilename, const segment_state_t* state){
+    char* path = segment_path(indexFilename, ".segments", 0);
+    char* tmpPath = segment_path(indexFilename, ".segments.tmp", 0);
+    bool ok = (path != NULL && tmpPath != NULL);
+    FILE* fp = ok ? fopen(tmpPath, "w") : NULL;
+    if (fp != NULL) {
+        fprintf(fp, "generation %d\n", state->generation);
+        for (int k = 0; k < state->numDeltas; k++) {
+            fprintf(fp, "delta %d\n", state->deltas[k]);
+        }
+        for (int i = 0; i < state->numDocs; i++) {
+            fprintf(fp, "doc %d %016" PRIx64 "\n", state->docIDs[i], state->hashes[i]);
+        }
+        ok = (fclose(fp) == 0) && rename(tmpPath, path) == 0;
+        if (!ok) {
+            remove(tmpPath);
+        }
+    } else {
+        ok = false;
+    }
+    mem_free(path);
+    mem_free(tmpPath);
+    return ok;
+}
+
+/* Replace state's documents with the manifest's */
+static bool state_fromManifest(segment_state_t* state, const manifest_t* manifest){
+    int count = manifest_count(manifest);
+    state->docIDs = malloc((count + 1) * sizeof(int));
+    state->hashes = malloc((count + 1) * sizeof(uint64_t));
+    state->numDocs = 0;
+    if (state->docIDs == NULL || state->hashes == NULL) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        state->docIDs[i] = manifest_get(manifest, i)->docID;
+        state->hashes[i] = manifest_get(manifest, i)->hash;
+    }
+    state->numDocs = count;
+    return true;
+}
+
+static void state_free(segment_state_t* state){
+    free(state->deltas);
+    free(state->docIDs);
+    free(state->hashes);
+    memset(state, 0, sizeof(*state));
+}
+
+/* Make bitmap at least numBytes long; new bits are clear */
+static bool bitmap_grow(segment_bitmap_t* bitmap, const int needed){
+    if (needed > bitmap->numBytes) {
+        int numBytes = bitmap->numBytes == 0 ? 64 : bitmap->numBytes;
+        while (numBytes < needed) {
+            numBytes *= 2;
+        }
+        uint8_t* bits = realloc(bitmap->bits, numBytes);
+        if (bits == NULL) {
+            return false;
+        }
+        memset(bits + bitmap->numBytes, 0, numBytes - bitmap->numBytes);
+        bitmap->bits = bits;
+        bitmap->numBytes = numBytes;
+    }
+    return true;
+}
+
+/* Add docID to the set, growing it as needed */
+static bool bitmap_set(segment_bitmap_t* bitmap, const int docID){
+    if (!bitmap_grow(bitmap, docID / 8 + 1)) {
+        return false;
+    }
+    bitmap->bits[docID / 8] |= (uint8_t) (1 << (docID % 8));
+    return true;
+}
+
+static bool bitmap_test(const segment_bitmap_t* bitmap, const int docID){
+    return docID / 8 < bitmap->numBytes && (bitmap->bits[docID / 8] & (1 << (docID % 8))) != 0;
+}
+
+/* Read a tombstone file: the raw bytes of the bitmap */
+static bool bitmap_read(const char* path, segment_bitmap_t* bitmap){
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fseek(fp, 0, SEEK_END) == 0;
+    long size = ok ? ftell(fp) : -1;
+    ok = ok && size >= 0 && fseek(fp, 0, SEEK_SET) == 0;
+    if (ok) {
+        bitmap->bits = malloc(size > 0 ? size : 1);
+        bitmap->numBytes = (int) size;
+        ok = bitmap->bits != NULL && fread(bitmap->bits, 1, size, fp) == (size_t) size;
+    }
+    fclose(fp);
+    return ok;
+}
+
+static bool bitmap_write(const char* path, const segment_bitmap_t* bitmap){
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fwrite(bitmap->bits, 1, bitmap->numBytes, fp) == (size_t) bitmap->numBytes;
+    return (fclose(fp) == 0) && ok;
+}
+
+/* Load one index file (base or delta); a binary one is mapped rather than read */
+static index_t* load_file(const char* path){
+    if (indexfile_is(path)) {
+        return index_map(path);
+    }
+    return index_load(path, 0);
+}
+
+/* Return the size in bytes of a file; 0 if it can't be read */
+static long file_size(const char* path){
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    long size = (fseek(fp, 0, SEEK_END) == 0) ? ftell(fp) : 0;
+    fclose(fp);
+    return size > 0 ? size : 0;
+}
+
+/* Return the tier of a delta of this size: 0 up to SEGMENT_TIER_BYTES, one more for each
+ * SEGMENT_MERGE_FACTOR times larger, so merging a tier's deltas makes a delta of the next tier */
+static int delta_tier(const long size){
+    int tier = 0;
+    for (long limit = SEGMENT_TIER_BYTES; size > limit && tier < 40; limit *= SEGMENT_MERGE_FACTOR) {
+        tier++;
+    }
+    return tier;
+}
+
+/* Merge the base (if withBase) and deltas first .. first + count - 1 of state into path, with
+ * merge_indexes. Each segment is merged under the tombstones of the newer ones being merged; if
+ * dead is not NULL it receives the union of every merged delta's tombstones (caller frees bits). */
+static bool merge_segments(const char* indexFilename, const segment_state_t* state, const bool withBase,
+                           const int first, const int count, const char* path, const bool binary,
+                           segment_bitmap_t* dead){
+    int numInputs = count + (withBase ? 1 : 0);
+    merge_input_t* inputs = mem_calloc(numInputs, sizeof(merge_input_t));
+    char** paths = mem_calloc(numInputs, sizeof(char*));
+    segment_bitmap_t* hidden = mem_calloc(numInputs, sizeof(segment_bitmap_t)); // each input's tombstones
+    segment_bitmap_t newer = {NULL, 0}; // union of the tombstones of the deltas after the current one
+    bool ok = (inputs != NULL && paths != NULL && hidden != NULL);
+
+    // Newest first, so each segment is hidden under exactly the newer ones' tombstones
+    for (int n = numInputs - 1; ok && n >= 0; n--) {
+        bool isBase = withBase && n == 0;
+        int k = first + n - (withBase ? 1 : 0);
+        paths[n] = isBase ? segment_path(indexFilename, "", 0) : segment_path(indexFilename, "", state->deltas[k]);
+        ok = (paths[n] != NULL) && bitmap_grow(&hidden[n], newer.numBytes);
+        if (ok && newer.numBytes > 0) {
+            memcpy(hidden[n].bits, newer.bits, newer.numBytes);
+        }
+        if (ok && !isBase) {
+            segment_bitmap_t tombs = {NULL, 0};
+            char* deadPath = segment_path(indexFilename, ".dead", state->deltas[k]);
+            ok = deadPath != NULL && bitmap_read(deadPath, &tombs) && bitmap_grow(&newer, tombs.numBytes);
+            for (int b = 0; ok && b < tombs.numBytes; b++) {
+                newer.bits[b] |= tombs.bits[b];
+            }
+            if (!ok) {
+                fprintf(stderr, "Error: cannot read tombstones %s\n", deadPath != NULL ? deadPath : indexFilename);
+            }
+            free(tombs.bits);
+            mem_free(deadPath);
+        }
+        if (ok) {
+            inputs[n].path = paths[n];
+            inputs[n].dead = hidden[n].bits;
+            inputs[n].deadBytes = hidden[n].numBytes;
+        }
+    }
+    ok = ok && merge_indexes(inputs, numInputs, path, binary);
+
+    for (int n = 0; n < numInputs && paths != NULL && hidden != NULL; n++) {
+        mem_free(paths[n]);
+        free(hidden[n].bits);
+    }
+    mem_free(inputs);
+    mem_free(paths);
+    mem_free(hidden);
+    if (ok && dead != NULL) {
+        *dead = newer;
+    } else {
+        free(newer.bits);
+    }
+    return ok;
+}
+
+/* Replace count deltas in a row, from first, by one new delta holding what is left of them */
+static bool merge_deltas(const char* indexFilename, segment_state_t* state, const int first, const int count){
+    int generation = state->generation + 1;
+    char* deltaPath = segment_path(indexFilename, "", generation);
+    char* deadPath = segment_path(indexFilename, ".dead", generation);
+    int* merged = malloc(count * sizeof(int));
+    segment_bitmap_t dead = {NULL, 0};
+    bool ok = deltaPath != NULL && deadPath != NULL && merged != NULL
+        && merge_segments(indexFilename, state, false, first, count, deltaPath, false, &dead)
+        && bitmap_write(deadPath, &dead);
+
+    // The merged delta hides in older segments what its parts did; publishing it commits the merge
+    if (ok) {
+        memcpy(merged, &state->deltas[first], count * sizeof(int));
+        state->deltas[first] = generation;
+        memmove(&state->deltas[first + 1], &state->deltas[first + count],
+                (state->numDeltas - first - count) * sizeof(int));
+        state->numDeltas -= count - 1;
+        state->generation = generation;
+        ok = state_write(indexFilename, state);
+        if (ok) {
+            remove_deltas(indexFilename, merged, count);
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: cannot merge the deltas of %s\n", indexFilename);
+        if (deltaPath != NULL) {
+            remove(deltaPath);
+        }
+        if (deadPath != NULL) {
+            remove(deadPath);
+        }
+    }
+    free(dead.bits);
+    free(merged);
+    mem_free(deltaPath);
+    mem_free(deadPath);
+    return ok;
+}
+
+/* Remove the files of the given deltas */
+static void remove_deltas(const char* indexFilename, const int* deltas, const int numDeltas){
+    for (int k = 0; k < numDeltas; k++) {
+        char* deltaPath = segment_path(indexFilename, "", deltas[k]);
+        char* deadPath = segment_path(indexFilename, ".dead", deltas[k]);
+        if (deltaPath != NULL) {
+            remove(deltaPath);
+        }
+        if (deadPath != NULL) {
+            remove(deadPath);
+        }
+        mem_free(deltaPath);
+        mem_free(deadPath);
+    }
+}
+
+/* index_iterate helper: hide the postings of dead documents (visit->dead) */
+static void filter_word(void* arg, const char* word){
+    segment_visit_t* visit = arg;
+    visit->word = word;
+    index_iteratePostings(visit->index, word, visit, filter_posting);
+}
+
+static void filter_posting(void* arg, const int docID, const int count){
+    segment_visit_t* visit = arg;
+    if (bitmap_test(visit->dead, docID)) {
+        index_set(visit->index, visit->word, docID, 0);
+    }
+}
+
+/* index_iterate helper: copy a delta word's live postings into visit->index */
+static void merge_word(void* arg, const char* word){
+    segment_visit_t* visit = arg;
+    visit->word = word;
+    index_iteratePostings(visit->delta, word, visit, merge_posting);
+}
+
+static void merge_posting(void* arg, const int docID, const int count){
+    segment_visit_t* visit = arg;
+    index_set(visit->index, visit->word, docID, count);
+}
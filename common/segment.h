@@ -0,0 +1,116 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: segment.h
+Description: header file for CS50 segment module
+
+ * Incremental index updates. A full build writes the "base" index file and
+ * records, in indexFilename.segments, the content hash of every document it
+ * indexed (from the crawler's manifest). Later updates index only documents
+ * that are new or whose hash changed, writing them as a "delta" segment:
+ *   indexFilename.deltaN       - an index file holding just those documents
+ *   indexFilename.deltaN.dead  - a tombstone bitmap (bit d set = docID d) of
+ *                                every document added, changed or deleted by
+ *                                this update; it hides those documents'
+ *                                postings in the base and all older deltas
+ * Readers see the base plus every delta listed in indexFilename.segments.
+ * Merges (merge.c) stream segments into one without loading them: a tiered
+ * policy merges runs of similar-sized deltas into one, and compaction folds
+ * the deltas back into a new base. Every update replaces
+ * indexFilename.segments with rename(2), so a reader sees the old set of
+ * segments or the new one, never a mix.
+ *
+ * indexFilename.segments is a text file:
+ *   generation G          - number of the newest delta ever written
+ *   delta N               - one line per live delta, oldest first (a merged
+ *                           delta takes the place of the ones it replaced)
+ *   doc docID hash        - one line per indexed document (hash in hex),
+ *                           after the others, so segment_load stops before them
+ */
+
+#ifndef __SEGMENT_H
+#define __SEGMENT_H
+
+#include <stdbool.h>
+#include "index.h"
+
+/**************** segment_reset ****************/
+/* Record that indexFilename was just rebuilt from every document in pageDirectory.
+ *
+ * Caller provides:
+ *   pageDirectory - the crawler directory the index was built from
+ *   indexFilename - the index file just written by a full build
+ * We return:
+ *   true on success; false on error, after printing a message.
+ * We do:
+ *   write indexFilename.segments with no deltas and the manifest's document
+ *   hashes, then remove the delta files it used to list. Without a manifest,
+ *   we remove indexFilename.segments instead (incremental updates need one).
+ */
+bool segment_reset(const char* pageDirectory, const char* indexFilename);
+
+/**************** segment_update ****************/
+/* Bring the index up to date with pageDirectory by writing a delta segment.
+ *
+ * Caller provides:
+ *   pageDirectory - a crawler directory with a .manifest
+ *   indexFilename - an index previously built (and recorded) by a full build
+ * We return:
+ *   number of documents added, changed or deleted (0 = nothing to do);
+ *   -1 on error, after printing a message. The index is unchanged on error.
+ * We do:
+ *   compare the manifest's document hashes with the recorded ones, index only
+ *   the new and changed documents into indexFilename.deltaN, tombstone every
+ *   new, changed and deleted document, and publish the new segments file.
+ *   Then we merge segments as segment_maintain decides.
+ */
+int segment_update(const char* pageDirectory, const char* indexFilename);
+
+/**************** segment_compact ****************/
+/* Merge the base and all deltas of indexFilename into a new base.
+ *
+ * We return:
+ *   true on success (including when there is nothing to merge); false on error.
+ * Notes:
+ *   the base and deltas are streamed (merge_indexes) into a temporary file,
+ *   in bounded memory, which is renamed over indexFilename,
+ *   then the segments file is replaced and the old deltas removed, so queriers
+ *   starting at any moment load an index with the same contents.
+ */
+bool segment_compact(const char* indexFilename);
+
+/**************** segment_maintain ****************/
+/* Merge the segments of indexFilename as the tiered merge policy says.
+ *
+ * We return:
+ *   true on success (including when there is nothing to merge); false on error.
+ * We do:
+ *   compact into the base when there are SEGMENT_MAX_DELTAS deltas, or the
+ *   deltas take 1/SEGMENT_MERGE_FACTOR of the base's bytes or more.
+ *   Otherwise, put each delta in a tier by size (tier 0 up to 64 KB, each
+ *   next tier SEGMENT_MERGE_FACTOR times larger), and merge the lowest tier's
+ *   run of SEGMENT_MERGE_FACTOR or more deltas in a row into one delta of
+ *   the next tier; repeat until no tier has such a run. So a reader loads
+ *   about SEGMENT_MERGE_FACTOR deltas per tier, a few tiers in all, and
+ *   each posting is rewritten about once per tier it climbs.
+ * Notes:
+ *   every merge streams its segments (merge_indexes) and is published with
+ *   rename(2) like an update, so it runs while queriers start and load.
+ */
+bool segment_maintain(const char* indexFilename);
+
+/**************** segment_load ****************/
+/* Load indexFilename plus its live deltas into one index.
+ *
+ * We return:
+ *   a new index, as load_index would return for the compacted file; NULL on error.
+ * Notes:
+ *   without indexFilename.segments this is just load_index on indexFilename.
+ *   A binary base (saveIndex_toBinary) with no live deltas is mapped with
+ *   index_map, not read; with deltas it is copied into memory to merge them.
+ *   Compaction keeps the base's format, so it maps again afterwards.
+ *   Caller is responsible for later calling index_delete().
+ */
+index_t* segment_load(const char* indexFilename);
+
+#endif // __SEGMENT_H
@@ -0,0 +1,474 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: shard.c
+Description: (CS-50) Module to split an index into shards, by docID range or by term, and evaluate queries on them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
+#include "shard.h"
+#include "index.h"
+#include "indexfile.h"
+#include "query.h"
+#include "counters.h"
+#include "mem.h"
+
+/**************** local constants ****************/
+static const char* SHARD_MAGIC = "tse-shards";  // first word of a shard list; index words are letters only
+static const int SHARD_MAX = 4096;              // most shards a list may name
+
+/**************** local types ****************/
+/* One shard: its docID range, file and, once loaded, index */
+typedef struct shard {
+    int firstDocID;
+    int lastDocID;
+    char* path;
+    index_t* index;
+} shard_t;
+
+typedef struct shard_set {
+    shard_t* shards;
+    int numShards;
+    bool byTerm;        // split by term: each word is in one shard, with all its postings
+    index_t** indexes;  // the shards' indexes, in order, for process_query_weighted
+} shard_set_t;
+
+/* Postings per docID of an index being split, counted by count_word and count_posting */
+typedef struct shard_histogram {
+    index_t* index;
+    int* postings;      // postings[d]: number of postings with docID d
+    int size;           // entries in postings
+    bool ok;            // false if out of memory
+} shard_histogram_t;
+
+/* One shard's part of a query, run by query_thread */
+typedef struct shard_task {
+    index_t* index;
+    char** words;
+    int num_words;
+    const int* weights;
+    int k;
+    query_hit_t* hits;  // result: the shard's k best, best first
+    int num_hits;       // -1 if out of memory
+    int num_matches;
+} shard_task_t;
+
+/**************** local functions ****************/
+static bool write_shards(index_t* index, const char* indexFilename, const int numShards,
+                         const int* lastDocIDs, const bool binary);
+static char* shard_path(const char* indexFilename, const char* suffix, const int shard);
+static void count_word(void* arg, const char* word);
+static void count_posting(void* arg, const int docID, const int count);
+static void* load_thread(void* arg);
+static void* query_thread(void* arg);
+
+
+/**************** global functions ****************/
+bool shard_write(index_t* index, const char* indexFilename, int numShards, const bool binary){
+    if (index == NULL || indexFilename == NULL) {
+        return false;
+    }
+    if (numShards < 1) {
+        numShards = 1;
+    }
+
+    // Count the postings of each docID
+    shard_histogram_t histogram = {index, NULL, 0, true};
+    index_iterate(index, &histogram, count_word);
+    int* lastDocIDs = malloc(numShards * sizeof(int));
+    if (!histogram.ok || lastDocIDs == NULL) {
+        fprintf(stderr, "Error: out of memory sharding the index\n");
+        free(histogram.postings);
+        free(lastDocIDs);
+        return false;
+    }
+    long total = 0;
+    int numDocs = 0;
+    for (int d = 1; d < histogram.size; d++) {
+        total += histogram.postings[d];
+        numDocs += (histogram.postings[d] > 0);
+    }
+    if (numShards > numDocs) {
+        numShards = (numDocs > 0) ? numDocs : 1;
+    }
+
+    // Cut once the postings so far reach each shard's share, leaving a document for every later shard
+    long done = 0;
+    int docsLeft = numDocs;
+    int shard = 0;
+    for (int d = 1; d < histogram.size && shard < numShards - 1; d++) {
+        if (histogram.postings[d] > 0) {
+            done += histogram.postings[d];
+            docsLeft--;
+            if (done * numShards >= total * (shard + 1) || docsLeft == numShards - shard - 1) {
+                lastDocIDs[shard++] = d;
+            }
+        }
+    }
+    lastDocIDs[numShards - 1] = INT_MAX; // The last shard also takes any later docIDs
+    free(histogram.postings);
+
+    bool ok = write_shards(index, indexFilename, numShards, lastDocIDs, binary);
+    free(lastDocIDs);
+    return ok;
+}
+
+
+bool shard_writeTerms(index_t* index, const char* indexFilename, int numShards, const bool binary){
+    if (index == NULL || indexFilename == NULL) {
+        return false;
+    }
+    return write_shards(index, indexFilename, (numShards < 1) ? 1 : numShards, NULL, binary);
+}
+
+
+bool shard_is(const char* indexFilename){
+    if (indexFilename == NULL) {
+        return false;
+    }
+    FILE* fp = fopen(indexFilename, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    char first[16];
+    bool is = fgets(first, sizeof(first), fp) != NULL
+        && strncmp(first, SHARD_MAGIC, strlen(SHARD_MAGIC)) == 0 && first[strlen(SHARD_MAGIC)] == ' ';
+    fclose(fp);
+    return is;
+}
+
+
+shard_set_t* shard_load(const char* indexFilename){
+    if (indexFilename == NULL) {
+        return NULL;
+    }
+    FILE* fp = fopen(indexFilename, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    char magic[16];
+    char split[16];
+    int numShards = 0;
+    if (fscanf(fp, "%15s %d %15s", magic, &numShards, split) != 3 || strcmp(magic, SHARD_MAGIC) != 0
+        || (strcmp(split, "docs") != 0 && strcmp(split, "terms") != 0)
+        || numShards < 1 || numShards > SHARD_MAX) {
+        fclose(fp);
+        return NULL;
+    }
+    shard_set_t* set = mem_malloc(sizeof(shard_set_t));
+    shard_t* shards = mem_calloc(numShards, sizeof(shard_t));
+    index_t** indexes = mem_calloc(numShards, sizeof(index_t*));
+    if (set == NULL || shards == NULL || indexes == NULL) {
+        mem_free(set);
+        mem_free(shards);
+        mem_free(indexes);
+        fclose(fp);
+        return NULL;
+    }
+    set->shards = shards;
+    set->numShards = numShards;
+    set->byTerm = (strcmp(split, "terms") == 0);
+    set->indexes = indexes;
+
+    // Each shard's line must follow the one before it; a docID range starts where the one before ended
+    bool ok = true;
+    for (int s = 0; ok && s < numShards; s++) {
+        int number;
+        if (set->byTerm) {
+            ok = fscanf(fp, " shard %d", &number) == 1;
+            shards[s].firstDocID = 1;
+            shards[s].lastDocID = INT_MAX;
+        } else {
+            ok = fscanf(fp, " shard %d %d %d", &number, &shards[s].firstDocID, &shards[s].lastDocID) == 3
+                && shards[s].firstDocID <= shards[s].lastDocID
+                && (s == 0 || (shards[s - 1].lastDocID < INT_MAX && shards[s].firstDocID == shards[s - 1].lastDocID + 1));
+        }
+        ok = ok && number == s + 1 && (shards[s].path = shard_path(indexFilename, "", s + 1)) != NULL;
+    }
+    fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "Error: malformed shard list '%s'\n", indexFilename);
+        shard_delete(set);
+        return NULL;
+    }
+
+    // Load the shards in parallel; this thread loads the first one
+    pthread_t* threads = mem_calloc(numShards, sizeof(pthread_t));
+    bool* started = mem_calloc(numShards, sizeof(bool));
+    if (threads == NULL || started == NULL) {
+        mem_free(threads);
+        mem_free(started);
+        shard_delete(set);
+        return NULL;
+    }
+    for (int s = 1; s < numShards; s++) {
+        started[s] = (pthread_create(&threads[s], NULL, load_thread, &shards[s]) == 0);
+    }
+    load_thread(&shards[0]);
+    for (int s = 1; s < numShards; s++) {
+        if (started[s]) {
+            pthread_join(threads[s], NULL);
+        } else {
+            load_thread(&shards[s]); // Couldn't start a thread; load that shard here
+        }
+    }
+    mem_free(threads);
+    mem_free(started);
+
+    for (int s = 0; s < numShards; s++) {
+        if (shards[s].index == NULL) {
+            fprintf(stderr, "Error: cannot load shard %s\n", shards[s].path);
+            ok = false;
+        }
+        indexes[s] = shards[s].index;
+    }
+    if (!ok) {
+        shard_delete(set);
+        return NULL;
+    }
+    return set;
+}
+
+
+int shard_count(const shard_set_t* set){
+    return (set == NULL) ? 0 : set->numShards;
+}
+
+
+bool shard_byTerm(const shard_set_t* set){
+    return set != NULL && set->byTerm;
+}
+
+
+bool shard_hasPositions(const shard_set_t* set){
+    if (set == NULL) {
+        return false;
+    }
+    for (int s = 0; s < set->numShards; s++) {
+        if (!index_hasPositions(set->indexes[s])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool shard_hasFields(const shard_set_t* set){
+    if (set == NULL) {
+        return false;
+    }
+    for (int s = 0; s < set->numShards; s++) {
+        if (!index_hasFields(set->indexes[s])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int shard_query(shard_set_t* set, char** words, const int num_words, const int* weights, const int k,
+                query_hit_t** hits, int* num_matches){
+    if (set == NULL || hits == NULL || num_matches == NULL) {
+        return -1;
+    }
+    if (set->byTerm) { // Each word goes to the one shard holding it, so this thread asks them in turn
+        counters_t* result = process_query_weighted(words, num_words, set->indexes, set->numShards, weights);
+        int num_hits = rank_results(result, k, hits, num_matches);
+        counters_delete(result);
+        return num_hits;
+    }
+    int numShards = set->numShards;
+    shard_task_t* tasks = mem_calloc(numShards, sizeof(shard_task_t));
+    pthread_t* threads = mem_calloc(numShards, sizeof(pthread_t));
+    bool* started = mem_calloc(numShards, sizeof(bool));
+    if (tasks == NULL || threads == NULL || started == NULL) {
+        mem_free(tasks);
+        mem_free(threads);
+        mem_free(started);
+        return -1;
+    }
+
+    // Each shard ranks its own matches; this thread takes the first shard
+    for (int s = 0; s < numShards; s++) {
+        tasks[s].index = set->shards[s].index;
+        tasks[s].words = words;
+        tasks[s].num_words = num_words;
+        tasks[s].weights = weights;
+        tasks[s].k = k;
+    }
+    for (int s = 1; s < numShards; s++) {
+        started[s] = (pthread_create(&threads[s], NULL, query_thread, &tasks[s]) == 0);
+    }
+    query_thread(&tasks[0]);
+    for (int s = 1; s < numShards; s++) {
+        if (started[s]) {
+            pthread_join(threads[s], NULL);
+        } else {
+            query_thread(&tasks[s]); // Couldn't start a thread; query that shard here
+        }
+    }
+    mem_free(threads);
+    mem_free(started);
+
+    // A document is in one shard only, so the overall k best are among the shards' k best
+    int total = 0;
+    int matches = 0;
+    bool ok = true;
+    for (int s = 0; s < numShards; s++) {
+        ok = ok && tasks[s].num_hits >= 0;
+        total += (tasks[s].num_hits > 0) ? tasks[s].num_hits : 0;
+        matches += tasks[s].num_matches;
+    }
+    query_hit_t* merged = ok ? malloc((total > 0 ? total : 1) * sizeof(query_hit_t)) : NULL;
+    int num_hits = -1;
+    if (merged != NULL) {
+        num_hits = 0;
+        for (int s = 0; s < numShards; s++) {
+            if (tasks[s].num_hits > 0) {
+                memcpy(merged + num_hits, tasks[s].hits, tasks[s].num_hits * sizeof(query_hit_t));
+                num_hits += tasks[s].num_hits;
+            }
+        }
+        if (numShards > 1 && num_hits > 1) {
+            qsort(merged, num_hits, sizeof(query_hit_t), compare_hits);
+        }
+        if (k > 0 && num_hits > k) {
+            num_hits = k;
+        }
+        *hits = merged;
+        *num_matches = matches;
+    }
+    for (int s = 0; s < numShards; s++) {
+        free(tasks[s].hits);
+    }
+    mem_free(tasks);
+    return num_hits;
+}
+
+
+void shard_delete(shard_set_t* set){
+    if (set != NULL) {
+        for (int s = 0; s < set->numShards; s++) {
+            index_delete(set->shards[s].index);
+            mem_free(set->shards[s].path);
+        }
+        mem_free(set->shards);
+        mem_free(set->indexes);
+        mem_free(set);
+    }
+}
+
+
+/**************** local functions ****************/
+/* Write the shards (by docID range, with lastDocIDs[s] ending shard s, or else by term), then
+ * publish the list naming them; false on error, after printing a message */
+static bool write_shards(index_t* index, const char* indexFilename, const int numShards,
+                         const int* lastDocIDs, const bool binary){
+    bool ok = true;
+    for (int s = 0; ok && s < numShards; s++) {
+        char* path = shard_path(indexFilename, "", s + 1);
+        if (lastDocIDs != NULL) {
+            int firstDocID = (s == 0) ? 1 : lastDocIDs[s - 1] + 1;
+            ok = (path != NULL) && saveIndex_range(index, path, firstDocID, lastDocIDs[s], binary);
+        } else {
+            ok = (path != NULL) && saveIndex_terms(index, path, s, numShards, binary);
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: unable to write shard %d of '%s'\n", s + 1, indexFilename);
+        }
+        mem_free(path);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    char* tmpPath = shard_path(indexFilename, ".tmp", 0);
+    FILE* fp = (tmpPath != NULL) ? fopen(tmpPath, "w") : NULL;
+    if (fp != NULL) {
+        fprintf(fp, "%s %d %s\n", SHARD_MAGIC, numShards, (lastDocIDs != NULL) ? "docs" : "terms");
+        for (int s = 0; s < numShards; s++) {
+            if (lastDocIDs != NULL) {
+                fprintf(fp, "shard %d %d %d\n", s + 1, (s == 0) ? 1 : lastDocIDs[s - 1] + 1, lastDocIDs[s]);
+            } else {
+                fprintf(fp, "shard %d\n", s + 1);
+            }
+        }
+        ok = !ferror(fp);
+        ok = (fclose(fp) == 0) && ok && rename(tmpPath, indexFilename) == 0;
+        if (!ok) {
+            remove(tmpPath);
+        }
+    } else {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: unable to write the shard list '%s'\n", indexFilename);
+    }
+    mem_free(tmpPath);
+    return ok;
+}
+
+/* Return a new string "indexFilename.shardN" (N = shard > 0) or "indexFilename" then suffix; NULL if out of memory */
+static char* shard_path(const char* indexFilename, const char* suffix, const int shard){
+    size_t len = strlen(indexFilename) + strlen(suffix) + 32;
+    char* path = mem_malloc(len);
+    if (path != NULL) {
+        if (shard > 0) {
+            snprintf(path, len, "%s.shard%d%s", indexFilename, shard, suffix);
+        } else {
+            snprintf(path, len, "%s%s", indexFilename, suffix);
+        }
+    }
+    return path;
+}
+
+/* index_iterate helper for shard_write: count the word's postings by docID */
+static void count_word(void* arg, const char* word){
+    shard_histogram_t* histogram = arg;
+    if (histogram->ok) {
+        index_iteratePostings(histogram->index, word, histogram, count_posting);
+    }
+}
+
+static void count_posting(void* arg, const int docID, const int count){
+    shard_histogram_t* histogram = arg;
+    if (!histogram->ok) {
+        return;
+    }
+    if (docID >= histogram->size) {
+        int size = (histogram->size == 0) ? 1024 : histogram->size;
+        while (size <= docID) {
+            size = (size > INT_MAX / 2) ? INT_MAX : size * 2;
+        }
+        int* postings = realloc(histogram->postings, size * sizeof(int));
+        if (postings == NULL) {
+            histogram->ok = false;
+            return;
+        }
+        memset(postings + histogram->size, 0, (size - histogram->size) * sizeof(int));
+        histogram->postings = postings;
+        histogram->size = size;
+    }
+    histogram->postings[docID]++;
+}
+
+/* Thread body: load one shard, mapping it if it is binary */
+static void* load_thread(void* arg){
+    shard_t* shard = arg;
+    shard->index = indexfile_is(shard->path) ? index_map(shard->path) : index_load(shard->path, 1);
+    return NULL;
+}
+
+/* Thread body: evaluate the query on one shard and keep its k best documents */
+static void* query_thread(void* arg){
+    shard_task_t* task = arg;
+    counters_t* result = process_query_weighted(task->words, task->num_words, &task->index, 1, task->weights);
+    task->num_hits = rank_results(result, task->k, &task->hits, &task->num_matches);
+    counters_delete(result);
+    return NULL;
+}
@@ -0,0 +1,139 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: shard.h
+Description: header file for CS50 shard module
+
+ * Sharded indexes. A sharded build splits one index into S shards, each an
+ * ordinary index file (text or binary):
+ *   indexFilename.shardN   - the Nth shard, N = 1..S
+ * and writes indexFilename itself as a short text list of the shards:
+ *   tse-shards S docs      - a first line no index file can start with, and
+ *   tse-shards S terms       how the index was split
+ *   shard N first last     - one line per shard: its docID range (docs), or
+ *   shard N                  just its number (terms)
+ *
+ * Split by docID range, the shards hold about equal numbers of postings. The
+ * querier evaluates each query on every shard at once, one thread per shard,
+ * keeps each shard's best k documents, and merges them. Every document is in
+ * exactly one shard, so scores need no combining across shards.
+ *
+ * Split by term, a word and all its postings are in shard
+ * index_termShard(word, S) + 1. The querier looks each query word up in its
+ * shard only, so a two-word query touches two shards however many there are;
+ * a prefix ("play*") is looked up in every shard.
+ */
+
+#ifndef __SHARD_H
+#define __SHARD_H
+
+#include <stdbool.h>
+#include "index.h"
+#include "query.h"
+
+/**************** global types ****************/
+typedef struct shard_set shard_set_t;  // the loaded shards of an index; opaque to users
+
+
+/**************** shard_write ****************/
+/* Write an index as numShards shards of consecutive docID ranges.
+ *
+ * Caller provides:
+ *   index, the index filename (whose shard list we write), the number of
+ *   shards (values < 1 are treated as 1), and whether to write binary shards.
+ * We return:
+ *   true on success; false on error, after printing a message.
+ * We do:
+ *   count the index's postings per docID and cut the docIDs where each
+ *   shard gets about 1/numShards of them (fewer shards if there are fewer
+ *   documents), write each shard with saveIndex_range, then publish the list
+ *   through a temporary file and rename(2).
+ */
+bool shard_write(index_t* index, const char* indexFilename, int numShards, const bool binary);
+
+
+/**************** shard_writeTerms ****************/
+/* Write an index as numShards shards of its words, split by word hash.
+ *
+ * Caller provides:
+ *   as for shard_write.
+ * We return:
+ *   true on success; false on error, after printing a message.
+ * We do:
+ *   write shard N with saveIndex_terms, holding the words w with
+ *   index_termShard(w, numShards) == N - 1, then publish the list as shard_write does.
+ */
+bool shard_writeTerms(index_t* index, const char* indexFilename, int numShards, const bool binary);
+
+
+/**************** shard_is ****************/
+/* Return true if indexFilename is a shard list (as shard_write writes). */
+bool shard_is(const char* indexFilename);
+
+
+/**************** shard_load ****************/
+/* Load every shard of a shard list.
+ *
+ * We return:
+ *   the loaded shards; NULL if the list or a shard can't be read.
+ * We do:
+ *   load the shards in parallel, one thread each: a binary shard is mapped
+ *   (index_map), a text shard loaded (index_load).
+ * Caller is responsible for:
+ *   later calling shard_delete().
+ */
+shard_set_t* shard_load(const char* indexFilename);
+
+
+/**************** shard_count ****************/
+/* Return the number of shards in the set; 0 if set is NULL. */
+int shard_count(const shard_set_t* set);
+
+
+/**************** shard_byTerm ****************/
+/* Return true if the set's index was split by term (shard_writeTerms); false if by docID or set is NULL. */
+bool shard_byTerm(const shard_set_t* set);
+
+
+/**************** shard_hasPositions ****************/
+/* Return true if every shard of the set keeps positions (indexer -p), so
+ * phrase and near queries can be answered; false if set is NULL. */
+bool shard_hasPositions(const shard_set_t* set);
+
+
+/**************** shard_hasFields ****************/
+/* Return true if every shard of the set has field postings (indexer -f), so
+ * queries can be ranked with fields; false if set is NULL. */
+bool shard_hasFields(const shard_set_t* set);
+
+
+/**************** shard_query ****************/
+/* Evaluate a tokenized query (from tokenize_query) on every shard, and rank the results.
+ *
+ * Caller provides:
+ *   the shards, the query's words, weights for ranking with fields (as for
+ *   process_query_weighted; NULL for none), and k, the number of documents
+ *   wanted (k < 1: every match)
+ * We return:
+ *   the number of documents in *hits, best first (at most k); -1 if out of
+ *   memory. *num_matches is set to the number of matching documents.
+ * We do:
+ *   split by docID: run process_query_weighted and rank_results on each shard in
+ *   its own thread (this one does the first), so a query takes about as long
+ *   as its slowest shard; then merge the shards' k best into the overall k best.
+ *   split by term: run process_query_weighted, which reads each word from its own
+ *   shard, and rank_results in this thread.
+ * Notes:
+ *   the ranking is the one process_query_weighted and rank_results give for
+ *   the unsharded index.
+ *   Caller is responsible for later calling free(*hits).
+ */
+int shard_query(shard_set_t* set, char** words, const int num_words, const int* weights, const int k,
+                query_hit_t** hits, int* num_matches);
+
+
+/**************** shard_delete ****************/
+/* Delete every shard's index and the set. We ignore NULL. */
+void shard_delete(shard_set_t* set);
+
+#endif // __SHARD_H
@@ -0,0 +1,149 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: spimi.c
+Description: (CS-50) Module to build an index in bounded memory with sorted on-disk runs.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "spimi.h"
+#include "index.h"
+#include "merge.h"
+#include "pagedir.h"
+#include "mem.h"
+#include "webpage.h"
+
+/**************** local constants ****************/
+static const int BLOCK_WORDS = 700;  // expected words in a new block (it grows as needed)
+
+/**************** local types ****************/
+/* The runs written so far */
+typedef struct spimi_runs {
+    char** paths;
+    int count;
+} spimi_runs_t;
+
+/**************** local functions ****************/
+static bool block_flush(index_t* block, const char* indexFilename, spimi_runs_t* runs);
+static bool merge_runs(char** runPaths, const int numRuns, const char* indexFilename, const bool binary);
+static char* run_path(const char* indexFilename, const int runNumber);
+
+
+/**************** global functions ****************/
+bool spimi_build(char* pageDirectory, char* indexFilename, size_t memoryBudget, const bool binary){
+    if (pageDirectory == NULL || indexFilename == NULL || memoryBudget == 0) {
+        return false;
+    }
+    int* docIDs = NULL;
+    uint64_t* sizes = NULL;
+    int numDocs = pagedir_listDocs(pageDirectory, &docIDs, &sizes);
+    if (numDocs <= 0) {
+        return false; // pagedir_listDocs printed the error
+    }
+    free(sizes);
+
+    spimi_runs_t runs = {NULL, 0};
+    index_t* block = index_new(BLOCK_WORDS); // The in-memory block is an ordinary index
+    int blockDocs = 0;                       // documents indexed into the block
+    bool ok = (block != NULL);
+
+    // Index documents in docID order, writing a run each time the block fills up
+    for (int i = 0; ok && i < numDocs; i++) {
+        webpage_t* page = pagedir_load(pageDirectory, docIDs[i]);
+        if (page == NULL) {
+            fprintf(stderr, "Error: cannot read document %s/%d\n", pageDirectory, docIDs[i]);
+            continue;
+        }
+        indexPage(page, docIDs[i], block);
+        webpage_delete(page);
+        blockDocs++;
+
+        // The block's words and postings all live in its arena, so its size is known exactly
+        if (index_memory(block) >= memoryBudget) {
+            ok = block_flush(block, indexFilename, &runs);
+            index_delete(block);
+            block = ok ? index_new(BLOCK_WORDS) : NULL;
+            blockDocs = 0;
+            ok = (block != NULL);
+        }
+    }
+    if (ok && blockDocs > 0) {
+        ok = block_flush(block, indexFilename, &runs);
+    }
+    index_delete(block);
+    free(docIDs);
+
+    // Combine the runs into the index file
+    if (ok) {
+        if (runs.count == 0) { // No words at all: an empty index
+            FILE* fp = fopen(indexFilename, "w");
+            ok = (fp != NULL) && fclose(fp) == 0;
+        } else if (runs.count == 1 && !binary) { // A single run already is the index
+            ok = rename(runs.paths[0], indexFilename) == 0;
+        } else {
+            ok = merge_runs(runs.paths, runs.count, indexFilename, binary);
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: failed to build index %s in bounded memory\n", indexFilename);
+    }
+
+    for (int r = 0; r < runs.count; r++) {
+        remove(runs.paths[r]); // Already gone if it was renamed into place
+        mem_free(runs.paths[r]);
+    }
+    free(runs.paths);
+    return ok;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Write the block as the next run: saveIndex_toPage writes words in sorted order, each with its
+ * postings in increasing docID order */
+static bool block_flush(index_t* block, const char* indexFilename, spimi_runs_t* runs){
+    char** paths = realloc(runs->paths, (runs->count + 1) * sizeof(char*));
+    if (paths != NULL) {
+        runs->paths = paths;
+    }
+    char* path = run_path(indexFilename, runs->count);
+    bool ok = (paths != NULL && path != NULL);
+    if (ok) {
+        runs->paths[runs->count++] = path;
+        ok = saveIndex_toPage(block, path);
+        if (!ok) {
+            fprintf(stderr, "Error: failed to write run %s\n", path);
+        }
+    } else {
+        mem_free(path);
+    }
+    return ok;
+}
+
+/* Merge the sorted runs into the index file (merge.c). Runs hold increasing docID ranges, so each
+ * word's postings are joined in run order without sorting. */
+static bool merge_runs(char** runPaths, const int numRuns, const char* indexFilename, const bool binary){
+    merge_input_t* inputs = mem_calloc(numRuns, sizeof(merge_input_t));
+    if (inputs == NULL) {
+        return false;
+    }
+    for (int r = 0; r < numRuns; r++) {
+        inputs[r].path = runPaths[r];
+    }
+    bool ok = merge_indexes(inputs, numRuns, indexFilename, binary);
+    mem_free(inputs);
+    return ok;
+}
+
+/* Build the string indexFilename.runN; caller frees */
+static char* run_path(const char* indexFilename, const int runNumber){
+    size_t len = strlen(indexFilename) + 20;
+    char* path = mem_malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s.run%d", indexFilename, runNumber);
+    }
+    return path;
+}
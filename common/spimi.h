@@ -0,0 +1,42 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: spimi.h
+Description: header file for CS50 spimi module
+
+ * SPIMI (single-pass in-memory indexing) builds an index file for a page
+ * directory of any size in bounded memory. Documents are indexed in docID
+ * order into an in-memory block; whenever the block's estimated size reaches
+ * the memory budget, it is written to disk as a "run": an index file whose
+ * words are in sorted order and whose postings are in increasing docID order.
+ * Finally the runs are merged k ways into the index file (merge.c), streaming
+ * one word per run, so memory never holds more than one block.
+ */
+
+#ifndef __SPIMI_H
+#define __SPIMI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************** spimi_build ****************/
+/* Index every document in pageDirectory into indexFilename using at most
+ * roughly memoryBudget bytes for the in-memory block.
+ *
+ * Caller provides:
+ *   pageDirectory - a directory written by the crawler
+ *   indexFilename - the index file to write
+ *   memoryBudget - bytes allowed for one in-memory block (must be > 0)
+ *   binary - write the index file as binary (saveIndex_toBinary) rather than text
+ * We return:
+ *   true if the index file was written; false on any error, after printing a message.
+ * We guarantee:
+ *   the index file has the contents saveIndex_toPage (or saveIndex_toBinary)
+ *   writes for indexBuild(pageDirectory), with words sorted and docIDs increasing.
+ * Notes:
+ *   runs are written next to indexFilename as indexFilename.runN and removed
+ *   when the merge finishes (or fails).
+ */
+bool spimi_build(char* pageDirectory, char* indexFilename, size_t memoryBudget, const bool binary);
+
+#endif // __SPIMI_H
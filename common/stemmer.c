@@ -0,0 +1,406 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: stemmer.c
+Description: (CS-50) Module to stem words with Porter's algorithm, memoizing recent stems.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "stemmer.h"
+#include "mem.h"
+
+#ifndef STEMMER_ENABLED
+#define STEMMER_ENABLED 0   // set by the Makefile: make STEM=1
+#endif
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+#define STEMMER_WORD 32                  // longest cached word, plus its NUL
+static const int STEMMER_ENTRIES = 16384; // default cache size; a power of 2
+
+/* One cached word and its stem */
+typedef struct stemmer_entry {
+    uint32_t hash;           // of word
+    unsigned char len;       // of word; 0 if the entry is empty
+    unsigned char stemLen;
+    char word[STEMMER_WORD];
+    char stem[STEMMER_WORD];
+} stemmer_entry_t;
+
+/* The word being stemmed, b[k0..k], as in Porter's reference implementation */
+typedef struct stem_state {
+    char* b;
+    int k;    // offset of the last letter
+    int k0;   // offset of the first letter
+    int j;    // a general offset; set by ends()
+} stem_state_t;
+
+/* A suffix and what it becomes */
+typedef struct stem_rule {
+    const char* suffix;
+    const char* replacement;
+} stem_rule_t;
+
+/*------------------------------------------------- Global Types -----------------------------------------------------*/
+typedef struct stemmer {
+    stemmer_entry_t* entries;  // 2-way sets: a word can only be in entries[2 * set] or entries[2 * set + 1],
+    int numEntries;            // the first the more recently used. A power of 2
+    char* scratch;             // stem of a word too long to cache
+    int scratchSize;
+} stemmer_t;
+
+/*------------------------------------------------- Local Functions --------------------------------------------------*/
+static bool cons(const stem_state_t* z, const int i);
+static int m(const stem_state_t* z);
+static bool vowelinstem(const stem_state_t* z);
+static bool doublec(const stem_state_t* z, const int j);
+static bool cvc(const stem_state_t* z, const int i);
+static bool ends(stem_state_t* z, const char* s);
+static void setto(stem_state_t* z, const char* s);
+static bool replace_first(stem_state_t* z, const stem_rule_t* rules, const int numRules);
+static void step1ab(stem_state_t* z);
+static void step1c(stem_state_t* z);
+static void step2(stem_state_t* z);
+static void step3(stem_state_t* z);
+static void step4(stem_state_t* z);
+static void step5(stem_state_t* z);
+static uint32_t stemmer_hash(const char* word, const int len);
+
+/*------------------------------------------------- Local Variables --------------------------------------------------*/
+static const stem_rule_t STEP2_RULES[] = {
+    {"ational", "ate"}, {"tional", "tion"}, {"enci", "ence"}, {"anci", "ance"}, {"izer", "ize"},
+    {"bli", "ble"}, {"alli", "al"}, {"entli", "ent"}, {"eli", "e"}, {"ousli", "ous"},
+    {"ization", "ize"}, {"ation", "ate"}, {"ator", "ate"}, {"alism", "al"}, {"iveness", "ive"},
+    {"fulness", "ful"}, {"ousness", "ous"}, {"aliti", "al"}, {"iviti", "ive"}, {"biliti", "ble"},
+    {"logi", "log"}
+};
+static const stem_rule_t STEP3_RULES[] = {
+    {"icate", "ic"}, {"ative", ""}, {"alize", "al"}, {"iciti", "ic"}, {"ical", "ic"},
+    {"ful", ""}, {"ness", ""}
+};
+static const char* const STEP4_SUFFIXES[] = {
+    "al", "ance", "ence", "er", "ic", "able", "ible", "ant", "ement", "ment", "ent", "ion", "ou",
+    "ism", "ate", "iti", "ous", "ive", "ize"
+};
+
+
+/*----------------------------------------------- Global Functions ----------------------------------------------------*/
+bool stemmer_enabled(void){
+    return STEMMER_ENABLED != 0;
+}
+
+
+int stemmer_word(char* word, const int len){
+    if (word == NULL || len <= 2) { // Porter leaves words of 1 or 2 letters alone
+        return len > 0 ? len : 0;
+    }
+    stem_state_t z = { .b = word, .k = len - 1, .k0 = 0, .j = 0 };
+    step1ab(&z);
+    if (z.k > z.k0) {
+        step1c(&z);
+        step2(&z);
+        step3(&z);
+        step4(&z);
+        step5(&z);
+    }
+    return z.k + 1;
+}
+
+
+stemmer_t* stemmer_new(const int numEntries){
+    stemmer_t* stemmer = mem_malloc(sizeof(stemmer_t));
+    if (stemmer == NULL) {
+        return NULL;
+    }
+    int wanted = numEntries > 0 ? numEntries : STEMMER_ENTRIES;
+    stemmer->numEntries = 2;
+    while (stemmer->numEntries < wanted) {
+        stemmer->numEntries *= 2;
+    }
+    stemmer->entries = calloc(stemmer->numEntries, sizeof(stemmer_entry_t));
+    stemmer->scratch = NULL;
+    stemmer->scratchSize = 0;
+    if (stemmer->entries == NULL) {
+        mem_free(stemmer);
+        return NULL;
+    }
+    return stemmer;
+}
+
+
+const char* stemmer_stem(stemmer_t* stemmer, const char* word, const int len, int* stemLen){
+    if (stemmer == NULL || word == NULL || len < 0) {
+        return NULL;
+    }
+    // Too long to cache: stem a copy in the scratch buffer
+    if (len >= STEMMER_WORD) {
+        if (len + 1 > stemmer->scratchSize) {
+            char* scratch = realloc(stemmer->scratch, len + 1);
+            if (scratch == NULL) {
+                return NULL;
+            }
+            stemmer->scratch = scratch;
+            stemmer->scratchSize = len + 1;
+        }
+        memcpy(stemmer->scratch, word, len);
+        int n = stemmer_word(stemmer->scratch, len);
+        stemmer->scratch[n] = '\0';
+        if (stemLen != NULL) {
+            *stemLen = n;
+        }
+        return stemmer->scratch;
+    }
+
+    uint32_t hash = stemmer_hash(word, len);
+    stemmer_entry_t* entry = &stemmer->entries[2 * (hash & (stemmer->numEntries / 2 - 1))];
+    if (entry[0].len != len || entry[0].hash != hash || memcmp(entry[0].word, word, len) != 0) {
+        if (entry[1].len == len && entry[1].hash == hash && memcmp(entry[1].word, word, len) == 0) {
+            // Hit on the older way: make it the more recent
+            stemmer_entry_t hit = entry[1];
+            entry[1] = entry[0];
+            entry[0] = hit;
+        } else {
+            // Miss: evict the older way, and stem the word into the newer
+            entry[1] = entry[0];
+            memcpy(entry->word, word, len);
+            entry->word[len] = '\0';
+            memcpy(entry->stem, word, len);
+            entry->stemLen = stemmer_word(entry->stem, len);
+            entry->stem[entry->stemLen] = '\0';
+            entry->hash = hash;
+            entry->len = len;
+        }
+    }
+    if (stemLen != NULL) {
+        *stemLen = entry->stemLen;
+    }
+    return entry->stem;
+}
+
+
+size_t stemmer_memory(const stemmer_t* stemmer){
+    if (stemmer == NULL) {
+        return 0;
+    }
+    return sizeof(stemmer_t) + stemmer->numEntries * sizeof(stemmer_entry_t) + stemmer->scratchSize;
+}
+
+
+void stemmer_delete(stemmer_t* stemmer){
+    if (stemmer != NULL) {
+        free(stemmer->entries);
+        free(stemmer->scratch);
+        mem_free(stemmer);
+    }
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* The helpers below follow Porter's reference implementation, and keep its names. */
+
+/* Is b[i] a consonant? 'y' is one at the start of the word or after a vowel */
+static bool cons(const stem_state_t* z, const int i){
+    switch (z->b[i]) {
+        case 'a': case 'e': case 'i': case 'o': case 'u':
+            return false;
+        case 'y':
+            return (i == z->k0) ? true : !cons(z, i - 1);
+        default:
+            return true;
+    }
+}
+
+/* The number of vowel-consonant sequences in b[k0..j]: [C](VC)^m[V] */
+static int m(const stem_state_t* z){
+    int n = 0;
+    int i = z->k0;
+    while (true) {
+        if (i > z->j) {
+            return n;
+        }
+        if (!cons(z, i)) {
+            break;
+        }
+        i++;
+    }
+    i++;
+    while (true) {
+        while (true) {
+            if (i > z->j) {
+                return n;
+            }
+            if (cons(z, i)) {
+                break;
+            }
+            i++;
+        }
+        i++;
+        n++;
+        while (true) {
+            if (i > z->j) {
+                return n;
+            }
+            if (!cons(z, i)) {
+                break;
+            }
+            i++;
+        }
+        i++;
+    }
+}
+
+/* Does b[k0..j] contain a vowel? */
+static bool vowelinstem(const stem_state_t* z){
+    for (int i = z->k0; i <= z->j; i++) {
+        if (!cons(z, i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Are b[j-1] and b[j] the same consonant? */
+static bool doublec(const stem_state_t* z, const int j){
+    if (j < z->k0 + 1 || z->b[j] != z->b[j - 1]) {
+        return false;
+    }
+    return cons(z, j);
+}
+
+/* Is b[i-2..i] consonant-vowel-consonant, the last not w, x or y? (as in "hop" for "hoping") */
+static bool cvc(const stem_state_t* z, const int i){
+    if (i < z->k0 + 2 || !cons(z, i) || cons(z, i - 1) || !cons(z, i - 2)) {
+        return false;
+    }
+    char ch = z->b[i];
+    return ch != 'w' && ch != 'x' && ch != 'y';
+}
+
+/* Does b[k0..k] end with s? If so, set j to the offset just before it */
+static bool ends(stem_state_t* z, const char* s){
+    int length = strlen(s);
+    if (s[length - 1] != z->b[z->k] || length > z->k - z->k0 + 1) {
+        return false;
+    }
+    if (memcmp(z->b + z->k - length + 1, s, length) != 0) {
+        return false;
+    }
+    z->j = z->k - length;
+    return true;
+}
+
+/* Replace b[j+1..k] with s */
+static void setto(stem_state_t* z, const char* s){
+    int length = strlen(s);
+    memmove(z->b + z->j + 1, s, length);
+    z->k = z->j + length;
+}
+
+/* Find the first rule whose suffix ends the word; replace it if m() > 0. Return whether one matched. */
+static bool replace_first(stem_state_t* z, const stem_rule_t* rules, const int numRules){
+    for (int i = 0; i < numRules; i++) {
+        if (ends(z, rules[i].suffix)) {
+            if (m(z) > 0) {
+                setto(z, rules[i].replacement);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Remove plurals and -ed or -ing: caresses -> caress, ponies -> poni, meetings -> meet, ... */
+static void step1ab(stem_state_t* z){
+    if (z->b[z->k] == 's') {
+        if (ends(z, "sses")) {
+            z->k -= 2;
+        } else if (ends(z, "ies")) {
+            setto(z, "i");
+        } else if (z->b[z->k - 1] != 's') {
+            z->k--;
+        }
+    }
+    if (ends(z, "eed")) {
+        if (m(z) > 0) {
+            z->k--;
+        }
+    } else if ((ends(z, "ed") || ends(z, "ing")) && vowelinstem(z)) {
+        z->k = z->j;
+        if (ends(z, "at")) {
+            setto(z, "ate");
+        } else if (ends(z, "bl")) {
+            setto(z, "ble");
+        } else if (ends(z, "iz")) {
+            setto(z, "ize");
+        } else if (doublec(z, z->k)) {
+            z->k--;
+            char ch = z->b[z->k];
+            if (ch == 'l' || ch == 's' || ch == 'z') {
+                z->k++;
+            }
+        } else if (m(z) == 1 && cvc(z, z->k)) {
+            setto(z, "e");
+        }
+    }
+}
+
+/* Turn a final y into i when there is another vowel in the stem */
+static void step1c(stem_state_t* z){
+    if (ends(z, "y") && vowelinstem(z)) {
+        z->b[z->k] = 'i';
+    }
+}
+
+/* Map double suffixes to single ones: -ization -> -ize, -ational -> -ate, ... */
+static void step2(stem_state_t* z){
+    replace_first(z, STEP2_RULES, sizeof(STEP2_RULES) / sizeof(STEP2_RULES[0]));
+}
+
+/* Deal with -ic-, -full, -ness, ... */
+static void step3(stem_state_t* z){
+    replace_first(z, STEP3_RULES, sizeof(STEP3_RULES) / sizeof(STEP3_RULES[0]));
+}
+
+/* Take off -ant, -ence, ... in context <c>vcvc<v> */
+static void step4(stem_state_t* z){
+    int numSuffixes = sizeof(STEP4_SUFFIXES) / sizeof(STEP4_SUFFIXES[0]);
+    for (int i = 0; i < numSuffixes; i++) {
+        if (ends(z, STEP4_SUFFIXES[i])) {
+            // -ion only comes off after s or t
+            if (strcmp(STEP4_SUFFIXES[i], "ion") == 0 && (z->j < z->k0 || (z->b[z->j] != 's' && z->b[z->j] != 't'))) {
+                return;
+            }
+            if (m(z) > 1) {
+                z->k = z->j;
+            }
+            return;
+        }
+    }
+}
+
+/* Remove a final -e if m() > 1, and change -ll to -l if m() > 1 */
+static void step5(stem_state_t* z){
+    z->j = z->k;
+    if (z->b[z->k] == 'e') {
+        int a = m(z);
+        if (a > 1 || (a == 1 && !cvc(z, z->k - 1))) {
+            z->k--;
+        }
+    }
+    if (z->b[z->k] == 'l' && doublec(z, z->k) && m(z) > 1) {
+        z->k--;
+    }
+}
+
+/* 32-bit FNV-1a hash of the first len characters of word */
+static uint32_t stemmer_hash(const char* word, const int len){
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash ^= (unsigned char) word[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
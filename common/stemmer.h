@@ -0,0 +1,78 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: stemmer.h
+Description: header file for CS50 stemmer module
+
+ * Stemming maps the forms of a word to one "stem", so "search", "searches"
+ * and "searching" share the term "search" (and one posting list). We use
+ * M.F. Porter's algorithm ("An algorithm for suffix stripping", 1980), as in
+ * his reference implementation. Stems are not always words ("happy" becomes
+ * "happi"); they only need to be the same for the index and the querier.
+ *
+ * Stemming is a build option: "make STEM=1" turns it on for both the indexer
+ * and the querier, so an index and the queries against it always agree.
+ * (Rebuild the index after changing it, and "make clean" first.)
+ *
+ * A "stemmer" memoizes stems: a bounded, 2-way set-associative cache from surface
+ * form to stem, so each distinct word is stemmed about once rather than once
+ * per occurrence. A stemmer is not thread-safe; give each thread its own.
+ */
+
+#ifndef __STEMMER_H
+#define __STEMMER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************** global types ****************/
+typedef struct stemmer stemmer_t;  // opaque to users of the module
+
+/**************** stemmer_enabled ****************/
+/* Return true if this build stems words (make STEM=1). */
+bool stemmer_enabled(void);
+
+/**************** stemmer_word ****************/
+/* Stem a word in place.
+ *
+ * Caller provides:
+ *   word - lowercase letters a-z; len - its length
+ * We return:
+ *   the length of the stem, which replaces the first characters of word
+ *   (never longer than len). We do not write a NUL.
+ */
+int stemmer_word(char* word, const int len);
+
+/**************** stemmer_new ****************/
+/* Create a new stemmer with a cache of numEntries words (values < 1 mean a default).
+ *
+ * We return:
+ *   pointer to a new stemmer; NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling stemmer_delete().
+ */
+stemmer_t* stemmer_new(const int numEntries);
+
+/**************** stemmer_stem ****************/
+/* Return the stem of a word, from the cache if it is there.
+ *
+ * Caller provides:
+ *   valid stemmer, word (lowercase, NUL-terminated) and its length,
+ *   where to store the stem's length (may be NULL)
+ * We return:
+ *   the stem, NUL-terminated, valid until the next call; NULL if word is NULL.
+ * Notes:
+ *   a word evicts the less recently used word of its cache set; very long words
+ *   are stemmed without being cached.
+ */
+const char* stemmer_stem(stemmer_t* stemmer, const char* word, const int len, int* stemLen);
+
+/**************** stemmer_memory ****************/
+/* Return the number of bytes of heap the stemmer occupies. */
+size_t stemmer_memory(const stemmer_t* stemmer);
+
+/**************** stemmer_delete ****************/
+/* Free the stemmer. We ignore a NULL stemmer. */
+void stemmer_delete(stemmer_t* stemmer);
+
+#endif // __STEMMER_H
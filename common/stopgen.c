@@ -0,0 +1,284 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: stopgen.c
+Description:
+ * The stopgen program reads a stopword list (one lowercase word per line;
+ * blank lines and lines starting with '#' are ignored) and writes, to
+ * stdout, a C header holding a perfect-hash table of those words for
+ * stopword.c. The Makefile runs it whenever the list changes:
+ *   ./stopgen stopwords.txt > stopword_table.h
+ * Exit status: 0 on success; 1 for bad arguments; 2 if the list cannot be
+ * read or holds something other than lowercase words; 3 if out of memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "stopword.h"
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+static const int WORDS_PER_BUCKET = 4;       // average; more makes a smaller but slower-to-build table
+static const int MAX_DISPLACEMENT = 65535;   // displacements are stored as uint16_t
+static const int MAX_WORD_LENGTH = 255;      // lengths are stored as unsigned char
+
+/* The words of one bucket, as indexes into the word list */
+typedef struct bucket {
+    int* words;
+    int numWords;
+} bucket_t;
+
+/*------------------------------------------------- Local Functions --------------------------------------------------*/
+static int read_words(FILE* fp, const char* filename, char*** words);
+static bool build_table(char** words, const int numWords, const int numBuckets, const int numSlots,
+                        uint16_t* displace, int* slots);
+static int compare_buckets(const void* a, const void* b);
+static void print_table(char** words, const int numWords, const int numBuckets, const int numSlots,
+                        const uint16_t* displace, const int* slots);
+
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s stopwordFile\n", argv[0]);
+        return 1;
+    }
+    FILE* fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: cannot read %s\n", argv[1]);
+        return 2;
+    }
+    char** words = NULL;
+    int numWords = read_words(fp, argv[1], &words);
+    fclose(fp);
+    if (numWords < 0) {
+        return -numWords; // read_words printed the error
+    }
+
+    // Grow the table until every bucket finds a displacement
+    int numBuckets = numWords / WORDS_PER_BUCKET + 1;
+    int numSlots = 1;
+    while (numSlots < numWords + numWords / 4) {
+        numSlots *= 2;
+    }
+    uint16_t* displace = NULL;
+    int* slots = NULL;
+    bool built = false;
+    while (!built) {
+        free(displace);
+        free(slots);
+        displace = calloc(numBuckets, sizeof(uint16_t));
+        slots = malloc(numSlots * sizeof(int));
+        if (displace == NULL || slots == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 3;
+        }
+        built = build_table(words, numWords, numBuckets, numSlots, displace, slots);
+        if (!built) {
+            numSlots *= 2;
+        }
+    }
+    print_table(words, numWords, numBuckets, numSlots, displace, slots);
+
+    for (int i = 0; i < numWords; i++) {
+        free(words[i]);
+    }
+    free(words);
+    free(displace);
+    free(slots);
+    return 0;
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Read the stopword list into a new array of new strings, without duplicates;
+ * return the number of words, or minus the exit status after printing an error */
+static int read_words(FILE* fp, const char* filename, char*** words)
+{
+    int numWords = 0;
+    int capacity = 128;
+    *words = malloc(capacity * sizeof(char*));
+    char line[512];
+    int lineNumber = 0;
+
+    while (*words != NULL && fgets(line, sizeof(line), fp) != NULL) {
+        lineNumber++;
+        // Trim surrounding whitespace
+        char* word = line;
+        while (isspace((unsigned char) *word)) {
+            word++;
+        }
+        int len = strlen(word);
+        while (len > 0 && isspace((unsigned char) word[len - 1])) {
+            word[--len] = '\0';
+        }
+        if (len == 0 || word[0] == '#') {
+            continue;
+        }
+        for (int i = 0; i < len; i++) {
+            if (word[i] < 'a' || word[i] > 'z') {
+                fprintf(stderr, "Error: %s:%d: '%s' is not a lowercase word\n", filename, lineNumber, word);
+                return -2;
+            }
+        }
+        if (len > MAX_WORD_LENGTH) {
+            fprintf(stderr, "Error: %s:%d: word longer than %d letters\n", filename, lineNumber, MAX_WORD_LENGTH);
+            return -2;
+        }
+        bool duplicate = false;
+        for (int i = 0; i < numWords && !duplicate; i++) {
+            duplicate = (strcmp((*words)[i], word) == 0);
+        }
+        if (duplicate) {
+            continue;
+        }
+        if (numWords == capacity) {
+            capacity *= 2;
+            char** grown = realloc(*words, capacity * sizeof(char*));
+            if (grown == NULL) {
+                break;
+            }
+            *words = grown;
+        }
+        (*words)[numWords] = malloc(len + 1);
+        if ((*words)[numWords] == NULL) {
+            break;
+        }
+        strcpy((*words)[numWords++], word);
+    }
+    if (*words == NULL || !feof(fp)) {
+        fprintf(stderr, "Error: out of memory reading %s\n", filename);
+        return -3;
+    }
+    return numWords;
+}
+
+/* Place every word: fill slots[] with the word index in each slot (-1 if empty) and displace[]
+ * with each bucket's seed. Buckets are placed largest first, while the table is emptiest.
+ * Return false if some bucket has no displacement that fits. */
+static bool build_table(char** words, const int numWords, const int numBuckets, const int numSlots,
+                        uint16_t* displace, int* slots)
+{
+    bucket_t* buckets = calloc(numBuckets, sizeof(bucket_t));
+    int* members = malloc((numWords > 0 ? numWords : 1) * sizeof(int));
+    int* placed = malloc((numWords > 0 ? numWords : 1) * sizeof(int));
+    if (buckets == NULL || members == NULL || placed == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(3);
+    }
+
+    // Count the words of each bucket, then hand out runs of members[]
+    int* bucketOf = placed; // Reused until the words are placed
+    for (int i = 0; i < numWords; i++) {
+        bucketOf[i] = stopword_hash(words[i], strlen(words[i]), 0) % numBuckets;
+        buckets[bucketOf[i]].numWords++;
+    }
+    int start = 0;
+    for (int b = 0; b < numBuckets; b++) {
+        buckets[b].words = members + start;
+        start += buckets[b].numWords;
+        buckets[b].numWords = 0;
+    }
+    for (int i = 0; i < numWords; i++) {
+        bucket_t* bucket = &buckets[bucketOf[i]];
+        bucket->words[bucket->numWords++] = i;
+    }
+
+    // Sort bucket numbers by size, largest first
+    int* order = malloc(numBuckets * sizeof(int));
+    if (order == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(3);
+    }
+    // qsort has no context argument, so sort (size, bucket) pairs packed into one int
+    for (int b = 0; b < numBuckets; b++) {
+        order[b] = buckets[b].numWords * numBuckets + b;
+    }
+    qsort(order, numBuckets, sizeof(int), compare_buckets);
+
+    for (int s = 0; s < numSlots; s++) {
+        slots[s] = -1;
+    }
+    bool ok = true;
+    for (int k = 0; k < numBuckets && ok; k++) {
+        int b = order[k] % numBuckets;
+        bucket_t* bucket = &buckets[b];
+        if (bucket->numWords == 0) {
+            break; // The rest are empty too
+        }
+        bool fits = false;
+        for (int d = 1; d <= MAX_DISPLACEMENT && !fits; d++) {
+            fits = true;
+            int numPlaced = 0;
+            for (int j = 0; j < bucket->numWords && fits; j++) {
+                const char* word = words[bucket->words[j]];
+                int slot = stopword_hash(word, strlen(word), d) & (numSlots - 1);
+                fits = (slots[slot] == -1);
+                if (fits) {
+                    slots[slot] = bucket->words[j];
+                    placed[numPlaced++] = slot;
+                }
+            }
+            if (fits) {
+                displace[b] = d;
+            } else {
+                for (int j = 0; j < numPlaced; j++) { // Undo, and try the next displacement
+                    slots[placed[j]] = -1;
+                }
+            }
+        }
+        ok = fits;
+    }
+    free(order);
+    free(buckets);
+    free(members);
+    free(placed);
+    return ok;
+}
+
+/* qsort comparator: packed (size, bucket) ints, largest size first */
+static int compare_buckets(const void* a, const void* b)
+{
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x < y) - (x > y);
+}
+
+/* Write the table as a C header */
+static void print_table(char** words, const int numWords, const int numBuckets, const int numSlots,
+                        const uint16_t* displace, const int* slots)
+{
+    printf("/* Generated by stopgen from the stopword list; do not edit. */\n\n");
+    printf("#define STOPWORD_COUNT %d\n", numWords);
+    printf("#define STOPWORD_BUCKETS %d\n", numBuckets);
+    printf("#define STOPWORD_SLOTS %d  // a power of 2\n\n", numSlots);
+
+    printf("/* Seed of the second hash, per bucket */\n");
+    printf("static const uint16_t stopwordDisplace[STOPWORD_BUCKETS] = {");
+    for (int b = 0; b < numBuckets; b++) {
+        printf("%s%s%u", b > 0 ? "," : "", b % 16 == 0 ? "\n    " : " ", displace[b]);
+    }
+    printf("\n};\n\n");
+
+    printf("/* The stopword in each slot; NULL if empty */\n");
+    printf("static const char* const stopwordSlots[STOPWORD_SLOTS] = {");
+    for (int s = 0; s < numSlots; s++) {
+        if (slots[s] < 0) {
+            printf("%s\n    NULL", s > 0 ? "," : "");
+        } else {
+            printf("%s\n    \"%s\"", s > 0 ? "," : "", words[slots[s]]);
+        }
+    }
+    printf("\n};\n\n");
+
+    printf("/* Length of the stopword in each slot; 0 if empty */\n");
+    printf("static const unsigned char stopwordLengths[STOPWORD_SLOTS] = {");
+    for (int s = 0; s < numSlots; s++) {
+        printf("%s%s%d", s > 0 ? "," : "", s % 16 == 0 ? "\n    " : " ",
+               slots[s] < 0 ? 0 : (int) strlen(words[slots[s]]));
+    }
+    printf("\n};\n");
+}
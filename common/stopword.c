@@ -0,0 +1,31 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: stopword.c
+Description: (CS-50) Module to recognize stopwords with a perfect-hash table built from stopwords.txt.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "stopword.h"
+#include "stopword_table.h"  // generated by stopgen; see Makefile
+
+
+/*----------------------------------------------- Global Functions ----------------------------------------------------*/
+bool stopword_is(const char* word, const int len){
+    if (word == NULL || len <= 0 || STOPWORD_COUNT == 0) {
+        return false;
+    }
+    // The bucket's displacement picks the only slot the word could be in
+    uint32_t bucket = stopword_hash(word, len, 0) % STOPWORD_BUCKETS;
+    uint32_t slot = stopword_hash(word, len, stopwordDisplace[bucket]) & (STOPWORD_SLOTS - 1);
+    return stopwordLengths[slot] == len && memcmp(stopwordSlots[slot], word, len) == 0;
+}
+
+
+int stopword_count(void){
+    return STOPWORD_COUNT;
+}
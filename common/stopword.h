@@ -0,0 +1,50 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: stopword.h
+Description: header file for CS50 stopword module
+
+ * "Stopwords" are words so common that indexing them costs far more than they
+ * help a search: "the", "and", "for". The list lives in stopwords.txt; at
+ * build time stopgen turns it into a perfect-hash table (stopword_table.h),
+ * so stopword_is answers with two hashes and at most one string compare.
+ *
+ * The table uses hash-and-displace: a word's first hash picks a bucket, and
+ * the bucket's displacement is the seed of a second hash that picks the one
+ * slot the word can occupy. stopgen chooses the displacements so that no two
+ * stopwords share a slot.
+ */
+
+#ifndef __STOPWORD_H
+#define __STOPWORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************** stopword_is ****************/
+/* Tell whether a word is a stopword.
+ *
+ * Caller provides:
+ *   word - lowercase, NUL-terminated; len - its length
+ * We return:
+ *   true if the word is in the stopword list; false otherwise (or word NULL).
+ */
+bool stopword_is(const char* word, const int len);
+
+/**************** stopword_count ****************/
+/* Return the number of words in the compiled stopword list. */
+int stopword_count(void);
+
+/**************** stopword_hash ****************/
+/* 32-bit FNV-1a hash of the first len characters of word, started from seed.
+ * Shared by stopgen and stopword_is, which must agree on every slot. */
+static inline uint32_t stopword_hash(const char* word, const int len, const uint32_t seed){
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (int i = 0; i < len; i++) {
+        hash ^= (unsigned char) word[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+#endif // __STOPWORD_H
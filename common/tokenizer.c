@@ -0,0 +1,469 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: tokenizer.c
+Description: (CS-50) Module to split webpages into words, 64 bytes of HTML at a time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "tokenizer.h"
+#include "mem.h"
+#include "webpage.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define TOKENIZER_X86 1
+#endif
+
+/*------------------------------------------------- Local Types ------------------------------------------------------*/
+#define TOKENIZER_BLOCK 64             // bytes of HTML classified at once, one bit each in a uint64_t
+static const int TOKENIZER_BATCH = 256; // words per batch
+
+/* What batch_find looks for; the end of the HTML always matches */
+enum {
+    FIND_LETTER = 1,
+    FIND_NONLETTER = 2,
+    FIND_OPEN = 4,   // '<'
+    FIND_CLOSE = 8   // '>'
+};
+
+/* One word of a batch */
+typedef struct tokenizer_span {
+    size_t offset;  // of the word in the tokenizer's text
+    int len;
+    int position;   // of the word among every word of the page
+    unsigned int fields; // TOKENIZER_TITLE, ... it is in
+    size_t anchor;  // with TOKENIZER_ANCHOR, the offset of its link's tag in the HTML
+    int anchorLen;
+} tokenizer_span_t;
+
+/* Classify 64 bytes: set bit i of masks[0] if in[i] is a letter, of masks[1] if '<', of masks[2] if '>',
+ * and store in[i] with letters lowercased into lower[i] */
+typedef void (*classify_fn)(const char* in, char* lower, uint64_t masks[3]);
+
+/*------------------------------------------------- Global Types -----------------------------------------------------*/
+typedef struct tokenizer {
+    int minLength;             // shorter words are skipped without being copied
+    bool lowercase;            // fold A-Z to a-z
+    bool (*isStopword)(const char* word, const int len); // words to skip; NULL for none
+
+    const char* html;          // page being read
+    size_t length;             // strlen(html)
+    size_t pos;                // where the next batch resumes
+    bool done;                 // no more words on the page
+    int position;              // words of the page found so far, skipped ones included
+    unsigned int fields;       // fields the text at pos is in
+    size_t anchor;             // with TOKENIZER_ANCHOR, where the open link's tag starts
+    int anchorLen;             // and how long it is
+
+    size_t block;              // offset of the classified block
+    uint64_t letters;          // bit i: html[block + i] is a letter
+    uint64_t opens;            // ... is '<'
+    uint64_t closes;           // ... is '>'
+    uint64_t ends;             // ... is the terminating NUL
+    char lower[TOKENIZER_BLOCK]; // html[block..] with letters lowercased
+
+    tokenizer_span_t* spans;   // words of the current batch
+    int numWords;
+    char* text;                // the batch's words, NUL-terminated, back to back
+    size_t textUsed;
+    size_t textSize;
+} tokenizer_t;
+
+/*------------------------------------------------- Local Functions --------------------------------------------------*/
+static void choose_classify(void);
+static void classify_scalar(const char* in, char* lower, uint64_t masks[3]);
+#ifdef TOKENIZER_X86
+static void classify_sse2(const char* in, char* lower, uint64_t masks[3]);
+static void classify_avx2(const char* in, char* lower, uint64_t masks[3]);
+#endif
+static void batch_classify(tokenizer_t* tokenizer, const size_t block);
+static size_t batch_find(tokenizer_t* tokenizer, size_t pos, const int classes);
+static bool batch_copyWord(tokenizer_t* tokenizer, size_t pos, const size_t end);
+static void tag_fields(tokenizer_t* tokenizer, const size_t pos, const size_t close);
+
+/*------------------------------------------------- Local Variables --------------------------------------------------*/
+static pthread_once_t classifyOnce = PTHREAD_ONCE_INIT;
+static classify_fn classify = classify_scalar;
+static const char* classifyName = "scalar";
+
+
+/*----------------------------------------------- Global Functions ----------------------------------------------------*/
+tokenizer_t* tokenizer_new(const int minLength, const bool lowercase,
+                           bool (*isStopword)(const char* word, const int len)){
+    pthread_once(&classifyOnce, choose_classify);
+    tokenizer_t* tokenizer = mem_malloc(sizeof(tokenizer_t));
+    if (tokenizer == NULL) {
+        return NULL;
+    }
+    tokenizer->minLength = minLength > 1 ? minLength : 1;
+    tokenizer->lowercase = lowercase;
+    tokenizer->isStopword = isStopword;
+    tokenizer->spans = malloc(TOKENIZER_BATCH * sizeof(tokenizer_span_t));
+    tokenizer->textSize = 4096;
+    tokenizer->text = malloc(tokenizer->textSize);
+    if (tokenizer->spans == NULL || tokenizer->text == NULL) {
+        free(tokenizer->spans);
+        free(tokenizer->text);
+        mem_free(tokenizer);
+        return NULL;
+    }
+    tokenizer_start(tokenizer, NULL);
+    return tokenizer;
+}
+
+
+void tokenizer_start(tokenizer_t* tokenizer, const webpage_t* page){
+    if (tokenizer == NULL) {
+        return;
+    }
+    const char* html = page == NULL ? NULL : webpage_getHTML(page);
+    tokenizer->html = html == NULL ? "" : html;
+    tokenizer->length = strlen(tokenizer->html);
+    tokenizer->pos = 0;
+    tokenizer->done = (tokenizer->length == 0);
+    tokenizer->position = 0;
+    tokenizer->fields = 0;
+    tokenizer->anchor = 0;
+    tokenizer->anchorLen = 0;
+    tokenizer->block = tokenizer->length; // An empty block holding just the NUL
+    tokenizer->letters = 0;
+    tokenizer->opens = 0;
+    tokenizer->closes = 0;
+    tokenizer->ends = 1;
+    tokenizer->numWords = 0;
+    tokenizer->textUsed = 0;
+}
+
+
+int tokenizer_next(tokenizer_t* tokenizer){
+    if (tokenizer == NULL) {
+        return 0;
+    }
+    tokenizer->numWords = 0;
+    tokenizer->textUsed = 0;
+
+    // Same steps as webpage_getNextWord, each one a search for the next byte of some classes
+    while (!tokenizer->done && tokenizer->numWords < TOKENIZER_BATCH) {
+        // Skip anything that isn't a letter, and whole <...> tags
+        size_t pos = batch_find(tokenizer, tokenizer->pos, FIND_LETTER | FIND_OPEN);
+        if (pos == tokenizer->length) {
+            tokenizer->done = true;
+            break;
+        }
+        if (tokenizer->html[pos] == '<') {
+            size_t close = batch_find(tokenizer, pos, FIND_CLOSE);
+            if (close == tokenizer->length || close + 1 == tokenizer->length) { // Ran out of html
+                tokenizer->done = true;
+                break;
+            }
+            tag_fields(tokenizer, pos, close);
+            tokenizer->pos = close + 1;
+            continue;
+        }
+
+        // Find the end of the word; words too short are skipped before they are copied
+        size_t end = batch_find(tokenizer, pos, FIND_NONLETTER);
+        tokenizer->pos = end;
+        int len = end - pos;
+        int position = tokenizer->position++;
+        if (len < tokenizer->minLength) {
+            continue;
+        }
+
+        // Copy the word (folded) to the end of the batch, then keep it unless it is a stopword
+        if (!batch_copyWord(tokenizer, pos, end)) {
+            return -1;
+        }
+        char* word = tokenizer->text + tokenizer->textUsed;
+        word[len] = '\0';
+        if (tokenizer->isStopword != NULL && (*tokenizer->isStopword)(word, len)) {
+            continue;
+        }
+        tokenizer->spans[tokenizer->numWords].offset = tokenizer->textUsed;
+        tokenizer->spans[tokenizer->numWords].len = len;
+        tokenizer->spans[tokenizer->numWords].position = position;
+        tokenizer->spans[tokenizer->numWords].fields = tokenizer->fields;
+        tokenizer->spans[tokenizer->numWords].anchor = tokenizer->anchor;
+        tokenizer->spans[tokenizer->numWords].anchorLen = tokenizer->anchorLen;
+        tokenizer->numWords++;
+        tokenizer->textUsed += len + 1;
+    }
+    return tokenizer->numWords;
+}
+
+
+const char* tokenizer_word(const tokenizer_t* tokenizer, const int i, int* len){
+    if (tokenizer == NULL || i < 0 || i >= tokenizer->numWords) {
+        return NULL;
+    }
+    if (len != NULL) {
+        *len = tokenizer->spans[i].len;
+    }
+    return tokenizer->text + tokenizer->spans[i].offset;
+}
+
+
+int tokenizer_position(const tokenizer_t* tokenizer, const int i){
+    if (tokenizer == NULL || i < 0 || i >= tokenizer->numWords) {
+        return -1;
+    }
+    return tokenizer->spans[i].position;
+}
+
+
+unsigned int tokenizer_fields(const tokenizer_t* tokenizer, const int i){
+    if (tokenizer == NULL || i < 0 || i >= tokenizer->numWords) {
+        return 0;
+    }
+    return tokenizer->spans[i].fields;
+}
+
+
+const char* tokenizer_anchor(const tokenizer_t* tokenizer, const int i, int* len){
+    if (tokenizer == NULL || i < 0 || i >= tokenizer->numWords
+        || (tokenizer->spans[i].fields & TOKENIZER_ANCHOR) == 0) {
+        return NULL;
+    }
+    if (len != NULL) {
+        *len = tokenizer->spans[i].anchorLen;
+    }
+    return tokenizer->html + tokenizer->spans[i].anchor;
+}
+
+
+size_t tokenizer_memory(const tokenizer_t* tokenizer){
+    if (tokenizer == NULL) {
+        return 0;
+    }
+    return sizeof(tokenizer_t) + TOKENIZER_BATCH * sizeof(tokenizer_span_t) + tokenizer->textSize;
+}
+
+
+const char* tokenizer_simd(void){
+    pthread_once(&classifyOnce, choose_classify);
+    return classifyName;
+}
+
+
+void tokenizer_delete(tokenizer_t* tokenizer){
+    if (tokenizer != NULL) {
+        free(tokenizer->spans);
+        free(tokenizer->text);
+        mem_free(tokenizer);
+    }
+}
+
+
+/* ----------------------------------------- Local Helper functions --------------------------------------------------*/
+/* Pick the widest classifier the CPU supports, unless TSE_TOKENIZER asks for a narrower one */
+static void choose_classify(void){
+    const char* wanted = getenv("TSE_TOKENIZER");
+    if (wanted != NULL && strcmp(wanted, "scalar") == 0) {
+        return;
+    }
+#ifdef TOKENIZER_X86
+    classify = classify_sse2;
+    classifyName = "sse2";
+    if (wanted != NULL && strcmp(wanted, "sse2") == 0) {
+        return;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify = classify_avx2;
+        classifyName = "avx2";
+    }
+#endif
+}
+
+/* Portable classifier, one byte at a time. Only ASCII letters count, as isalpha in the C locale. */
+static void classify_scalar(const char* in, char* lower, uint64_t masks[3]){
+    uint64_t letters = 0;
+    uint64_t opens = 0;
+    uint64_t closes = 0;
+    for (int i = 0; i < TOKENIZER_BLOCK; i++) {
+        unsigned char c = in[i];
+        bool letter = (unsigned char) ((c | 0x20) - 'a') < 26;
+        lower[i] = letter ? (c | 0x20) : c;
+        letters |= (uint64_t) letter << i;
+        opens |= (uint64_t) (c == '<') << i;
+        closes |= (uint64_t) (c == '>') << i;
+    }
+    masks[0] = letters;
+    masks[1] = opens;
+    masks[2] = closes;
+}
+
+#ifdef TOKENIZER_X86
+/* SSE2 classifier, 16 bytes per compare. Setting bit 0x20 folds a letter to lowercase; adding
+ * 128 - 'a' then moves 'a'..'z' (and only those) to the 26 smallest signed bytes. */
+static void classify_sse2(const char* in, char* lower, uint64_t masks[3]){
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i toSigned = _mm_set1_epi8(128 - 'a');
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    uint64_t letters = 0;
+    uint64_t opens = 0;
+    uint64_t closes = 0;
+    for (int i = 0; i < TOKENIZER_BLOCK; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (in + i));
+        __m128i shifted = _mm_add_epi8(_mm_or_si128(bytes, caseBit), toSigned);
+        __m128i isLetter = _mm_cmplt_epi8(shifted, limit);
+        _mm_storeu_si128((__m128i*) (lower + i), _mm_or_si128(bytes, _mm_and_si128(isLetter, caseBit)));
+        letters |= (uint64_t) (uint16_t) _mm_movemask_epi8(isLetter) << i;
+        opens |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('<'))) << i;
+        closes |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('>'))) << i;
+    }
+    masks[0] = letters;
+    masks[1] = opens;
+    masks[2] = closes;
+}
+
+/* AVX2 classifier: classify_sse2 with 32 bytes per compare. Only called if the CPU has AVX2. */
+__attribute__((target("avx2")))
+static void classify_avx2(const char* in, char* lower, uint64_t masks[3]){
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i toSigned = _mm256_set1_epi8(128 - 'a');
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    uint64_t letters = 0;
+    uint64_t opens = 0;
+    uint64_t closes = 0;
+    for (int i = 0; i < TOKENIZER_BLOCK; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*) (in + i));
+        __m256i shifted = _mm256_add_epi8(_mm256_or_si256(bytes, caseBit), toSigned);
+        __m256i isLetter = _mm256_cmpgt_epi8(limit, shifted);
+        _mm256_storeu_si256((__m256i*) (lower + i), _mm256_or_si256(bytes, _mm256_and_si256(isLetter, caseBit)));
+        letters |= (uint64_t) (uint32_t) _mm256_movemask_epi8(isLetter) << i;
+        opens |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('<'))) << i;
+        closes |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('>'))) << i;
+    }
+    masks[0] = letters;
+    masks[1] = opens;
+    masks[2] = closes;
+}
+#endif
+
+/* Classify the 64 bytes of the page starting at offset block. The last block of a page is copied
+ * into a zeroed buffer first, so we never read past the NUL. */
+static void batch_classify(tokenizer_t* tokenizer, const size_t block){
+    const char* in = tokenizer->html + block;
+    char padded[TOKENIZER_BLOCK];
+    uint64_t ends = 0;
+    size_t left = tokenizer->length - block;
+    if (left < TOKENIZER_BLOCK) {
+        memset(padded, 0, TOKENIZER_BLOCK);
+        memcpy(padded, in, left);
+        in = padded;
+        ends = (uint64_t) 1 << left;
+    }
+    uint64_t masks[3];
+    (*classify)(in, tokenizer->lower, masks);
+    tokenizer->block = block;
+    tokenizer->letters = masks[0];
+    tokenizer->opens = masks[1];
+    tokenizer->closes = masks[2];
+    tokenizer->ends = ends;
+}
+
+/* Return the offset of the first byte at or after pos in one of the classes; the page's length if none */
+static size_t batch_find(tokenizer_t* tokenizer, size_t pos, const int classes){
+    while (true) {
+        if (pos < tokenizer->block || pos >= tokenizer->block + TOKENIZER_BLOCK) {
+            batch_classify(tokenizer, pos);
+        }
+        uint64_t wanted = tokenizer->ends;
+        if (classes & FIND_LETTER) {
+            wanted |= tokenizer->letters;
+        }
+        if (classes & FIND_NONLETTER) {
+            wanted |= ~tokenizer->letters;
+        }
+        if (classes & FIND_OPEN) {
+            wanted |= tokenizer->opens;
+        }
+        if (classes & FIND_CLOSE) {
+            wanted |= tokenizer->closes;
+        }
+        wanted &= ~(uint64_t) 0 << (pos - tokenizer->block);
+        if (wanted != 0) {
+            return tokenizer->block + __builtin_ctzll(wanted);
+        }
+        pos = tokenizer->block + TOKENIZER_BLOCK;
+    }
+}
+
+/* Note the fields the text after the tag html[pos..close] is in: <title>, <h1> to <h6> and <a ...> open
+ * theirs, and the closing tag of each closes it. Other tags, and names that merely start the same
+ * (<abbr>, <head>), change nothing */
+static void tag_fields(tokenizer_t* tokenizer, const size_t pos, const size_t close){
+    const char* name = tokenizer->html + pos + 1;
+    bool closing = (*name == '/');
+    name += closing;
+    size_t len = 0;
+    while (name + len < tokenizer->html + close
+           && ((unsigned char) ((name[len] | 0x20) - 'a') < 26 || (name[len] >= '0' && name[len] <= '9'))) {
+        len++;
+    }
+    unsigned int field = 0;
+    if (len == 1 && (name[0] | 0x20) == 'a') {
+        field = TOKENIZER_ANCHOR;
+    } else if (len == 2 && (name[0] | 0x20) == 'h' && name[1] >= '1' && name[1] <= '6') {
+        field = TOKENIZER_HEADING;
+    } else if (len == 5) {
+        field = TOKENIZER_TITLE;
+        for (size_t j = 0; j < len; j++) {
+            if ((name[j] | 0x20) != "title"[j]) {
+                field = 0;
+            }
+        }
+    }
+    if (closing) {
+        tokenizer->fields &= ~field;
+    } else {
+        tokenizer->fields |= field;
+    }
+    if (field == TOKENIZER_ANCHOR && !closing) {
+        tokenizer->anchor = pos;
+        tokenizer->anchorLen = close - pos + 1;
+    }
+}
+
+/* Append html[pos..end), a run of letters, to the batch's text (without a NUL), folding it to
+ * lowercase if asked; return false if out of memory */
+static bool batch_copyWord(tokenizer_t* tokenizer, size_t pos, const size_t end){
+    size_t used = tokenizer->textUsed;
+    size_t len = end - pos;
+    if (used + len + 1 > tokenizer->textSize) {
+        size_t textSize = tokenizer->textSize * 2;
+        while (textSize < used + len + 1) {
+            textSize *= 2;
+        }
+        char* text = realloc(tokenizer->text, textSize);
+        if (text == NULL) {
+            return false;
+        }
+        tokenizer->text = text;
+        tokenizer->textSize = textSize;
+    }
+    if (!tokenizer->lowercase) {
+        memcpy(tokenizer->text + used, tokenizer->html + pos, len);
+        return true;
+    }
+
+    // Copy from the lowercased blocks; the block batch_find stopped in usually holds the whole word
+    while (pos < end) {
+        if (pos < tokenizer->block || pos >= tokenizer->block + TOKENIZER_BLOCK) {
+            batch_classify(tokenizer, pos);
+        }
+        size_t blockEnd = tokenizer->block + TOKENIZER_BLOCK;
+        size_t stop = end < blockEnd ? end : blockEnd;
+        memcpy(tokenizer->text + used, tokenizer->lower + (pos - tokenizer->block), stop - pos);
+        used += stop - pos;
+        pos = stop;
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: tokenizer.h
+Description: header file for CS50 tokenizer module
+
+ * A "tokenizer" splits the HTML of a webpage into words: runs of letters
+ * outside <...> tags. It finds exactly the words webpage_getNextWord finds,
+ * but classifies 64 bytes of HTML at a time with SIMD compares (AVX2 or
+ * SSE2, chosen when first used; plain C elsewhere), lowercasing letters in
+ * the same pass. Filtering happens inside that scan too: words shorter than
+ * a minimum length are skipped without being copied, and stopwords are
+ * dropped before the caller sees them. Words come out in batches: spans of
+ * a buffer owned by the tokenizer, so no memory is allocated per word.
+ *
+ * The tags it skips still tell it which fields of the page a word is in:
+ * the title, a heading (<h1> to <h6>) or the text of a link (<a ...>), each
+ * from its tag to the matching closing tag. A word in none of them is body
+ * text; every word is body text to webpage_getNextWord.
+ *
+ * The environment variable TSE_TOKENIZER=scalar|sse2|avx2 forces a narrower
+ * implementation than the CPU supports, for testing.
+ */
+
+#ifndef __TOKENIZER_H
+#define __TOKENIZER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "webpage.h"  // for webpage_t type
+
+/**************** global types ****************/
+typedef struct tokenizer tokenizer_t;  // opaque to users of the module
+
+/* Fields a word can be in, as bits of tokenizer_fields */
+#define TOKENIZER_TITLE 0x1u    // between <title> and </title>
+#define TOKENIZER_HEADING 0x2u  // between <h1> and </h1>, ... <h6> and </h6>
+#define TOKENIZER_ANCHOR 0x4u   // between <a ...> and </a>
+
+/**************** tokenizer_new ****************/
+/* Create a new tokenizer.
+ *
+ * Caller provides:
+ *   minLength  - shortest word to return (the indexer uses 3; values < 1 mean 1)
+ *   lowercase  - true to fold words to lowercase, as word_normalize does
+ *   isStopword - function telling whether a word (already folded, len letters,
+ *                NUL-terminated) should be dropped; NULL to keep every word
+ * We return:
+ *   pointer to a new tokenizer; NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling tokenizer_delete().
+ */
+tokenizer_t* tokenizer_new(const int minLength, const bool lowercase,
+                           bool (*isStopword)(const char* word, const int len));
+
+/**************** tokenizer_start ****************/
+/* Start reading the words of a webpage.
+ *
+ * Caller provides:
+ *   valid tokenizer, webpage whose HTML stays unchanged until the last
+ *   tokenizer_next (a NULL page or HTML has no words)
+ */
+void tokenizer_start(tokenizer_t* tokenizer, const webpage_t* page);
+
+/**************** tokenizer_next ****************/
+/* Read the next batch of words of the page.
+ *
+ * We return:
+ *   number of words in the batch; 0 when the page has no more; -1 if out of memory.
+ * Notes:
+ *   each batch replaces the previous one; get its words with tokenizer_word.
+ */
+int tokenizer_next(tokenizer_t* tokenizer);
+
+/**************** tokenizer_word ****************/
+/* Return word i (0 <= i < batch size) of the current batch.
+ *
+ * We return:
+ *   the word, lowercase and NUL-terminated, with its length in *len;
+ *   NULL if i is out of range. The word is valid until the next tokenizer_next.
+ */
+const char* tokenizer_word(const tokenizer_t* tokenizer, const int i, int* len);
+
+/**************** tokenizer_position ****************/
+/* Return the position of word i of the current batch on its page: how many
+ * words come before it, counting the ones skipped as too short or stopwords,
+ * so words next to each other in the text have positions one apart. -1 if i
+ * is out of range. */
+int tokenizer_position(const tokenizer_t* tokenizer, const int i);
+
+/**************** tokenizer_fields ****************/
+/* Return the fields word i of the current batch is in: TOKENIZER_TITLE,
+ * TOKENIZER_HEADING and TOKENIZER_ANCHOR or'd together; 0 for body text,
+ * or if i is out of range. */
+unsigned int tokenizer_fields(const tokenizer_t* tokenizer, const int i);
+
+/**************** tokenizer_anchor ****************/
+/* Return the <a ...> tag of the link word i of the current batch is the
+ * text of, len bytes long from '<' to '>' in the page's HTML (so it stays
+ * valid while the page does); NULL if the word is not in a link, or i is
+ * out of range. Words of the same link return the same pointer. */
+const char* tokenizer_anchor(const tokenizer_t* tokenizer, const int i, int* len);
+
+/**************** tokenizer_memory ****************/
+/* Return the number of bytes of heap the tokenizer occupies. */
+size_t tokenizer_memory(const tokenizer_t* tokenizer);
+
+/**************** tokenizer_simd ****************/
+/* Return the name of the implementation in use: "avx2", "sse2" or "scalar". */
+const char* tokenizer_simd(void);
+
+/**************** tokenizer_delete ****************/
+/* Free the tokenizer. We ignore a NULL tokenizer. */
+void tokenizer_delete(tokenizer_t* tokenizer);
+
+#endif // __TOKENIZER_H
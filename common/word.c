@@ -9,6 +9,9 @@ Description: (CS-50) Module to implement functions for normalizing strings (word
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include "word.h"
+#include "webpage.h"
 
 
 bool word_normalize(char* word){
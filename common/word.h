@@ -9,6 +9,7 @@ Description: header file for CS50 index module
 #define __WORD_H
 #include <stdio.h>
 #include <stdbool.h>
+#include "webpage.h"  // for webpage_t type
 
 /**************** word_normalize ****************/
 /* Normalize a word by converting it to all lowercase.
@@ -19,6 +19,7 @@ Description: A module for a Tiny Search Engine Crawler
 #include "hashtable.h"
 #include "webpage.h"
 #include "common/pagedir.h"
+#include "common/manifest.h"
 
 /* Local functions */
 static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth);
@@ -79,6 +80,8 @@ static void crawl(char* seedURL, char* pageDirectory, const int maxDepth) {
     // Initialize data structures
     hashtable_t* pagesSeen = hashtable_new(200);
     bag_t* pagesToCrawl = bag_new();
+    manifest_t* manifest = mem_assert(manifest_new(), "manifest");
+    pagedir_writer_t* writer = mem_assert(pagedir_writer_new(pageDirectory, 64, 32), "page writer"); // Saves pages in the background
     int docID = 1;
     
     hashtable_insert(pagesSeen, seedURL, ""); // Add seedURL to hashtable
@@ -89,7 +92,14 @@ static void crawl(char* seedURL, char* pageDirectory, const int maxDepth) {
     webpage_t* page;
     while ((page = bag_extract(pagesToCrawl)) != NULL) {
         if (webpage_fetch(page)) { // Fetch the page HTML code using the webpage module
-            pagedir_save(page, pageDirectory, docID++); // Save page to directory
+            if (!pagedir_writer_save(writer, page, docID)) { // Queue page to be saved to directory
+                fprintf(stderr, "Error: unable to save document %d to '%s'\n", docID, pageDirectory);
+                exit(5);
+            }
+            if (!manifest_add(manifest, page, docID)) { // Record it in the manifest
+                fprintf(stderr, "Error: unable to add document %d to the manifest\n", docID);
+            }
+            docID++;
             
             // If not too deep, scan for more URLs
             if (webpage_getDepth(page) < maxDepth) {
@@ -99,7 +109,19 @@ static void crawl(char* seedURL, char* pageDirectory, const int maxDepth) {
         webpage_delete(page); // Clear allocated memory for the webpage
     }
     
+    // Wait for every queued page to reach the disk before describing them in the manifest
+    if (!pagedir_writer_close(writer)) {
+        fprintf(stderr, "Error: unable to save pages to '%s'\n", pageDirectory);
+        exit(5);
+    }
+
+    // Write pageDirectory/.manifest so indexers know exactly which documents exist
+    if (!manifest_save(manifest, pageDirectory)) {
+        fprintf(stderr, "Error: unable to write manifest to '%s'\n", pageDirectory);
+    }
+
     // Free allocated memory for each structure
+    manifest_delete(manifest);
     hashtable_delete(pagesSeen, NULL);
     bag_delete(pagesToCrawl, NULL);
 }
@@ -6,24 +6,95 @@ Description: This file contains the main function for the indexer program.
 The indexer program reads in a file of URLs and indexes the words in the URLs. The program then writes the index to a file.
 */
 
+#define _POSIX_C_SOURCE 200809L  // for getopt
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "hashtable.h"
+#include <stdbool.h>
+#include <unistd.h>
 #include "common/index.h"
+#include "common/indexfile.h"
 #include "common/pagedir.h"
+#include "common/spimi.h"
+#include "common/segment.h"
+#include "common/shard.h"
 
 
+static const char* USAGE = "Usage: %s [-b [-p] [-f]] [-j threads] [-s shards | -t shards | -m megabytes | -u | -c] pageDirectory indexFilename\n";
+
 
 int main(int argc, char *argv[]) {
+    int numThreads = 1; // -j: number of threads used to build the index
+    long memoryMB = 0;  // -m: build in bounded memory (SPIMI) with this many megabytes per block
+    bool update = false;  // -u: index only new/changed documents into a delta segment
+    bool compact = false; // -c: merge the index's delta segments into its base
+    bool binary = false;  // -b: write the binary index format, which the querier maps instead of parsing
+    int numShards = 0;    // -s: split the index by docID range into this many shards
+    bool byTerm = false;  // -t: split it by term instead
+    bool positions = false; // -p: keep each word's positions, for phrase and near queries (binary only)
+    bool fields = false;    // -f: keep words' counts in titles, headings and link text, for querier -f (binary only)
+
+    // Parse options
+    int opt;
+    while ((opt = getopt(argc, argv, "bpfj:m:ucs:t:")) != -1) {
+        switch (opt) {
+            case 'j':
+                numThreads = atoi(optarg);
+                if (numThreads < 1) {
+                    fprintf(stderr, "Error: number of threads must be at least 1\n");
+                    return 1;
+                }
+                break;
+            case 'm':
+                memoryMB = atol(optarg);
+                if (memoryMB < 1) {
+                    fprintf(stderr, "Error: memory budget must be at least 1 megabyte\n");
+                    return 1;
+                }
+                break;
+            case 's':
+            case 't':
+                if (numShards > 0) {
+                    fprintf(stderr, "Error: -s and -t cannot be used together\n");
+                    return 1;
+                }
+                byTerm = (opt == 't');
+                numShards = atoi(optarg);
+                if (numShards < 1) {
+                    fprintf(stderr, "Error: number of shards must be at least 1\n");
+                    return 1;
+                }
+                break;
+            case 'b':
+                binary = true;
+                break;
+            case 'p':
+                positions = true;
+                break;
+            case 'f':
+                fields = true;
+                break;
+            case 'u':
+                update = true;
+                break;
+            case 'c':
+                compact = true;
+                break;
+            default:
+                fprintf(stderr, USAGE, argv[0]);
+                return 1;
+        }
+    }
+
     // Check for correct number of arguments
-    if (argc != 3) {
-        fprintf(stderr, "Incorrect number of arguments -> Usage: %s inverted-index-file output-file\n", argv[0]);
+    if (argc - optind != 2) {
+        fprintf(stderr, "Incorrect number of arguments -> ");
+        fprintf(stderr, USAGE, argv[0]);
         return 1; // Exit status 1 for issues with number of arguments
     }
 
-    char* pageDirectory = argv[1];
-    char* indexFilename = argv[2];
+    char* pageDirectory = argv[optind];
+    char* indexFilename = argv[optind + 1];
 
     // Validate pageDirectory (must exist and is crawler generated)
     if (!is_crawler_directory(pageDirectory)) {
@@ -31,14 +102,85 @@ int main(int argc, char *argv[]) {
         return 2; // Exit status 2 for issues with pageDirectory/.crawler
     }
 
+    // Only the binary format holds positions, and only full builds keep them
+    if (positions && (!binary || memoryMB > 0 || update || compact)) {
+        fprintf(stderr, "Error: -p needs -b, and cannot be used with -m, -u or -c\n");
+        return 1;
+    }
+    if (fields && (!binary || memoryMB > 0 || update || compact)) { // Likewise field postings
+        fprintf(stderr, "Error: -f needs -b, and cannot be used with -m, -u or -c\n");
+        return 1;
+    }
+
+    // Incremental modes work on an existing index and its segments
+    if (update || compact) {
+        if (numShards > 0 || shard_is(indexFilename)) {
+            fprintf(stderr, "Error: -u and -c do not apply to sharded indexes; rebuild with -s or -t instead\n");
+            return 1;
+        }
+        if (update && compact) {
+            fprintf(stderr, "Error: -u and -c cannot be used together\n");
+            return 1;
+        }
+        // Deltas and compaction carry only postings: refuse rather than silently drop positions or fields
+        indexfile_t* base = indexfile_is(indexFilename) ? indexfile_open(indexFilename) : NULL;
+        uint32_t flags = (base != NULL) ? indexfile_flags(base) : 0;
+        indexfile_close(base);
+        if ((flags & INDEXFILE_POSITIONS) != 0) {
+            fprintf(stderr, "Error: %s keeps positions (-p), which -u and -c would drop; rebuild it with -b -p instead\n",
+                    indexFilename);
+            return 1;
+        }
+        if ((flags & INDEXFILE_FIELDS) != 0) {
+            fprintf(stderr, "Error: %s keeps fields (-f), which -u and -c would drop; rebuild it with -b -f instead\n",
+                    indexFilename);
+            return 1;
+        }
+        if (numThreads > 1 || memoryMB > 0 || binary) {
+            fprintf(stderr, "Error: -j, -m and -b only apply to full builds (compaction keeps the base's format)\n");
+            return 1;
+        }
+        if (compact) {
+            return segment_compact(indexFilename) ? 0 : 4; // segment_compact printed the error
+        }
+        int numChanged = segment_update(pageDirectory, indexFilename);
+        if (numChanged < 0) {
+            return 4; // segment_update printed the error
+        }
+        printf("%d documents added, changed or deleted\n", numChanged);
+        return 0;
+    }
+
+    // With a memory budget, index straight to indexFilename through sorted runs on disk
+    if (memoryMB > 0) {
+        if (numThreads > 1 || numShards > 0) {
+            fprintf(stderr, "Error: -m cannot be used with -j, -s or -t\n");
+            return 1;
+        }
+        if (!spimi_build(pageDirectory, indexFilename, (size_t) memoryMB * 1024 * 1024, binary)) {
+            return 4; // spimi_build printed the error
+        }
+        return segment_reset(pageDirectory, indexFilename) ? 0 : 4;
+    }
+
     // Build the index from files in pageDirectory
-    hashtable_t* index = indexBuild(pageDirectory); // indexBuild will have printed the error statements
+    index_t* index = fields ? indexBuild_fields(pageDirectory, numThreads, positions)
+                     : positions ? indexBuild_positional(pageDirectory, numThreads)
+                     : indexBuild_parallel(pageDirectory, numThreads); // indexBuild will have printed the error statements
     if (index == NULL){
         return 3; // Exit status 3 for issues reading files from pageDirectory
     }
 
+    // Split the index into shards, by docID range or by term, with indexFilename listing them
+    if (numShards > 0) {
+        bool ok = byTerm ? shard_writeTerms(index, indexFilename, numShards, binary)
+                         : shard_write(index, indexFilename, numShards, binary); // Either printed any error
+        index_delete(index);
+        return ok ? 0 : 4;
+    }
+
     // Save the index to indexFilename
-    if (!saveIndex_toPage(index, indexFilename)) {
+    if (!(binary ? saveIndex_toBinary(index, indexFilename) : saveIndex_toPage(index, indexFilename))) {
         fprintf(stderr, "Error: unable to write index to '%s' for writing\n", indexFilename);
         index_delete(index);
         return 4; // Exit status 4 for issues with indexFilename
@@ -46,5 +188,10 @@ int main(int argc, char *argv[]) {
 
     // Clean up
     index_delete(index);
+
+    // Record what the new base holds, so later runs can update it incrementally
+    if (!segment_reset(pageDirectory, indexFilename)) {
+        return 4;
+    }
     return 0; // Exit status 0 for no issues
 }
\ No newline at end of file
@@ -6,7 +6,8 @@ Description:
  * The indextest program loads an index file created by the indexer,
  * rebuilds the index data structure, and writes it to a new file.
  * This serves as both a test of the indexer's file format and the
- * index save/load functionality.
+ * index save/load functionality. A binary index (indexer -b) is mapped
+ * rather than loaded, so its copy is the text index it stands for.
  */
 
  #define _GNU_SOURCE
@@ -14,10 +15,10 @@ Description:
  #include <stdlib.h>
  #include <string.h>
  #include "common/index.h"
+ #include "common/indexfile.h"
  #include "common/pagedir.h"
  #include "common/word.h"
- #include "hashtable.h"
- #include "file.h"
+  #include "file.h"
  #include "common/index.h"
  
  
@@ -41,7 +42,7 @@ Description:
      }
  
      // Load the index from the old file
-     hashtable_t* index = load_index(oldFile, 500);
+     index_t* index = indexfile_is(oldIndexFilename) ? index_map(oldIndexFilename) : load_index(oldFile, 500);
      fclose(oldFile);
      
      if (index == NULL) {
@@ -78,7 +79,7 @@ Description:
   * where word is a string of lowercase letters and docID and count are positive integers.
   * 
   * We return:
-  *   A pointer to a new hashtable containing the index;
+  *   A pointer to a new index;
   *   NULL on error
   */
  
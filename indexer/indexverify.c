@@ -0,0 +1,543 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: indexverify.c
+Description:
+ * The indexverify program checks index files without loading them, so an
+ * index can be vetted before a querier is pointed at it. A binary index
+ * (indexer -b) has every chunk checked against its CRC-32C, the chunks
+ * split among threads; with -f, every word and posting (and, in a file
+ * built with indexer -p, every position, and with indexer -f, every field
+ * posting) is decoded and checked too. A text index is parsed in parts, one
+ * thread each: every line must be "word docID count [docID count]..." with
+ * positive counts, and the file must end with a whole line. Words out of
+ * order and docIDs not increasing, which index_load accepts, are counted
+ * and warned about; with -s (strict) they make the file damaged. Given a
+ * shard list (indexer -s or -t), it checks every shard; given an index with
+ * delta segments, the deltas too.
+ */
+
+ #define _POSIX_C_SOURCE 200809L  // for getopt, clock_gettime and mmap
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdbool.h>
+ #include <stdint.h>
+ #include <limits.h>
+ #include <time.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <pthread.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include "common/indexfile.h"
+ #include "common/shard.h"
+
+
+ static const char* USAGE = "Usage: %s [-f] [-s] [-j threads] indexFilename...\n";
+
+ /* One thread's share of the checking of a file */
+ typedef struct verify_part {
+     const indexfile_t* file;    // a binary file: its chunks first to end, or its words
+     uint64_t first;
+     uint64_t end;
+     uint64_t numBad;            // damaged chunks, or words that don't decode
+     uint64_t firstBad;          // file offset of the first damaged chunk, or number of the first bad word
+     uint64_t numPostings;
+     char* word;                 // the word before, while decoding words
+     bool haveWord;
+     int* positions;             // room for a posting's positions, while decoding words
+     int capacity;
+     const char* text;           // a text file: its lines in this part
+     size_t length;
+     long numLines;              // lines checked before the first bad one (all of them if none)
+     const char* error;          // what is wrong with the first bad line; NULL if none
+     long numUnordered;          // lines out of order (word or docIDs), which index_load accepts
+     long firstUnordered;        // the first of them, counted from the part's first line (0)
+     const char* unordered;      // and what is out of order there
+     const char* firstWord;      // the part's first and last words, to check order across parts
+     size_t firstLength;
+     const char* lastWord;
+     size_t lastLength;
+ } verify_part_t;
+
+ // Function declarations
+ static bool verify_index(const char* indexFilename, const bool full, const bool strict, const int numThreads);
+ static bool verify_binary(const char* path, const bool full, const int numThreads);
+ static bool verify_text(const char* path, const bool strict, const int numThreads);
+ static void run_parts(verify_part_t* parts, const int numParts, void* (*body)(void* arg));
+ static void* chunk_thread(void* arg);
+ static void* word_thread(void* arg);
+ static bool check_word(void* arg, const int i, const char* word);
+ static bool count_posting(void* arg, const int docID, const int count);
+ static bool count_field(void* arg, const int field, const int docID, const int count);
+ static bool check_positions(verify_part_t* part, const int i);
+ static void* text_thread(void* arg);
+ static const char* check_line(const char* line, const char* eol, const char** unordered);
+ static void note_unordered(verify_part_t* part, const char* unordered);
+ static int compare_words(const char* a, const size_t lenA, const char* b, const size_t lenB);
+ static double now_ms(void);
+
+
+ int main(int argc, char* argv[]){
+     bool full = false;   // -f: decode every word and posting of binary files
+     bool strict = false; // -s: text files must have words and docIDs in increasing order
+     int numThreads = 0;  // -j: threads per file; 0 is one per CPU
+
+     // Parse options
+     int opt;
+     while ((opt = getopt(argc, argv, "fsj:")) != -1) {
+         if (opt == 'f') {
+             full = true;
+         } else if (opt == 's') {
+             strict = true;
+         } else if (opt == 'j' && atoi(optarg) >= 1) {
+             numThreads = atoi(optarg);
+         } else {
+             fprintf(stderr, USAGE, argv[0]);
+             return 1;
+         }
+     }
+     if (optind >= argc) {
+         fprintf(stderr, USAGE, argv[0]);
+         return 1;
+     }
+     if (numThreads == 0) {
+         long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+         numThreads = (cpus > 0) ? (int) cpus : 1;
+     }
+
+     int status = 0;
+     for (int f = optind; f < argc; f++) {
+         if (!verify_index(argv[f], full, strict, numThreads)) {
+             status = 2;
+         }
+     }
+     return status;
+ }
+
+
+ /* Check an index named on the command line: each shard of a shard list, else the file and its
+  * delta segments (listed in indexFilename.segments); false if any is damaged */
+ static bool verify_index(const char* indexFilename, const bool full, const bool strict, const int numThreads){
+     size_t pathSize = strlen(indexFilename) + 32;
+     char* path = malloc(pathSize);
+     if (path == NULL) {
+         return false;
+     }
+     bool ok = true;
+     bool sharded = shard_is(indexFilename);
+     snprintf(path, pathSize, "%s.segments", indexFilename);
+     FILE* list = fopen(sharded ? indexFilename : path, "r");
+     if (!sharded) {
+         ok = indexfile_is(indexFilename) ? verify_binary(indexFilename, full, numThreads)
+                                          : verify_text(indexFilename, strict, numThreads);
+     }
+     // "shard N ..." lines of a shard list, or "delta N" lines of a segment list
+     char* line = NULL;
+     size_t lineSize = 0;
+     int number;
+     while (list != NULL && getline(&line, &lineSize, list) != -1) {
+         if (sscanf(line, sharded ? "shard %d" : "delta %d", &number) == 1 && number > 0) {
+             snprintf(path, pathSize, sharded ? "%s.shard%d" : "%s.delta%d", indexFilename, number);
+             bool shardOk = indexfile_is(path) ? verify_binary(path, full, numThreads) : verify_text(path, strict, numThreads);
+             ok = shardOk && ok;
+         }
+     }
+     free(line);
+     if (list != NULL) {
+         fclose(list);
+     }
+     free(path);
+     return ok;
+ }
+
+ /* Check a binary index's chunks against their checksums, and with full decode all of it; print
+  * the outcome and return whether it is sound */
+ static bool verify_binary(const char* path, const bool full, const int numThreads){
+     double start = now_ms();
+     indexfile_t* file = indexfile_open(path);
+     if (file == NULL) {
+         printf("%s: DAMAGED: not a binary index of this version, or its header is damaged\n", path);
+         return false;
+     }
+     uint64_t numChunks = indexfile_numChunks(file);
+     int numParts = ((uint64_t) numThreads > numChunks) ? (int) numChunks : numThreads;
+     numParts = (numParts < 1) ? 1 : numParts;
+     verify_part_t* parts = calloc(numParts, sizeof(verify_part_t));
+     if (parts == NULL) {
+         indexfile_close(file);
+         return false;
+     }
+
+     // Each thread checks a run of consecutive chunks
+     for (int t = 0; t < numParts; t++) {
+         parts[t].file = file;
+         parts[t].first = numChunks * t / numParts;
+         parts[t].end = numChunks * (t + 1) / numParts;
+     }
+     run_parts(parts, numParts, chunk_thread);
+     uint64_t numBad = 0;
+     uint64_t firstBad = 0;
+     for (int t = numParts - 1; t >= 0; t--) {
+         numBad += parts[t].numBad;
+         firstBad = (parts[t].numBad > 0) ? parts[t].firstBad : firstBad;
+     }
+     uint64_t offset = 0;
+     uint64_t length = 0;
+     indexfile_checkChunk(file, numChunks - 1, &offset, &length); // The last, to find the end of the chunks
+
+     // Decode every word and posting, each thread a run of words; its first word is checked
+     // against the one before it
+     uint64_t numBadWords = 0;
+     uint64_t firstBadWord = 0;
+     uint64_t numPostings = 0;
+     int numWords = indexfile_numWords(file);
+     if (full && numBad == 0) {
+         for (int t = 0; t < numParts; t++) {
+             parts[t].first = (uint64_t) numWords * t / numParts;
+             parts[t].end = (uint64_t) numWords * (t + 1) / numParts;
+             parts[t].numBad = 0;
+         }
+         run_parts(parts, numParts, word_thread);
+         for (int t = numParts - 1; t >= 0; t--) {
+             numBadWords += parts[t].numBad;
+             firstBadWord = (parts[t].numBad > 0) ? parts[t].firstBad : firstBadWord;
+             numPostings += parts[t].numPostings;
+         }
+     }
+     double ms = now_ms() - start;
+
+     if (numBad > 0) {
+         printf("%s: DAMAGED: %llu of %llu chunks do not match their checksums (the first at byte %llu)\n",
+                path, (unsigned long long) numBad, (unsigned long long) numChunks, (unsigned long long) firstBad);
+     } else if (numBadWords > 0) {
+         printf("%s: DAMAGED: %llu of %d words do not decode (the first is number %llu)\n",
+                path, (unsigned long long) numBadWords, numWords, (unsigned long long) firstBadWord);
+     } else if (full) {
+         printf("%s: ok (binary, %d words, %llu postings, %llu chunks, %.1f ms)\n",
+                path, numWords, (unsigned long long) numPostings, (unsigned long long) numChunks, ms);
+     } else {
+         printf("%s: ok (binary, %llu chunks, %.1f ms, %.0f MB/s)\n", path, (unsigned long long) numChunks, ms,
+                (ms > 0) ? (offset + length) / 1000.0 / ms : 0);
+     }
+     free(parts);
+     indexfile_close(file);
+     return numBad == 0 && numBadWords == 0;
+ }
+
+ /* Parse a text index, in parts of about equal size ending with whole lines; print the outcome and
+  * return whether it is sound (with strict, in order too) */
+ static bool verify_text(const char* path, const bool strict, const int numThreads){
+     double start = now_ms();
+     int fd = open(path, O_RDONLY);
+     struct stat info;
+     if (fd < 0 || fstat(fd, &info) != 0) {
+         printf("%s: DAMAGED: cannot be read\n", path);
+         if (fd >= 0) {
+             close(fd);
+         }
+         return false;
+     }
+     size_t size = info.st_size;
+     if (size == 0) {
+         close(fd);
+         printf("%s: ok (text, 0 lines)\n", path);
+         return true;
+     }
+     const char* text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd);
+     if (text == MAP_FAILED) {
+         printf("%s: DAMAGED: cannot be read\n", path);
+         return false;
+     }
+     int numParts = (size / (1 << 20) + 1 < (size_t) numThreads) ? (int) (size / (1 << 20) + 1) : numThreads;
+     verify_part_t* parts = calloc(numParts, sizeof(verify_part_t));
+     if (parts == NULL) {
+         munmap((void*) text, size);
+         return false;
+     }
+     size_t begin = 0;
+     for (int t = 0; t < numParts; t++) {
+         size_t end = size;
+         if (t < numParts - 1) {
+             end = size / numParts * (t + 1);
+             end = (end < begin) ? begin : end;
+             const char* newline = memchr(text + end, '\n', size - end);
+             end = (newline == NULL) ? size : (size_t) (newline - text) + 1;
+         }
+         parts[t].text = text + begin;
+         parts[t].length = end - begin;
+         begin = end;
+     }
+     run_parts(parts, numParts, text_thread);
+
+     // The first bad line, counted from the start of the file; and the lines out of order, words
+     // being in order across parts too
+     long lines = 0;
+     const char* error = NULL;
+     long numUnordered = 0;
+     long firstUnordered = 0;
+     const char* unordered = NULL;
+     const verify_part_t* previous = NULL;
+     for (int t = 0; t < numParts && error == NULL; t++) {
+         bool counted = (parts[t].numUnordered > 0 && parts[t].firstUnordered == 0); // Its first line already
+         if (!counted && previous != NULL && parts[t].firstWord != NULL
+             && compare_words(previous->lastWord, previous->lastLength, parts[t].firstWord, parts[t].firstLength) >= 0) {
+             if (numUnordered++ == 0) { // Earlier parts' lines come first
+                 firstUnordered = lines;
+                 unordered = "word not after the word before";
+             }
+         }
+         if (parts[t].numUnordered > 0 && numUnordered == 0) {
+             firstUnordered = lines + parts[t].firstUnordered;
+             unordered = parts[t].unordered;
+         }
+         numUnordered += parts[t].numUnordered;
+         lines += parts[t].numLines;
+         error = parts[t].error;
+         previous = (parts[t].lastWord != NULL) ? &parts[t] : previous;
+     }
+     if (error == NULL && text[size - 1] != '\n') {
+         error = "cut off (no newline at the end)";
+     }
+     if (error == NULL && strict && numUnordered > 0) {
+         error = unordered;
+         lines = firstUnordered;
+     }
+     double ms = now_ms() - start;
+     if (error != NULL) {
+         printf("%s: DAMAGED: line %ld: %s\n", path, lines + 1, error);
+     } else if (numUnordered > 0) {
+         printf("%s: ok (text, %ld lines, %.1f ms); warning: %ld lines out of order (the first is line %ld: %s)\n",
+                path, lines, ms, numUnordered, firstUnordered + 1, unordered);
+     } else {
+         printf("%s: ok (text, %ld lines, %.1f ms)\n", path, lines, ms);
+     }
+     free(parts);
+     munmap((void*) text, size);
+     return error == NULL;
+ }
+
+ /* Run body on each part, one thread per part (this one does the first) */
+ static void run_parts(verify_part_t* parts, const int numParts, void* (*body)(void* arg)){
+     pthread_t* threads = calloc(numParts, sizeof(pthread_t));
+     bool* started = calloc(numParts, sizeof(bool));
+     for (int t = 1; threads != NULL && started != NULL && t < numParts; t++) {
+         started[t] = (pthread_create(&threads[t], NULL, body, &parts[t]) == 0);
+     }
+     (*body)(&parts[0]);
+     for (int t = 1; t < numParts; t++) {
+         if (started != NULL && started[t]) {
+             pthread_join(threads[t], NULL);
+         } else {
+             (*body)(&parts[t]); // Couldn't start a thread; do that part here
+         }
+     }
+     free(threads);
+     free(started);
+ }
+
+ /* Thread body: check a part's chunks against their checksums */
+ static void* chunk_thread(void* arg){
+     verify_part_t* part = arg;
+     for (uint64_t c = part->first; c < part->end; c++) {
+         uint64_t offset;
+         if (!indexfile_checkChunk(part->file, c, &offset, NULL)) {
+             part->firstBad = (part->numBad == 0) ? offset : part->firstBad;
+             part->numBad++;
+         }
+     }
+     return NULL;
+ }
+
+ /* Thread body: decode a part's words (and the word before, for order) and their postings */
+ static void* word_thread(void* arg){
+     verify_part_t* part = arg;
+     if (part->first >= part->end) {
+         return NULL;
+     }
+     part->word = malloc(indexfile_maxWordBytes(part->file));
+     part->haveWord = false;
+     int from = (part->first > 0) ? (int) part->first - 1 : 0;
+     if ((part->word == NULL || !indexfile_iterateWords(part->file, from, part->end, part, check_word))
+         && part->numBad == 0) { // The words themselves don't decode
+         part->firstBad = part->first;
+         part->numBad = part->end - part->first;
+     }
+     free(part->word);
+     part->word = NULL;
+     free(part->positions);
+     part->positions = NULL;
+     return NULL;
+ }
+
+ /* indexfile_iterateWords callback: check a word follows the one before, and decode its postings */
+ static bool check_word(void* arg, const int i, const char* word){
+     verify_part_t* part = arg;
+     bool ok = (!part->haveWord || strcmp(part->word, word) < 0);
+     strcpy(part->word, word);
+     part->haveWord = true;
+     if ((uint64_t) i < part->first) {
+         return true; // The word before the part's own, for order only
+     }
+     uint64_t numPostings = 0;
+     uint64_t numFields = 0;
+     ok = ok && indexfile_iteratePostings(part->file, i, &numPostings, count_posting)
+         && numPostings == (uint64_t) indexfile_numPostings(part->file, i)
+         && ((indexfile_flags(part->file) & INDEXFILE_POSITIONS) == 0 || check_positions(part, i))
+         && ((indexfile_flags(part->file) & INDEXFILE_FIELDS) == 0
+             || indexfile_iterateFields(part->file, i, &numFields, count_field))
+         && (numPostings > 0 || numFields > 0); // Only link text may keep a word without postings
+     if (!ok) {
+         part->firstBad = (part->numBad == 0) ? (uint64_t) i : part->firstBad;
+         part->numBad++;
+     }
+     part->numPostings += numPostings;
+     return true;
+ }
+
+ /* indexfile_iteratePostings callback: count a posting */
+ static bool count_posting(void* arg, const int docID, const int count){
+     (*(uint64_t*) arg)++;
+     return true;
+ }
+
+ /* indexfile_iterateFields callback: count a field posting (the walk checks each one decodes) */
+ static bool count_field(void* arg, const int field, const int docID, const int count){
+     (*(uint64_t*) arg)++;
+     return true;
+ }
+
+ /* Decode the positions of each block of word number i: each posting's must be increasing, and
+  * together use up exactly the block's run of positions. Return false if they don't. */
+ static bool check_positions(verify_part_t* part, const int i){
+     int docIDs[POSTINGS_BLOCK];
+     int counts[POSTINGS_BLOCK];
+     for (int block = 0; block < indexfile_numBlocks(part->file, i); block++) {
+         const uint8_t* positions;
+         size_t length;
+         int n = indexfile_decodeBlock(part->file, i, block, docIDs, counts);
+         if (n == 0 || !indexfile_blockPositions(part->file, i, block, &positions, &length)) {
+             return false;
+         }
+         size_t used = 0;
+         for (int p = 0; p < n; p++) {
+             if (counts[p] > part->capacity) {
+                 int* grown = realloc(part->positions, counts[p] * sizeof(int));
+                 if (grown == NULL) {
+                     return false;
+                 }
+                 part->positions = grown;
+                 part->capacity = counts[p];
+             }
+             size_t bytes = postings_decodePositions(positions + used, length - used, counts[p], part->positions);
+             if (bytes == 0) {
+                 return false;
+             }
+             used += bytes;
+         }
+         if (used != length) {
+             return false;
+         }
+     }
+     return true;
+ }
+
+ /* Thread body: check a part's lines, noting its first and last words */
+ static void* text_thread(void* arg){
+     verify_part_t* part = arg;
+     const char* text = part->text;
+     const char* end = text + part->length;
+     while (text < end) {
+         const char* newline = memchr(text, '\n', end - text);
+         const char* eol = (newline == NULL) ? end : newline;
+         const char* wordEnd = memchr(text, ' ', eol - text);
+         size_t len = ((wordEnd == NULL) ? eol : wordEnd) - text;
+         const char* unordered = NULL;
+         part->error = check_line(text, eol, &unordered);
+         if (part->error != NULL) {
+             return NULL;
+         }
+         if (part->lastWord != NULL && compare_words(part->lastWord, part->lastLength, text, len) >= 0) {
+             unordered = "word not after the word before";
+         }
+         if (unordered != NULL) {
+             note_unordered(part, unordered);
+         }
+         if (part->firstWord == NULL) {
+             part->firstWord = text;
+             part->firstLength = len;
+         }
+         part->lastWord = text;
+         part->lastLength = len;
+         part->numLines++;
+         text = eol + 1;
+     }
+     return NULL;
+ }
+
+ /* Count a line out of order in a part, noting it if it is the first */
+ static void note_unordered(verify_part_t* part, const char* unordered){
+     if (part->numUnordered++ == 0) {
+         part->firstUnordered = part->numLines;
+         part->unordered = unordered;
+     }
+ }
+
+ /* Return what is wrong with a line "word docID count [docID count]..." (without its newline); NULL if
+  * nothing. *unordered is set if its docIDs don't increase, which index_load accepts (adding up the counts
+  * of a repeated docID) */
+ static const char* check_line(const char* line, const char* eol, const char** unordered){
+     const char* c = line;
+     while (c < eol && *c != ' ') {
+         c++;
+     }
+     if (c == line) {
+         return "no word";
+     }
+     if (c == eol) {
+         return "word with no postings";
+     }
+     long prevDocID = 0;
+     while (c < eol) {
+         long values[2];
+         for (int v = 0; v < 2; v++) {
+             if (c == eol || *c++ != ' ' || c == eol || *c < '0' || *c > '9') {
+                 return "malformed docID or count";
+             }
+             long n = 0;
+             for ( ; c < eol && *c >= '0' && *c <= '9'; c++) {
+                 n = n * 10 + (*c - '0');
+                 if (n > INT_MAX) {
+                     return "docID or count too large";
+                 }
+             }
+             values[v] = n;
+         }
+         if (values[0] < 1) {
+             return "docID not positive";
+         }
+         if (values[0] <= prevDocID) {
+             *unordered = "docIDs not increasing";
+         }
+         if (values[1] < 1) {
+             return "count not positive";
+         }
+         prevDocID = values[0];
+     }
+     return NULL;
+ }
+
+ /* strcmp for words that are not NUL-terminated */
+ static int compare_words(const char* a, const size_t lenA, const char* b, const size_t lenB){
+     int cmp = memcmp(a, b, (lenA < lenB) ? lenA : lenB);
+     return (cmp != 0) ? cmp : (lenA > lenB) - (lenA < lenB);
+ }
+
+ /* Return the current time in milliseconds, from a clock that never steps back */
+ static double now_ms(void){
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+ }
@@ -6,6 +6,9 @@
 # Define directory paths and programs
 INDEXER=./indexer
 INDEXTEST=./indextest
+TOKENTEST=./tokentest
+INDEXVERIFY=./indexverify
+QUERIER=../querier/querier
 INVALID_DIR=invalid
 CRAWLER_DIR=~/cs50-dev/shared/tse/output/crawler/pages-letters-depth-1
 INDEX_DIR=index_dir
@@ -67,6 +70,12 @@ run_test "Non-existent directory" "! $INDEXER /nonexistent/path output.txt"
 # Test with invalid crawler directory (no .crawler file)
 run_test "Invalid crawler directory" "! $INDEXER $INVALID_DIR output.txt"
 
+# Positions (-p) are kept only by full binary builds
+run_test "Positions without -b" "! $INDEXER -p $CRAWLER_DIR output.txt"
+run_test "Positions with an incremental update" "! $INDEXER -b -p -u $CRAWLER_DIR output.txt"
+# So are fields (-f)
+run_test "Fields without -b" "! $INDEXER -f $CRAWLER_DIR output.txt"
+
 # Test with read-only output directory
 # Make directory read-only before test
 chmod 555 "$INVALID_DIR"
@@ -88,10 +97,53 @@ echo "Running integration tests..."
 INDEX_FILE="$INDEX_DIR/test1.index"
 run_test "Building index from small crawler directory" "$INDEXER $CRAWLER_DIR $INDEX_FILE"
 
+# Building with several threads must give a byte-identical index
+run_test "Parallel build matches serial build" "$INDEXER -j 4 $CRAWLER_DIR $INDEX_DIR/test1_j4.index && cmp $INDEX_FILE $INDEX_DIR/test1_j4.index"
+
+# Building in bounded memory writes the same index, with words sorted
+run_test "Bounded-memory (SPIMI) build matches in-memory build" "$INDEXER -m 1 $CRAWLER_DIR $INDEX_DIR/test1_spimi.index && ~/cs50-dev/shared/tse/indexcmp $INDEX_FILE $INDEX_DIR/test1_spimi.index"
+
+# A binary index holds exactly the text index: indextest maps it and writes it back as text
+run_test "Binary index matches text index" "$INDEXER -b $CRAWLER_DIR $INDEX_DIR/test1_bin.index && $INDEXTEST $INDEX_DIR/test1_bin.index $INDEX_DIR/test1_bin.text && cmp $INDEX_FILE $INDEX_DIR/test1_bin.text"
+run_test "Binary index decodes the same without SIMD" "TSE_POSTINGS=scalar $INDEXTEST $INDEX_DIR/test1_bin.index $INDEX_DIR/test1_bin.scalar && cmp $INDEX_FILE $INDEX_DIR/test1_bin.scalar"
+
+# indexverify passes sound indexes, text and binary, and catches one flipped byte in a binary index's postings
+run_test "indexverify passes sound indexes" "$INDEXVERIFY -f $INDEX_FILE $INDEX_DIR/test1_bin.index && TSE_CRC32C=scalar $INDEXVERIFY $INDEX_DIR/test1_bin.index"
+run_test "indexverify warns of a text index out of order, and -s rejects it" "tac $INDEX_FILE > $INDEX_DIR/test1_rev.index && $INDEXVERIFY $INDEX_DIR/test1_rev.index | grep -q 'warning' && ! $INDEXVERIFY -s $INDEX_DIR/test1_rev.index"
+run_test "indexverify catches a damaged binary index" "cp $INDEX_DIR/test1_bin.index $INDEX_DIR/test1_dmg.index && printf 'X' | dd of=$INDEX_DIR/test1_dmg.index bs=1 seek=200 conv=notrunc 2>/dev/null && ! $INDEXVERIFY $INDEX_DIR/test1_dmg.index"
+
+# A positional index holds the same postings, builds the same with threads, and its positions decode
+run_test "Positional index matches text index" "$INDEXER -b -p $CRAWLER_DIR $INDEX_DIR/test1_pos.index && $INDEXTEST $INDEX_DIR/test1_pos.index $INDEX_DIR/test1_pos.text && cmp $INDEX_FILE $INDEX_DIR/test1_pos.text"
+run_test "Update and compaction refuse a positional index" "! $INDEXER -u $CRAWLER_DIR $INDEX_DIR/test1_pos.index && ! $INDEXER -c $CRAWLER_DIR $INDEX_DIR/test1_pos.index && $INDEXVERIFY -f $INDEX_DIR/test1_pos.index"
+run_test "Parallel positional build matches serial build" "$INDEXER -b -p -j 4 $CRAWLER_DIR $INDEX_DIR/test1_pos4.index && cmp $INDEX_DIR/test1_pos.index $INDEX_DIR/test1_pos4.index && $INDEXVERIFY -f $INDEX_DIR/test1_pos.index"
+
+# An index with fields holds the same postings too, builds the same with threads, and its field postings decode
+run_test "Index with fields matches text index" "$INDEXER -b -f $CRAWLER_DIR $INDEX_DIR/test1_fld.index && $INDEXTEST $INDEX_DIR/test1_fld.index $INDEX_DIR/test1_fld.text && cmp $INDEX_FILE $INDEX_DIR/test1_fld.text"
+run_test "Parallel build with fields matches serial build" "$INDEXER -b -f -j 4 $CRAWLER_DIR $INDEX_DIR/test1_fld4.index && cmp $INDEX_DIR/test1_fld.index $INDEX_DIR/test1_fld4.index && $INDEXVERIFY -f $INDEX_DIR/test1_fld.index"
+run_test "Update and compaction refuse an index with fields" "! $INDEXER -u $CRAWLER_DIR $INDEX_DIR/test1_fld.index && ! $INDEXER -c $CRAWLER_DIR $INDEX_DIR/test1_fld.index && $INDEXVERIFY -f $INDEX_DIR/test1_fld.index"
+
+# Every word of the index, queried on 3 shards (by docID or by term), ranks the same documents as on the whole index
+cut -d' ' -f1 $INDEX_FILE > $INDEX_DIR/words.txt
+run_test "Sharded build ranks like the unsharded index" "$INDEXER -s 3 $CRAWLER_DIR $INDEX_DIR/test1_s3.index && $QUERIER $CRAWLER_DIR $INDEX_FILE < $INDEX_DIR/words.txt > $INDEX_DIR/whole.out && $QUERIER $CRAWLER_DIR $INDEX_DIR/test1_s3.index < $INDEX_DIR/words.txt | cmp $INDEX_DIR/whole.out"
+run_test "Term-sharded build ranks like the unsharded index" "$INDEXER -t 3 $CRAWLER_DIR $INDEX_DIR/test1_t3.index && $QUERIER $CRAWLER_DIR $INDEX_DIR/test1_t3.index < $INDEX_DIR/words.txt | cmp $INDEX_DIR/whole.out"
+
+# A word only in the text of the first page's first link finds the page linked to with -f, on any shards
+mkdir -p $INDEX_DIR/anchor && cp -r $CRAWLER_DIR/. $INDEX_DIR/anchor/ && sed -i '0,/">[^<]*<\/a>/s//">zebrafish<\/a>/' $INDEX_DIR/anchor/1
+run_test "Shards find a page by link text alone" "$INDEXER -b -f $INDEX_DIR/anchor $INDEX_DIR/anchor.index && echo zebrafish | $QUERIER -f $INDEX_DIR/anchor $INDEX_DIR/anchor.index > $INDEX_DIR/anchor.out && grep -q 'Matches 2 documents' $INDEX_DIR/anchor.out && $INDEXER -b -f -s 3 $INDEX_DIR/anchor $INDEX_DIR/anchor_s3.index && echo zebrafish | $QUERIER -f $INDEX_DIR/anchor $INDEX_DIR/anchor_s3.index | cmp $INDEX_DIR/anchor.out && $INDEXER -b -f -t 3 $INDEX_DIR/anchor $INDEX_DIR/anchor_t3.index && echo zebrafish | $QUERIER -f $INDEX_DIR/anchor $INDEX_DIR/anchor_t3.index | cmp $INDEX_DIR/anchor.out && $INDEXVERIFY -f $INDEX_DIR/anchor_s3.index.shard*"
+
+# An incremental update of an unchanged directory writes no delta; compacting it is a no-op
+run_test "Incremental update with nothing changed" "$INDEXER -u $CRAWLER_DIR $INDEX_FILE && $INDEXER -c $CRAWLER_DIR $INDEX_FILE && ! ls $INDEX_FILE.delta*"
+
+# Every tokenizer implementation must split pages exactly as webpage_getNextWord does
+for IMPL in scalar sse2 avx2; do
+    run_test "Tokenizer ($IMPL) matches webpage_getNextWord" "TSE_TOKENIZER=$IMPL $TOKENTEST $CRAWLER_DIR"
+done
+
 # Validate the created index using indextest
 if [ -f "$INDEX_FILE" ]; then
     NEW_INDEX="$INDEX_DIR/test1_copy.index"
     run_test "Validating index with indextest" "$INDEXTEST $INDEX_FILE $NEW_INDEX"
+    run_test "Reloaded index keeps every count" "cmp $INDEX_FILE $NEW_INDEX"
     
     run_test "Comparing index files" "~/cs50-dev/shared/tse/indexcmp $INDEX_FILE $NEW_INDEX"
 fi
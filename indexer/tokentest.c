@@ -0,0 +1,114 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: tokentest.c
+Description:
+ * The tokentest program splits every document of a crawler directory into
+ * words twice: with webpage_getNextWord (then word_normalize and the
+ * 3-letter rule, as the indexer used to) and with the tokenizer module.
+ * An optional minLength replaces the 3-letter rule in both.
+ * It reports the first document and word where the two disagree, so the
+ * SIMD tokenizer can be checked token-for-token against the original.
+ * Set TSE_TOKENIZER=scalar|sse2|avx2 to test a narrower implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "common/pagedir.h"
+#include "common/tokenizer.h"
+#include "common/word.h"
+#include "webpage.h"
+#include "mem.h"
+
+static int compare_page(webpage_t* page, tokenizer_t* tokenizer, const int docID, const int minLength,
+                        long* numWords);
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s pageDirectory [minLength]\n", argv[0]);
+        return 1;
+    }
+    int minLength = argc == 3 ? atoi(argv[2]) : 3; // The indexer's minimum
+    if (minLength < 1) {
+        fprintf(stderr, "Error: minLength must be at least 1\n");
+        return 1;
+    }
+    int* docIDs = NULL;
+    uint64_t* sizes = NULL;
+    int numDocs = pagedir_listDocs(argv[1], &docIDs, &sizes);
+    if (numDocs <= 0) {
+        return 2; // pagedir_listDocs printed the error
+    }
+    free(sizes);
+
+    tokenizer_t* tokenizer = tokenizer_new(minLength, true, NULL);
+    if (tokenizer == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        free(docIDs);
+        return 3;
+    }
+
+    long numWords = 0;
+    int mismatches = 0;
+    for (int i = 0; i < numDocs; i++) {
+        webpage_t* page = pagedir_load(argv[1], docIDs[i]);
+        if (page == NULL) {
+            fprintf(stderr, "Error: cannot read document %s/%d\n", argv[1], docIDs[i]);
+            mismatches++;
+            continue;
+        }
+        mismatches += compare_page(page, tokenizer, docIDs[i], minLength, &numWords);
+        webpage_delete(page);
+    }
+    tokenizer_delete(tokenizer);
+    free(docIDs);
+
+    if (mismatches > 0) {
+        printf("%d of %d documents differ (%s tokenizer)\n", mismatches, numDocs, tokenizer_simd());
+        return 4;
+    }
+    printf("%d documents, %ld words: %s tokenizer matches webpage_getNextWord\n", numDocs, numWords, tokenizer_simd());
+    return 0;
+}
+
+/* Compare the two tokenizers on one page; return 1 (after printing the difference) if they differ, else 0 */
+static int compare_page(webpage_t* page, tokenizer_t* tokenizer, const int docID, const int minLength,
+                        long* numWords)
+{
+    int pos = 0;
+    int numBatch = 0;  // words in the tokenizer's current batch
+    int next = 0;      // next of them to compare
+    long wordNumber = 0;
+    char* expected;
+
+    tokenizer_start(tokenizer, page);
+    while ((expected = webpage_getNextWord(page, &pos)) != NULL) {
+        word_normalize(expected);
+        if ((int) strlen(expected) < minLength) {
+            free(expected);
+            continue;
+        }
+        if (next == numBatch) {
+            numBatch = tokenizer_next(tokenizer);
+            next = 0;
+        }
+        const char* actual = next < numBatch ? tokenizer_word(tokenizer, next++, NULL) : NULL;
+        if (actual == NULL || strcmp(actual, expected) != 0) {
+            printf("document %d, word %ld: expected '%s', tokenizer gave '%s'\n",
+                   docID, wordNumber, expected, actual == NULL ? "(end)" : actual);
+            free(expected);
+            return 1;
+        }
+        free(expected);
+        wordNumber++;
+    }
+    if (next < numBatch || tokenizer_next(tokenizer) != 0) {
+        printf("document %d, word %ld: tokenizer gave extra words\n", docID, wordNumber);
+        return 1;
+    }
+    *numWords += wordNumber;
+    return 0;
+}
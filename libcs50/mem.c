@@ -13,13 +13,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include "mem.h"
 
 /**************** file-local global variables ****************/
 // track malloc and free across *all* calls within this program.
-static int nmalloc = 0;         // number of successful malloc calls
-static int nfree = 0;           // number of free calls
-static int nfreenull = 0;       // number of free(NULL) calls
+// atomic, so the counts stay correct when several threads allocate.
+static atomic_int nmalloc = 0;         // number of successful malloc calls
+static atomic_int nfree = 0;           // number of free calls
+static atomic_int nfreenull = 0;       // number of free(NULL) calls
 
 
 /**************** mem_assert ****************/
@@ -114,8 +116,9 @@ mem_free(void* ptr)
 void 
 mem_report(FILE* fp, const char* message)
 {
+  int m = atomic_load(&nmalloc), f = atomic_load(&nfree), fn = atomic_load(&nfreenull);
   fprintf(fp, "%s: %d malloc, %d free, %d free(NULL), %d net\n", 
-          message, nmalloc, nfree, nfreenull, nmalloc - nfree - nfreenull);
+          message, m, f, fn, m - f - fn);
 }
 
 /**************** mem_net() ****************/
@@ -123,5 +126,5 @@ mem_report(FILE* fp, const char* message)
 int
 mem_net(void)
 {
-  return nmalloc - nfree - nfreenull;
+  return atomic_load(&nmalloc) - atomic_load(&nfree) - atomic_load(&nfreenull);
 }
@@ -4,39 +4,96 @@ Date: 2/24/25
 File: indexer.c
 Description: This file contains the main function for the querier program. 
 The TSE Querier is a standalone program that reads the index file produced by the TSE Indexer, 
-and page files produced by the TSE Crawler, and answers search queries submitted via stdin
+and page files produced by the TSE Crawler, and answers search queries submitted via stdin.
+A new build of the index is swapped in without a restart on SIGHUP or a ":reload" line: a
+background thread loads it, and queries already running finish on the old one.
+With -f, words found in a page's title, headings or the text of links to it rank it higher.
 */
 
+ #define _POSIX_C_SOURCE 200809L  // for getopt, sigwait and clock_gettime
  #include <stdio.h>
  #include <stdlib.h>
  #include <string.h>
  #include <stdbool.h>
+ #include <stdatomic.h>
  #include <ctype.h>
  #include <unistd.h>
+ #include <signal.h>
+ #include <pthread.h>
+ #include <time.h>
  #include "mem.h"
  #include "common/pagedir.h"
  #include "common/index.h"  
- #include "hashtable.h"
  #include "common/query.h"
+ #include "common/segment.h"
+ #include "common/shard.h"
+ #include "common/epoch.h"
  #include "file.h"     // from libcs50
  
 
 
  
+ static const char* USAGE = "Usage: %s [-k results] [-f] pageDirectory indexFilename\n";
+ static const char* RELOAD_COMMAND = ":reload"; // a line asking for the index to be reloaded
+
+ /* The index being searched: the shards of a sharded index, or one index (with any delta segments) */
+ typedef struct served {
+     shard_set_t* shards;
+     index_t* index;
+ } served_t;
+
+ /* Swaps a freshly loaded index in for the served one whenever SIGHUP arrives */
+ typedef struct reloader {
+     const char* indexFilename;
+     _Atomic(served_t*) served;  // read by the query loop between epoch_enter and epoch_exit
+     epoch_t* epoch;             // slot 0 is the query loop
+     sigset_t signals;           // SIGHUP, blocked in every thread and taken by sigwait
+     atomic_bool quitting;
+ } reloader_t;
+
  // Function declarations
  static void prompt_user(void);
+ static served_t* served_load(const char* indexFilename);
+ static void served_delete(served_t* served);
+ static void* reload_thread(void* arg);
  
 
  
  int main(const int argc, char* argv[]){
+    int k = 0; // -k: print only the best k documents of each query; 0 prints every match
+    static const int fieldWeights[INDEX_FIELDS] = QUERY_FIELD_WEIGHTS;
+    const int* weights = NULL; // -f: rank with fields, by these weights
+
+    // Parse options
+    int opt;
+    while ((opt = getopt(argc, argv, "k:f")) != -1) {
+        if (opt == 'k' && atoi(optarg) >= 1) {
+            k = atoi(optarg);
+        } else if (opt == 'f') {
+            weights = fieldWeights;
+        } else {
+            fprintf(stderr, USAGE, argv[0]);
+            return 1;
+        }
+    }
+
     // Check arguments
-    if (argc != 3) {
-        fprintf(stderr, "Incorrect number of arguments -> Usage: %s pageDirectory indexFilename\n", argv[0]);
+    if (argc - optind != 2) {
+        fprintf(stderr, "Incorrect number of arguments -> ");
+        fprintf(stderr, USAGE, argv[0]);
         return 1; // Exit status 1 for issues with number of arguments
     }
     
-    char* pageDirectory = argv[1];
-    char* indexFilename = argv[2];
+    char* pageDirectory = argv[optind];
+    char* indexFilename = argv[optind + 1];
+
+    // SIGHUP asks for a reload; block it before any thread starts, so only the reloader takes it
+    reloader_t reloader;
+    reloader.indexFilename = indexFilename;
+    atomic_init(&reloader.quitting, false);
+    sigemptyset(&reloader.signals);
+    sigaddset(&reloader.signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &reloader.signals, NULL);
     
     // Validate pageDirectory (must exist and is crawler generated)
     if (!is_crawler_directory(pageDirectory)) {
@@ -64,22 +121,39 @@ and page files produced by the TSE Crawler, and answers search queries submitted
         fprintf(stderr, "Error: cannot read %s\n", indexFilename);
         return 3; // Exit status 3 for issues reading indexFilename 
     }
-    int size = file_numLines(fp_indexFile); // Get number of lines (total words) in indexFilename
+    fclose(fp_indexFile);
 
 
-    // Load the index from file and store in internal seperate index
-    hashtable_t* index = load_index(fp_indexFile, size);
-    if (index == NULL) {
+    // Load the index, and start the thread that reloads it
+    served_t* first = served_load(indexFilename);
+    if (first == NULL) {
         fprintf(stderr, "Error: failed to load index from %s\n", indexFilename);
         return 3; // Exit status 3 for issues reading indexFilename
     }
-    fclose(fp_indexFile);
+    if (weights != NULL && !(first->shards != NULL ? shard_hasFields(first->shards) : index_hasFields(first->index))) {
+        fprintf(stderr, "Warning: %s has no fields (indexer -f); -f ranks as without it\n", indexFilename);
+    }
+    atomic_init(&reloader.served, first);
+    reloader.epoch = epoch_new(1);
+    pthread_t reloadThread;
+    bool reloading = (reloader.epoch != NULL && pthread_create(&reloadThread, NULL, reload_thread, &reloader) == 0);
+    if (!reloading) {
+        fprintf(stderr, "Warning: cannot start the reloader; %s will not be reloaded\n", indexFilename);
+    }
     
     char* line = NULL;
     prompt_user();
 
     // Read queries from stdin, one per line, until EOF
     while ((line = file_readLine(stdin)) != NULL) {  
+        if (strcmp(line, RELOAD_COMMAND) == 0) { // As if sent SIGHUP
+            mem_free(line);
+            if (reloading) {
+                kill(getpid(), SIGHUP);
+            }
+            prompt_user();
+            continue;
+        }
         int num_words = 0; // Use pointer to this to update total words in query     
         char** words = tokenize_query(line, &num_words); // Tokenize the query into words
         mem_free(line); // Free the query string input
@@ -87,18 +161,46 @@ and page files produced by the TSE Crawler, and answers search queries submitted
         if (words == NULL) { // We check if the query is valid in tokenize_query()
             continue; // Go to next query input if not valid
         }else{
-            // Get counters of (docID, total rank) pairs
-            counters_t* result_counters = process_query_array(words, num_words, index);
-            
-            // Print ranked results
-            print_ranked_results(result_counters, pageDirectory);
-            
-            counters_delete(result_counters); // Cleanup
+            // Rank the k best documents (every match if k is 0) on the index served now, then print
+            // them; a reload meanwhile frees the index only after this query is done with it
+            query_hit_t* hits = NULL;
+            int num_hits = 0;
+            int num_matches = 0;
+            bool positional = query_isPositional(words, num_words);
+            epoch_enter(reloader.epoch, 0);
+            served_t* served = atomic_load(&reloader.served);
+            bool answerable = !positional || (served->shards != NULL ? shard_hasPositions(served->shards)
+                                                                     : index_hasPositions(served->index));
+            if (!answerable) {
+                // Phrases and near/k need positions, which this index wasn't built with
+            } else if (served->shards != NULL) {
+                num_hits = shard_query(served->shards, words, num_words, weights, k, &hits, &num_matches);
+            } else {
+                counters_t* result_counters = process_query_weighted(words, num_words, &served->index, 1, weights);
+                num_hits = rank_results(result_counters, k, &hits, &num_matches);
+                counters_delete(result_counters); // Cleanup
+            }
+            epoch_exit(reloader.epoch, 0);
+            if (!answerable) {
+                fprintf(stderr, "Error: phrase and near queries need an index built with indexer -p\n");
+            } else if (num_hits < 0) {
+                fprintf(stderr, "Error: out of memory ranking the query\n");
+            } else {
+                print_hits(hits, num_hits, num_matches, pageDirectory);
+            }
+            free(hits);
         }
         free_words(words, num_words); // Free the tokenized words array
         prompt_user();
     }
-    index_delete(index); // Cleanup
+    // Stop the reloader (finishing any reload), then clean up
+    if (reloading) {
+        atomic_store(&reloader.quitting, true);
+        pthread_kill(reloadThread, SIGHUP);
+        pthread_join(reloadThread, NULL);
+    }
+    served_delete(atomic_load(&reloader.served));
+    epoch_delete(reloader.epoch);
     return 0; // Succesfully made it through every step
 } 
 
@@ -108,4 +210,56 @@ static void prompt_user(void){
     if (isatty(fileno(stdin))) { // print a prompt iff stdin is a tty (terminal)
         printf("Query? ");
     }
+}
+
+/* Load the shards of a sharded index, each queried in its own thread; otherwise load the index
+ * (plus any delta segments from incremental updates) into one internal index. NULL on failure */
+static served_t* served_load(const char* indexFilename){
+    served_t* served = mem_calloc(1, sizeof(served_t));
+    if (served == NULL) {
+        return NULL;
+    }
+    if (shard_is(indexFilename)) {
+        served->shards = shard_load(indexFilename);
+    } else {
+        served->index = segment_load(indexFilename);
+    }
+    if (served->index == NULL && served->shards == NULL) {
+        mem_free(served);
+        return NULL;
+    }
+    return served;
+}
+
+static void served_delete(served_t* served){
+    if (served != NULL) {
+        index_delete(served->index);
+        shard_delete(served->shards);
+        mem_free(served);
+    }
+}
+
+/* Thread body: on each SIGHUP, load the index file again and swap it in; queries go on meanwhile,
+ * and the old index is freed once the query that may be using it is done. Several SIGHUPs during
+ * one load make one more reload */
+static void* reload_thread(void* arg){
+    reloader_t* reloader = arg;
+    int signal;
+    while (sigwait(&reloader->signals, &signal) == 0 && !atomic_load(&reloader->quitting)) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        served_t* fresh = served_load(reloader->indexFilename);
+        if (fresh == NULL) {
+            fprintf(stderr, "Error: failed to reload index from %s; still using the one loaded before\n",
+                    reloader->indexFilename);
+            continue;
+        }
+        served_t* old = atomic_exchange(&reloader->served, fresh);
+        epoch_synchronize(reloader->epoch);
+        served_delete(old);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        fprintf(stderr, "Reloaded index from %s in %.0f ms\n", reloader->indexFilename,
+                (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    }
+    return NULL;
 }
\ No newline at end of file
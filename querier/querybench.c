@@ -0,0 +1,237 @@
+/*
+Author: Sasha Ries
+Date: 10/19/26
+File: querybench.c
+Description:
+ * The querybench program times the querier's search on one or more index
+ * files: a plain index (with any delta segments) searched through
+ * process_query_weighted as querier.c does, or a sharded index (indexer -s
+ * or -t) searched through shard_query. It reads queries from stdin, runs
+ * them all on each index for a number of rounds, and prints each index's
+ * load time, queries per second and mean latency, and how many shards a
+ * query touches on average. It also checks that every index ranks every
+ * query exactly as the first one does. With -f, queries rank with fields,
+ * as querier -f does.
+ */
+
+ #define _POSIX_C_SOURCE 200809L  // for getopt and clock_gettime
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdbool.h>
+ #include <time.h>
+ #include <unistd.h>
+ #include "mem.h"
+ #include "common/index.h"
+ #include "common/query.h"
+ #include "common/segment.h"
+ #include "common/shard.h"
+ #include "file.h"     // from libcs50
+
+
+ static const char* USAGE = "Usage: %s [-k results] [-r rounds] [-f] indexFilename... < queries\n";
+
+ /* One tokenized query, and the ranking the first index gave it */
+ typedef struct bench_query {
+     char** words;
+     int num_words;
+     query_hit_t* hits;
+     int num_hits;
+     int num_matches;
+ } bench_query_t;
+
+ // Function declarations
+ static double now_ms(void);
+ static int search(index_t* index, shard_set_t* shards, bench_query_t* query, const int* weights, const int k,
+                   query_hit_t** hits, int* num_matches);
+ static int shards_touched(shard_set_t* shards, const bench_query_t* query);
+
+
+ int main(int argc, char* argv[]){
+     int k = 0;      // -k: rank only the best k documents; 0 ranks every match
+     int rounds = 5; // -r: times to run the queries on each index
+     static const int fieldWeights[INDEX_FIELDS] = QUERY_FIELD_WEIGHTS;
+     const int* weights = NULL; // -f: rank with fields
+
+     // Parse options
+     int opt;
+     while ((opt = getopt(argc, argv, "k:r:f")) != -1) {
+         if (opt == 'k' && atoi(optarg) >= 1) {
+             k = atoi(optarg);
+         } else if (opt == 'r' && atoi(optarg) >= 1) {
+             rounds = atoi(optarg);
+         } else if (opt == 'f') {
+             weights = fieldWeights;
+         } else {
+             fprintf(stderr, USAGE, argv[0]);
+             return 1;
+         }
+     }
+     if (optind >= argc) {
+         fprintf(stderr, USAGE, argv[0]);
+         return 1;
+     }
+
+     // Read and tokenize every query once, so the rounds time only the search
+     int num_queries = 0;
+     int capacity = 256;
+     bench_query_t* queries = malloc(capacity * sizeof(bench_query_t));
+     char* line;
+     while (queries != NULL && (line = file_readLine(stdin)) != NULL) {
+         bench_query_t query = {NULL, 0, NULL, -1, 0};
+         query.words = tokenize_query(line, &query.num_words);
+         mem_free(line);
+         if (query.words == NULL || query.num_words == 0) {
+             free_words(query.words, query.num_words);
+             continue;
+         }
+         if (num_queries == capacity) {
+             capacity *= 2;
+             bench_query_t* grown = realloc(queries, capacity * sizeof(bench_query_t));
+             if (grown == NULL) {
+                 free_words(query.words, query.num_words);
+                 break;
+             }
+             queries = grown;
+         }
+         queries[num_queries++] = query;
+     }
+     if (queries == NULL || num_queries == 0) {
+         fprintf(stderr, "Error: no queries to run\n");
+         free(queries);
+         return 2;
+     }
+     printf("%d queries, %d rounds, %s\n", num_queries, rounds, (k > 0) ? "top k" : "every match");
+     printf("%-24s %-7s %6s %9s %11s %10s %13s\n",
+            "index", "split", "shards", "load ms", "queries/s", "us/query", "shards/query");
+
+     int status = 0;
+     for (int f = optind; f < argc; f++) {
+         const char* indexFilename = argv[f];
+
+         // Load the index the way the querier would
+         double start = now_ms();
+         shard_set_t* shards = NULL;
+         index_t* index = NULL;
+         if (shard_is(indexFilename)) {
+             shards = shard_load(indexFilename);
+         } else {
+             index = segment_load(indexFilename);
+         }
+         double loadMs = now_ms() - start;
+         if (index == NULL && shards == NULL) {
+             fprintf(stderr, "Error: failed to load index from %s\n", indexFilename);
+             status = 3;
+             continue;
+         }
+
+         // Time the rounds; the first index's first round is the ranking every other must give
+         int mismatches = 0;
+         bool failed = false;
+         start = now_ms();
+         for (int r = 0; r < rounds && !failed; r++) {
+             for (int q = 0; q < num_queries; q++) {
+                 bench_query_t* query = &queries[q];
+                 query_hit_t* hits = NULL;
+                 int num_matches = 0;
+                 int num_hits = search(index, shards, query, weights, k, &hits, &num_matches);
+                 if (num_hits < 0) {
+                     failed = true;
+                     break;
+                 }
+                 if (r == 0) {
+                     if (query->num_hits < 0) {
+                         query->hits = hits;
+                         query->num_hits = num_hits;
+                         query->num_matches = num_matches;
+                         continue;
+                     }
+                     mismatches += (num_hits != query->num_hits || num_matches != query->num_matches
+                                    || (num_hits > 0 && memcmp(hits, query->hits, num_hits * sizeof(query_hit_t)) != 0));
+                 }
+                 free(hits);
+             }
+         }
+         double queryMs = now_ms() - start;
+
+         long touched = 0;
+         for (int q = 0; q < num_queries; q++) {
+             touched += shards_touched(shards, &queries[q]);
+         }
+         if (failed) {
+             fprintf(stderr, "Error: out of memory searching %s\n", indexFilename);
+             status = 4;
+         } else {
+             double total = (double) num_queries * rounds;
+             printf("%-24s %-7s %6d %9.1f %11.0f %10.1f %13.2f\n", indexFilename,
+                    shards == NULL ? "none" : shard_byTerm(shards) ? "terms" : "docs",
+                    shards == NULL ? 1 : shard_count(shards), loadMs,
+                    (queryMs > 0) ? total * 1000 / queryMs : 0, queryMs * 1000 / total,
+                    (double) touched / num_queries);
+         }
+         if (mismatches > 0) {
+             fprintf(stderr, "Error: %s ranks %d queries differently from %s\n",
+                     indexFilename, mismatches, argv[optind]);
+             status = 5;
+         }
+         index_delete(index);
+         shard_delete(shards);
+     }
+
+     for (int q = 0; q < num_queries; q++) {
+         free_words(queries[q].words, queries[q].num_words);
+         free(queries[q].hits);
+     }
+     free(queries);
+     return status;
+ }
+
+
+ /* Return the current time in milliseconds, from a clock that never steps back */
+ static double now_ms(void){
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+ }
+
+ /* Rank a query's best k documents on the index or shards, as the querier does; -1 if out of memory */
+ static int search(index_t* index, shard_set_t* shards, bench_query_t* query, const int* weights, const int k,
+                   query_hit_t** hits, int* num_matches){
+     if (shards != NULL) {
+         return shard_query(shards, query->words, query->num_words, weights, k, hits, num_matches);
+     }
+     counters_t* result = process_query_weighted(query->words, query->num_words, &index, 1, weights);
+     int num_hits = rank_results(result, k, hits, num_matches);
+     counters_delete(result);
+     return num_hits;
+ }
+
+ /* Return the number of shards a query reads: every one when split by docID (or for a prefix),
+  * else the shards holding its words */
+ static int shards_touched(shard_set_t* shards, const bench_query_t* query){
+     int numShards = shard_count(shards);
+     if (shards == NULL || !shard_byTerm(shards)) {
+         return (shards == NULL) ? 1 : numShards;
+     }
+     bool* touched = calloc(numShards, sizeof(bool));
+     if (touched == NULL) {
+         return numShards;
+     }
+     int count = 0;
+     for (int i = 0; i < query->num_words && count < numShards; i++) {
+         const char* word = query->words[i];
+         size_t len = strlen(word);
+         if (strcmp(word, "and") == 0 || strcmp(word, "or") == 0) {
+             continue;
+         }
+         if (len > 1 && word[len - 1] == '*') {
+             count = numShards;
+             break;
+         }
+         int shard = index_termShard(word, numShards);
+         count += !touched[shard];
+         touched[shard] = true;
+     }
+     free(touched);
+     return count;
+ }
@@ -5,6 +5,7 @@
 
 # Define directory paths and programs
 QUERIER=./querier
+INDEXER=../indexer/indexer
 PAGEDATA=~/cs50-dev/shared/tse/output/letters-3
 INDEXFILE=~/cs50-dev/shared/tse/output/indexer/index-letters-3
 INVALID_DIR=invalid
@@ -58,6 +59,13 @@ EOF
 playground and home and computer or school and teacher
 home or school or office and computer or playground
 playground and home or computer and school or teacher and student
+EOF
+
+    # Stopwords are dropped from queries, so each of these matches what "playground" matches
+    cat > "$TEST_DIR/stopword_queries.txt" << EOF
+the playground
+playground and the
+playground or the
 EOF
 
     # Create a file with invalid characters
@@ -128,6 +136,47 @@ $QUERIER $PAGEDATA $INDEXFILE < $TEST_DIR/edge_cases.txt
 RESULT=$?
 run_test "Edge case queries" "[ $RESULT -eq 0 ]"
 
+# Test that stopwords don't change the results for content words
+echo -e "\nRunning stopword queries:"
+for i in 1 2 3; do echo playground; done | $QUERIER $PAGEDATA $INDEXFILE > "$TEST_DIR/playground.out"
+$QUERIER $PAGEDATA $INDEXFILE < $TEST_DIR/stopword_queries.txt > "$TEST_DIR/stopword.out"
+run_test "Stopword queries match the content word alone" "cmp $TEST_DIR/playground.out $TEST_DIR/stopword.out"
+
+# Test that a prefix of only one word matches what the word matches
+echo -e "\nRunning prefix queries:"
+for i in 1 2 3; do echo 'playgroun*'; done | $QUERIER $PAGEDATA $INDEXFILE > "$TEST_DIR/prefix.out"
+run_test "Prefix query of one word matches the word" "cmp $TEST_DIR/playground.out $TEST_DIR/prefix.out"
+
+# Test that ":reload" swaps in a new build of the index without a restart: once the index file
+# is replaced by an empty one, the same query matches nothing
+echo -e "\nRunning a reload:"
+cp $INDEXFILE "$TEST_DIR/live.index"
+(echo playground; sleep 1; : > "$TEST_DIR/live.tmp"; mv "$TEST_DIR/live.tmp" "$TEST_DIR/live.index"; echo ":reload"; sleep 1; echo playground) \
+    | $QUERIER $PAGEDATA "$TEST_DIR/live.index" > "$TEST_DIR/reload.out"
+run_test "Reload picks up the replaced index" "head -1 $TEST_DIR/playground.out | cmp - <(head -1 $TEST_DIR/reload.out) && tail -1 $TEST_DIR/reload.out | grep -q 'No documents match'"
+
+# Test phrase and near queries: they need an index built with positions (indexer -b -p), on which
+# two words near/k for a k longer than any page match the same documents as the two words
+echo -e "\nRunning phrase and near queries:"
+echo '"playground home"' | $QUERIER $PAGEDATA $INDEXFILE 2> "$TEST_DIR/phrase.err"
+run_test "Phrase query on an index without positions is refused" "grep -q 'indexer -p' $TEST_DIR/phrase.err"
+$INDEXER -b -p $PAGEDATA "$TEST_DIR/positions.index"
+echo 'playground home' | $QUERIER $PAGEDATA "$TEST_DIR/positions.index" | grep -o 'doc *[0-9]*' | sort > "$TEST_DIR/and.out"
+echo 'playground near/99999 home' | $QUERIER $PAGEDATA "$TEST_DIR/positions.index" | grep -o 'doc *[0-9]*' | sort > "$TEST_DIR/near.out"
+run_test "Near with a long reach matches the same documents as and" "[ -s $TEST_DIR/and.out ] && cmp $TEST_DIR/and.out $TEST_DIR/near.out"
+
+# Test ranking with fields (-f): it needs an index built with fields (indexer -b -f), without which
+# it warns and ranks as before; on one, a title, heading or link only adds to a page's score
+echo -e "\nRunning queries ranked with fields:"
+$INDEXER -b -f $PAGEDATA "$TEST_DIR/fields.index"
+echo playground | $QUERIER $PAGEDATA $INDEXFILE > "$TEST_DIR/plain.out"
+echo playground | $QUERIER -f $PAGEDATA $INDEXFILE > "$TEST_DIR/nofields.out" 2> "$TEST_DIR/nofields.err"
+run_test "Fields on an index without them warn and change nothing" "grep -q 'indexer -f' $TEST_DIR/nofields.err && cmp $TEST_DIR/plain.out $TEST_DIR/nofields.out"
+run_test "An index with fields ranks as before without -f" "echo playground | $QUERIER $PAGEDATA $TEST_DIR/fields.index | cmp - $TEST_DIR/plain.out"
+echo playground | $QUERIER -f $PAGEDATA "$TEST_DIR/fields.index" | grep -o 'score *[0-9]* doc *[0-9]*' | awk '{print $4, $2}' | sort > "$TEST_DIR/fields.out"
+grep -o 'score *[0-9]* doc *[0-9]*' "$TEST_DIR/plain.out" | awk '{print $4, $2}' | sort | join - "$TEST_DIR/fields.out" > "$TEST_DIR/both.out"
+run_test "Fields only add to scores" "[ \$(wc -l < $TEST_DIR/both.out) -eq \$(grep -c score $TEST_DIR/plain.out) ] && awk '\$3 < \$2 { exit 1 }' $TEST_DIR/both.out"
+
 # Section 4: Fuzz testing
 echo "Running fuzz tests..."
 